@@ -4,8 +4,12 @@
 //   - changes ADC channels
 //   - reads ADC values
 //   - reads and writes register values
+//   - applies a whole configuration at once
+//   - reports what all that cost on the bus (built with ADS_STATS=1)
+#include "adc_config.h"
 #include "device_driver.h"
 #include "spi_emulator.h"
+#include "trace_log.h"
 
 #include <iomanip>
 #include <iostream>
@@ -15,10 +19,14 @@ void print_hex(uint16_t val)
   std::cout << "0x" << std::setfill('0') << std::setw(4) << std::uppercase << std::hex << val << std::dec;
 }
 
-uint16_t read_adc_channel(DeviceDriver &adc, uint8_t ch, SpiEmulator spi)
+uint16_t read_adc_channel(DeviceDriver &adc, uint8_t ch, SpiEmulator &spi)
 {
+  // As on the part, a reading has to be converted first: START, wait for it to settle, RDATA
   adc.set_channel(ch);
+  adc.start_conversions();
+  spi.advance_time(adc.get_settling_nanos());
   uint16_t value = adc.read_adc_by_rdata_cmd();
+  adc.stop_conversions();
 
   std::cout << "APP reading ADC channel " << (int)ch;
   std::cout << "... Expected: ";
@@ -56,16 +64,21 @@ void write_register(DeviceDriver &adc, uint8_t addr, uint8_t write_val)
 int main()
 {
   SpiEmulator  spi(1);
-  DeviceDriver driver(spi);
+  DeviceDriver driver(spi, spi.get_clock());
 
   driver.initialize();
 
+  // The driver and emulator only record binary trace events; format them here, between
+  // sections, rather than in the middle of every transaction
+  trace_log().drain_to(stdout);
+
   std::cout << "---------------------------" << std::endl;
 
   for (auto adc_channel = 0; adc_channel < driver.get_num_channels(); ++adc_channel)
   {
     read_adc_channel(driver, adc_channel, spi);
   }
+  trace_log().drain_to(stdout);
 
   std::cout << "---------------------------" << std::endl;
 
@@ -93,5 +106,27 @@ int main()
 
   std::cout << "---------------------------" << std::endl;
 
+  // Rather than a write and a readback per register: one WREG burst for the whole configuration
+  // and one RREG burst to check it
+  AdcConfig config;
+  config.ch_plus     = 2;
+  config.ch_minus    = 3;
+  config.pga_enabled = true;
+  config.gain        = 7;
+  config.data_rate   = 0x0c;
+  config.ref_select  = 2;
+  config.ref_control = 1;
+  const bool applied = driver.apply_config(config);
+  std::cout << "APP applied a configuration: " << (applied ? "verified" : "doesn't read back") << std::endl;
+  trace_log().drain_to(stdout);
+
+#if ADS_STATS
+  std::cout << "---------------------------" << std::endl;
+
+  // Simulated bus time, since the driver runs on the emulator's clock
+  std::cout << std::flush;
+  driver.get_stats().print(stdout);
+#endif
+
   return 0;
 }
@@ -0,0 +1,867 @@
+// Throughput and per-call latency of the driver's hot paths against the emulated ADC.
+// Everything runs on the emulator's virtual clock, so the numbers are pure host CPU cost of the
+// driver + emulator, not simulated bus time.
+//
+// Run with --benchmark_out=<file> --benchmark_out_format=json (or the run_benchmarks target)
+// to get machine-readable results for tracking regressions across commits.
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "adc_config.h"
+#include "adc_constants.h"
+#include "async_bus.h"
+#include "bus_scan_sequencer.h"
+#include "bus_stats.h"
+#include "calibration_store.h"
+#include "crc8.h"
+#include "device_driver.h"
+#include "replay_spi.h"
+#include "sample_filter.h"
+#include "scan_sequencer.h"
+#include "spi_bus.h"
+#include "spi_emulator.h"
+#include "spi_recorder.h"
+#include "unit_converter.h"
+#include "virtual_clock.h"
+
+static void BM_ReadRegister(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(driver.read_register(ADS114S08_REGISTERS::DATARATE));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ReadRegister);
+
+// Alternates between two values so the shadow never gets to skip the write
+static void BM_WriteRegister(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+
+  uint8_t value = 0;
+  for (auto _ : state)
+  {
+    driver.write_register(ADS114S08_REGISTERS::PGA, value);
+    value ^= 0x08;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_WriteRegister);
+
+// Same value every time: what a redundant write costs now that the shadow catches it
+static void BM_WriteRegisterRedundant(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+
+  for (auto _ : state)
+  {
+    driver.write_register(ADS114S08_REGISTERS::PGA, 0x08);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_WriteRegisterRedundant);
+
+// Burst register read, parameterized by the number of registers per transaction
+static void BM_ReadRegisters(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+
+  const uint8_t count = static_cast<uint8_t>(state.range(0));
+  uint8_t       regs[DeviceDriver::NUM_REGISTERS];
+  for (auto _ : state)
+  {
+    driver.read_registers(0, count, regs);
+    benchmark::DoNotOptimize(regs);
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+  state.SetBytesProcessed(state.iterations() * (2 + count));
+}
+BENCHMARK(BM_ReadRegisters)->Arg(1)->Arg(4)->Arg(8)->Arg(DeviceDriver::NUM_REGISTERS);
+
+// Select a channel and read it, toggling between two channels so the mux write isn't skipped.
+// Nothing is converting, so RDATA gets the last completed conversion: this is what the two
+// transactions cost, not a sample rate (BM_ChannelScan and BM_AchievableRate have those).
+static void BM_SetChannelAndRdata(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+
+  uint8_t channel = 0;
+  for (auto _ : state)
+  {
+    driver.set_channel(channel);
+    benchmark::DoNotOptimize(driver.read_adc_by_rdata_cmd());
+    channel ^= 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SetChannelAndRdata);
+
+// A full scan the way main.cpp does it: set_channel, START, wait out the settling time and RDATA
+// for each channel in turn, parameterized by the number of channels scanned. Items = samples;
+// sim_ns_per_scan is the simulated time one pass takes at the default 20 SPS.
+static void BM_ChannelScan(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  const uint64_t settling = driver.get_settling_nanos();
+
+  const uint8_t  num_channels = static_cast<uint8_t>(state.range(0));
+  uint16_t       readings[12];
+  const uint64_t t0 = spi.get_clock().now_nanos();
+  for (auto _ : state)
+  {
+    for (uint8_t ch = 0; ch < num_channels; ++ch)
+    {
+      driver.set_channel(ch);
+      driver.start_conversions();
+      spi.get_clock().delay_nanos(settling);
+      readings[ch] = driver.read_adc_by_rdata_cmd();
+      driver.stop_conversions();
+    }
+    benchmark::DoNotOptimize(readings);
+  }
+  state.SetItemsProcessed(state.iterations() * num_channels);
+  state.counters["sim_ns_per_scan"] = benchmark::Counter(
+      static_cast<double>(spi.get_clock().now_nanos() - t0) / state.iterations());
+}
+BENCHMARK(BM_ChannelScan)->DenseRange(2, 12, 2);
+
+// The same scan through ScanSequencer in continuous conversion mode at the fastest data rate:
+// one WREG + RDATA frame per sample, with each conversion settling while the previous one is
+// read out. sim_ns_per_scan is the simulated bus + settling time one pass takes.
+static void BM_SequencedScan(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::FILTER | 0x0d);
+
+  const uint8_t num_channels = static_cast<uint8_t>(state.range(0));
+  MuxPair       list[12];
+  for (uint8_t ch = 0; ch < num_channels; ++ch)
+  {
+    list[ch] = {ch, 0x0c};
+  }
+
+  ScanSequencer sequencer(driver);
+  sequencer.set_scan_list(list, num_channels);
+
+  uint16_t       readings[12];
+  const uint64_t t0 = spi.get_clock().now_nanos();
+  for (auto _ : state)
+  {
+    sequencer.scan(readings);
+    benchmark::DoNotOptimize(readings);
+  }
+  state.SetItemsProcessed(state.iterations() * num_channels);
+  state.counters["sim_ns_per_scan"] = benchmark::Counter(
+      static_cast<double>(spi.get_clock().now_nanos() - t0) / state.iterations());
+}
+BENCHMARK(BM_SequencedScan)->DenseRange(2, 12, 2);
+
+// Bridge-style differential scan through ScanSequencer: pairs (AIN0, AIN1), (AIN2, AIN3) ...,
+// parameterized by pair count, read into a packed signed buffer. The emulator works out both
+// inputs of every pair, so this is the single-ended scan's cost plus the negative inputs.
+static void BM_DifferentialScan(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::FILTER | 0x0d);
+
+  const uint8_t num_pairs = static_cast<uint8_t>(state.range(0));
+  MuxPair       list[6];
+  for (uint8_t p = 0; p < num_pairs; ++p)
+  {
+    list[p] = {static_cast<uint8_t>(2 * p), static_cast<uint8_t>(2 * p + 1)};
+  }
+
+  ScanSequencer sequencer(driver);
+  sequencer.set_scan_list(list, num_pairs);
+
+  int16_t        readings[6];
+  const uint64_t t0 = spi.get_clock().now_nanos();
+  for (auto _ : state)
+  {
+    sequencer.scan(readings);
+    benchmark::DoNotOptimize(readings);
+  }
+  state.SetItemsProcessed(state.iterations() * num_pairs);
+  state.counters["sim_ns_per_scan"] = benchmark::Counter(
+      static_cast<double>(spi.get_clock().now_nanos() - t0) / state.iterations());
+}
+BENCHMARK(BM_DifferentialScan)->DenseRange(1, 6, 1);
+
+// Four-entry scans on every device of one bus, interleaved by BusScanSequencer, parameterized by
+// device count. sim_ns_per_scan should stay close to a single device's pass as devices are added.
+static void BM_InterleavedScan(benchmark::State &state)
+{
+  const uint8_t num_devices = static_cast<uint8_t>(state.range(0));
+  SpiEmulator   spi(num_devices, false);
+  SpiBus        bus(spi, spi.get_clock());
+
+  std::vector<std::unique_ptr<DeviceDriver>> drivers;
+  BusScanSequencer                           sequencer(bus);
+  const MuxPair                              list[] = {{0, 0x0c}, {3, 0x0c}, {6, 0x0c}, {9, 0x0c}};
+  for (uint8_t cs = 0; cs < num_devices; ++cs)
+  {
+    drivers.emplace_back(new DeviceDriver(bus.device(cs), spi.get_clock()));
+    drivers.back()->initialize();
+    drivers.back()->write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::FILTER | 0x0d);
+    sequencer.add_device(*drivers.back(), list, 4);
+  }
+
+  uint16_t       readings[4 * SpiBus::MAX_DEVICES];
+  const uint64_t t0 = spi.get_clock().now_nanos();
+  for (auto _ : state)
+  {
+    sequencer.scan(readings);
+    benchmark::DoNotOptimize(readings);
+  }
+  state.SetItemsProcessed(state.iterations() * sequencer.get_scan_length());
+  state.counters["sim_ns_per_scan"] = benchmark::Counter(
+      static_cast<double>(spi.get_clock().now_nanos() - t0) / state.iterations());
+}
+BENCHMARK(BM_InterleavedScan)->DenseRange(1, SpiBus::MAX_DEVICES, 1);
+
+// What twelve channels really come to in samples per simulated second, nothing reading a
+// conversion that hasn't happened: single-shot START per channel, polling DRDY every 10 uS
+// before RDATA (0); converting continuously, moving the mux by hand and waiting out the settling
+// time (1); or ScanSequencer, which reads each result while the next one settles (2).
+// Low-latency filter at 4000 SPS.
+static void BM_AchievableRate(benchmark::State &state)
+{
+  const int    strategy = static_cast<int>(state.range(0));
+  SpiEmulator  spi;
+  VirtualClock &clock = spi.get_clock();
+  DeviceDriver driver(spi, clock);
+  driver.initialize();
+
+  const uint8_t datarate = ADS114S08_DATARATE::FILTER | 0x0d;
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, (strategy == 0) ? (ADS114S08_DATARATE::MODE | datarate) : datarate);
+  const uint64_t settling = driver.get_settling_nanos();
+
+  MuxPair list[12];
+  for (uint8_t ch = 0; ch < 12; ++ch)
+  {
+    list[ch] = {ch, ADS114S08_INPMUX::AINCOM};
+  }
+  ScanSequencer sequencer(driver);
+  sequencer.set_scan_list(list, 12);
+  if (strategy == 1)
+  {
+    driver.start_conversions();
+  }
+
+  uint16_t       readings[12];
+  const uint64_t t0 = clock.now_nanos();
+  for (auto _ : state)
+  {
+    if (strategy == 2)
+    {
+      sequencer.scan(readings);
+    }
+    else
+    {
+      for (uint8_t ch = 0; ch < 12; ++ch)
+      {
+        driver.set_channel(ch);
+        if (strategy == 0)
+        {
+          driver.start_conversions();
+          while (!spi.is_drdy_low())
+          {
+            clock.delay_nanos(10000);
+          }
+        }
+        else
+        {
+          clock.delay_nanos(settling);
+        }
+        readings[ch] = driver.read_adc_by_rdata_cmd();
+      }
+    }
+    benchmark::DoNotOptimize(readings);
+  }
+  state.SetItemsProcessed(state.iterations() * 12);
+  state.counters["sim_sps"] = benchmark::Counter(static_cast<double>(state.iterations() * 12) * 1e9 /
+                                                 static_cast<double>(clock.now_nanos() - t0));
+}
+BENCHMARK(BM_AchievableRate)->DenseRange(0, 2, 1);
+
+// Every device on a converting bus moved to its next input and read once: one after the other
+// through the blocking driver calls (0), or all submitted to an AsyncBus so their settling
+// overlaps (1). Eight devices; sim_ns_per_round is the bus time for the lot.
+static void BM_AsyncReadInputs(benchmark::State &state)
+{
+  const bool    async_reads = state.range(0);
+  const uint8_t num_devices = SpiBus::MAX_DEVICES;
+  SpiEmulator   spi(num_devices, false);
+  SpiBus        bus(spi, spi.get_clock());
+  AsyncBus      async(bus);
+
+  std::vector<std::unique_ptr<DeviceDriver>> drivers;
+  for (uint8_t cs = 0; cs < num_devices; ++cs)
+  {
+    drivers.emplace_back(new DeviceDriver(bus.device(cs), spi.get_clock()));
+    drivers.back()->initialize();
+    drivers.back()->write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::FILTER | 0x0d);
+    drivers.back()->start_conversions();
+    async.add_device(*drivers.back());
+  }
+  const uint64_t settling = drivers[0]->get_settling_nanos();
+
+  uint8_t         ch = 0;
+  AsyncCompletion done[num_devices];
+  const uint64_t  t0 = spi.get_clock().now_nanos();
+  for (auto _ : state)
+  {
+    ch = (ch + 1) % 12;
+    if (async_reads)
+    {
+      for (uint8_t cs = 0; cs < num_devices; ++cs)
+      {
+        async.submit_read_input(cs, ch);
+      }
+      while (async.get_pending())
+      {
+        async.wait();
+      }
+      benchmark::DoNotOptimize(async.get_completions(done, num_devices));
+    }
+    else
+    {
+      for (auto &driver : drivers)
+      {
+        driver->set_channel(ch);
+        spi.get_clock().delay_nanos(settling);
+        benchmark::DoNotOptimize(driver->read_adc_by_rdata_cmd());
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_devices);
+  state.counters["sim_ns_per_round"] = benchmark::Counter(
+      static_cast<double>(spi.get_clock().now_nanos() - t0) / state.iterations());
+}
+BENCHMARK(BM_AsyncReadInputs)->Arg(0)->Arg(1);
+
+// set_channel + RDATA with each combination of SYS.SENDSTAT (1) and SYS.CRC (2), so the cost of
+// the bigger frame plus parsing and checking it shows up against the plain two-byte read (of the
+// last completed conversion, as in BM_SetChannelAndRdata)
+static void BM_RdataIntegrity(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::SYS,
+                        ADS114S08_REGISTERS::RESET_VALUES[ADS114S08_REGISTERS::SYS] | static_cast<uint8_t>(state.range(0)));
+
+  uint8_t  ch = 0;
+  uint16_t value;
+  for (auto _ : state)
+  {
+    driver.set_channel(ch);
+    benchmark::DoNotOptimize(driver.read_adc_by_rdata_cmd(value));
+    benchmark::DoNotOptimize(value);
+    ch = (ch + 1) % 12;
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["crc_errors"] = driver.get_crc_errors();
+}
+BENCHMARK(BM_RdataIntegrity)->DenseRange(0, 3, 1);
+
+// A get_stats() snapshot, as a monitoring thread would take it: every counter and histogram
+// bucket copied out. Build with -DADS_STATS=1 for this to copy anything, and compare every other
+// number here against the default build to see what counting costs each transaction.
+static void BM_GetStats(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  for (uint8_t ch = 0; ch < 12; ++ch)
+  {
+    driver.set_channel(ch);
+    (void)driver.read_adc_by_rdata_cmd();
+  }
+
+  for (auto _ : state)
+  {
+    const BusStatsSnapshot stats = driver.get_stats();
+    benchmark::DoNotOptimize(stats.get_latency(BusOp::RDATA).value_at_percentile(99.0));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetStats);
+
+// Host-side cost of checking one [STATUS] MSB LSB CRC frame by itself, per sample
+static void BM_Crc8CheckFrame(benchmark::State &state)
+{
+  uint8_t frames[256][4];
+  for (unsigned n = 0; n < 256; ++n)
+  {
+    frames[n][0] = 0x00;
+    frames[n][1] = static_cast<uint8_t>(n * 97);
+    frames[n][2] = static_cast<uint8_t>(n);
+    frames[n][3] = ADS114S08_CRC::crc8(frames[n], 3);
+  }
+
+  uint8_t n = 0;
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(ADS114S08_CRC::check_frame(frames[n++], 4));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Crc8CheckFrame);
+
+// Checking a block of buffered four-byte frames in one go, by block size. Items = samples
+static void BM_Crc8CheckFrames(benchmark::State &state)
+{
+  const size_t         count = static_cast<size_t>(state.range(0));
+  std::vector<uint8_t> frames(4 * count);
+  for (size_t n = 0; n < count; ++n)
+  {
+    uint8_t *frame = &frames[4 * n];
+    frame[0]       = 0x00;
+    frame[1]       = static_cast<uint8_t>(n * 97);
+    frame[2]       = static_cast<uint8_t>(n);
+    frame[3]       = ADS114S08_CRC::crc8(frame, 3);
+  }
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(ADS114S08_CRC::check_frames(frames.data(), 4, count));
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+  state.SetBytesProcessed(state.iterations() * frames.size());
+}
+BENCHMARK(BM_Crc8CheckFrames)->RangeMultiplier(8)->Range(8, 4096);
+
+// Codes to volts one at a time, working the scale out from the PGA and REF settings for every
+// sample. Items = samples
+static void BM_ConvertPerSample(benchmark::State &state)
+{
+  const size_t          count = static_cast<size_t>(state.range(0));
+  std::vector<uint16_t> codes(count);
+  std::vector<float>    volts(count);
+  for (size_t n = 0; n < count; ++n)
+  {
+    codes[n] = static_cast<uint16_t>(n * 1789);
+  }
+  uint8_t pga_reg = ADS114S08_PGA::PGA_EN | 3;
+  double  vref    = 2.5;
+  benchmark::DoNotOptimize(pga_reg);
+  benchmark::DoNotOptimize(vref);
+
+  for (auto _ : state)
+  {
+    for (size_t n = 0; n < count; ++n)
+    {
+      volts[n] = static_cast<float>(static_cast<int16_t>(codes[n]) * vref / (ADS114S08_PGA::gain(pga_reg) * 32768.0));
+    }
+    benchmark::DoNotOptimize(volts.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ConvertPerSample)->RangeMultiplier(8)->Range(8, 4096);
+
+// The same through UnitConverter: update() from the driver's shadow registers, then one pass
+// over the block. Items = samples
+static void BM_ConvertBlock(benchmark::State &state)
+{
+  const size_t          count = static_cast<size_t>(state.range(0));
+  std::vector<uint16_t> codes(count);
+  std::vector<float>    volts(count);
+  for (size_t n = 0; n < count; ++n)
+  {
+    codes[n] = static_cast<uint16_t>(n * 1789);
+  }
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::PGA, ADS114S08_PGA::PGA_EN | 3);
+  UnitConverter converter;
+
+  for (auto _ : state)
+  {
+    converter.update(driver);
+    converter.to_volts(codes.data(), volts.data(), count);
+    benchmark::DoNotOptimize(volts.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ConvertBlock)->RangeMultiplier(8)->Range(8, 4096);
+
+// Each filter stage on 12-channel streams scanned off the emulated ADC (a sine plus noise on every
+// input), 1024 frames a block: boxcar /16 (0), moving average of 16 (1), CIC /16 order 3 (2), 32-tap
+// FIR (3), median of 5 (4), and a pipeline of median of 5 into the CIC (5). Items = samples, so
+// items_per_second is samples per second on one core.
+static void BM_FilterStage(benchmark::State &state)
+{
+  const size_t CHANNELS = 12;
+  const size_t FRAMES   = 1024;
+
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::FILTER | 0x0d);
+  MuxPair list[CHANNELS];
+  for (uint8_t ch = 0; ch < CHANNELS; ++ch)
+  {
+    const SignalComponent source[] = {SignalComponent::dc(0x1000 * ch), SignalComponent::sine(500, 50.0 + ch),
+                                      SignalComponent::noise(8, 0xF17E5 + ch)};
+    spi.get_signals().set_source(ch, source, 3);
+    list[ch] = {ch, ADS114S08_INPMUX::AINCOM};
+  }
+  ScanSequencer sequencer(driver);
+  sequencer.set_scan_list(list, CHANNELS);
+  std::vector<uint16_t> codes(FRAMES * CHANNELS);
+  sequencer.run(codes.data(), FRAMES);
+
+  float taps[32];
+  for (size_t k = 0; k < 32; ++k)
+  {
+    taps[k] = 1.0f / 32;
+  }
+  BoxcarDecimator boxcar;
+  MovingAverage   average;
+  CicDecimator    cic;
+  FirFilter       fir;
+  MedianFilter    median;
+  boxcar.configure(CHANNELS, 16);
+  average.configure(CHANNELS, 16);
+  cic.configure(CHANNELS, 16, 3);
+  fir.configure(CHANNELS, taps, 32);
+  median.configure(CHANNELS, 5);
+
+  ISampleFilter *const stages[] = {&boxcar, &average, &cic, &fir, &median};
+  FilterPipeline       pipeline;
+  if (state.range(0) < 5)
+  {
+    pipeline.add_stage(*stages[state.range(0)]);
+  }
+  else
+  {
+    pipeline.add_stage(median);
+    pipeline.add_stage(cic);
+  }
+
+  std::vector<float> filtered(FRAMES * CHANNELS);
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(pipeline.process(codes.data(), FRAMES, filtered.data()));
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * FRAMES * CHANNELS);
+}
+BENCHMARK(BM_FilterStage)->DenseRange(0, 5, 1);
+
+// Switching between two scan phases' configurations (INPMUX .. SYS, five registers apart): a
+// write_register() and a read_register() to check it for each register (0), as hand-rolled
+// code does, vs. apply_config()'s one WREG and one RREG (1). sim_ns_per_switch is the bus time.
+static void BM_Reconfigure(benchmark::State &state)
+{
+  const bool burst = state.range(0);
+
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+
+  AdcConfig phases[2];
+  phases[0].ch_plus     = 2;
+  phases[0].ch_minus    = 3;
+  phases[0].pga_enabled = true;
+  phases[0].gain        = 7;
+  phases[0].data_rate   = 0x0c;
+  phases[1].ch_plus     = 5;
+  phases[1].ch_minus    = ADS114S08_INPMUX::AINCOM;
+  phases[1].data_rate   = 0x0d;
+  phases[1].ref_select  = 2;
+  phases[1].ref_control = 1;
+  phases[1].sendstat    = true;
+
+  const uint64_t t0    = spi.get_clock().now_nanos();
+  size_t         phase = 0;
+  for (auto _ : state)
+  {
+    const AdcConfig &config = phases[phase];
+    if (burst)
+    {
+      benchmark::DoNotOptimize(driver.apply_config(config));
+    }
+    else
+    {
+      const AdcConfig::Registers regs = AdcConfig::encode(config);
+      bool                       ok   = true;
+      for (uint8_t n = 0; n < AdcConfig::NUM_REGISTERS; ++n)
+      {
+        driver.write_register(AdcConfig::FIRST_REGISTER + n, regs[n]);
+        ok &= (driver.read_register(AdcConfig::FIRST_REGISTER + n) == regs[n]);
+      }
+      benchmark::DoNotOptimize(ok);
+    }
+    phase ^= 1;
+  }
+  state.counters["sim_ns_per_switch"] = benchmark::Counter(
+      static_cast<double>(spi.get_clock().now_nanos() - t0) / state.iterations());
+}
+BENCHMARK(BM_Reconfigure)->Arg(0)->Arg(1);
+
+// initialize() with a configuration: cold (0) on a device that's only just powered up, so it
+// waits for RDY, resets and writes the configuration; warm (1) on one that already holds it, as
+// after the app restarts. sim_ns_per_init is the simulated time each takes.
+static void BM_Initialize(benchmark::State &state)
+{
+  const bool warm = state.range(0);
+
+  std::array<uint8_t, DeviceDriver::NUM_REGISTERS> config;
+  memcpy(config.data(), ADS114S08_REGISTERS::RESET_VALUES, config.size());
+  config[ADS114S08_REGISTERS::INPMUX]   = 0x3c;
+  config[ADS114S08_REGISTERS::PGA]      = ADS114S08_PGA::PGA_EN | 2;
+  config[ADS114S08_REGISTERS::DATARATE] = ADS114S08_DATARATE::FILTER | 0x0d;
+
+  SpiEmulator running;
+  {
+    DeviceDriver first(running, running.get_clock());
+    first.initialize(config);
+  }
+
+  uint64_t sim_nanos = 0;
+  for (auto _ : state)
+  {
+    std::unique_ptr<SpiEmulator> powered_up;
+    SpiEmulator                 *spi = &running;
+    if (!warm)
+    {
+      powered_up = std::make_unique<SpiEmulator>(true);
+      spi        = powered_up.get();
+    }
+
+    DeviceDriver   driver(*spi, spi->get_clock());
+    const uint64_t t0 = spi->get_clock().now_nanos();
+    benchmark::DoNotOptimize(driver.initialize(config));
+    sim_nanos += spi->get_clock().now_nanos() - t0;
+  }
+  state.counters["sim_ns_per_init"] = benchmark::Counter(static_cast<double>(sim_nanos) / state.iterations());
+}
+BENCHMARK(BM_Initialize)->Arg(0)->Arg(1);
+
+// Bringing up calibration for 12 single-ended inputs at the fastest data rate: from scratch with
+// SFOCAL (0), or restored from stored profiles (1). sim_ns_per_startup is the simulated time the
+// bus and the calibrations take.
+static void BM_CalibrationStartup(benchmark::State &state)
+{
+  const bool warm = state.range(0);
+
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::FILTER | 0x0d);
+
+  CalibrationStore profiles;
+  for (uint8_t ch = 0; ch < 12; ++ch)
+  {
+    driver.set_channel(ch);
+    profiles.restore_or_calibrate(driver, 0, 0);
+  }
+
+  const uint64_t t0 = spi.get_clock().now_nanos();
+  for (auto _ : state)
+  {
+    CalibrationStore store = warm ? profiles : CalibrationStore();
+    for (uint8_t ch = 0; ch < 12; ++ch)
+    {
+      driver.set_channel(ch);
+      benchmark::DoNotOptimize(store.restore_or_calibrate(driver, 0, 0));
+    }
+  }
+  state.counters["sim_ns_per_startup"] = benchmark::Counter(
+      static_cast<double>(spi.get_clock().now_nanos() - t0) / state.iterations());
+}
+BENCHMARK(BM_CalibrationStartup)->Arg(0)->Arg(1);
+
+// BM_ChannelScan's 12-channel scan replayed from a capture instead of emulated: how fast a long
+// recording can be played back through the driver. Items = samples; recorded_x_realtime is
+// seconds of captured bus traffic replayed per second of wall time.
+static void BM_ReplayScan(benchmark::State &state)
+{
+  static const uint32_t NUM_SCANS = 4096;
+  const char           *tmpdir    = getenv("TMPDIR");
+  const std::string     path      = std::string(tmpdir ? tmpdir : "/tmp") + "/bm_replay_scan.aspr";
+
+  uint64_t recorded_nanos;
+  {
+    SpiEmulator spi;
+    FILE       *out = fopen(path.c_str(), "wb");
+    if (!out)
+    {
+      state.SkipWithError("can't create capture file");
+      return;
+    }
+    {
+      SpiRecorder  recorder(spi, spi.get_clock(), out);
+      DeviceDriver driver(recorder, spi.get_clock());
+      const uint64_t start = spi.get_clock().now_nanos();
+      for (uint32_t scan = 0; scan < NUM_SCANS; ++scan)
+      {
+        for (uint8_t ch = 0; ch < 12; ++ch)
+        {
+          driver.set_channel(ch);
+          benchmark::DoNotOptimize(driver.read_adc_by_rdata_cmd());
+        }
+      }
+      recorded_nanos = spi.get_clock().now_nanos() - start;
+    }
+    fclose(out);
+  }
+
+  uint64_t divergences = 0;
+  for (auto _ : state)
+  {
+    ReplaySpi    replay(path.c_str());
+    VirtualClock clock;
+    DeviceDriver driver(replay, clock);
+    for (uint32_t scan = 0; scan < NUM_SCANS; ++scan)
+    {
+      for (uint8_t ch = 0; ch < 12; ++ch)
+      {
+        driver.set_channel(ch);
+        benchmark::DoNotOptimize(driver.read_adc_by_rdata_cmd());
+      }
+    }
+    divergences += replay.get_divergences();
+  }
+  remove(path.c_str());
+
+  if (divergences)
+  {
+    state.SkipWithError("replay diverged from the capture");
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_SCANS * 12);
+  state.counters["recorded_x_realtime"] =
+      benchmark::Counter(static_cast<double>(state.iterations()) * recorded_nanos * 1e-9, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ReplayScan);
+
+// A bus that does nothing but echo COPI back on CIPO, so what's left is the driver's own cost.
+// LoopbackBus is a static policy the compiler can see through; VirtualLoopbackBus is the same
+// thing behind ISpiInterface, the way DeviceDriver sees every bus.
+struct LoopbackBus
+{
+    void init(uint8_t SPI_mode) { (void)SPI_mode; }
+    void write(uint8_t data) { benchmark::DoNotOptimize(data); }
+    void transfer(const uint8_t *tx, uint8_t *rx, size_t len)
+    {
+      if (rx)
+      {
+        memcpy(rx, tx, len);
+      }
+    }
+};
+
+class VirtualLoopbackBus : public ISpiInterface
+{
+    LoopbackBus bus;
+
+  public:
+    virtual void    init(uint8_t SPI_mode) override { bus.init(SPI_mode); }
+    virtual uint8_t transfer(uint8_t data) override { return data; }
+    virtual void    write(uint8_t data) override { bus.write(data); }
+    virtual uint8_t read(void) override { return 0; }
+    virtual void    transfer(const uint8_t *tx, uint8_t *rx, size_t len) override { bus.transfer(tx, rx, len); }
+};
+
+// The per-sample scan path (set_channel + RDATA, then a pipelined switch-and-read) through the
+// type-erased DeviceDriver and through BasicDeviceDriver specialized on each bus. Items = samples
+template <typename Driver, typename Bus> static void BM_DriverDispatch(benchmark::State &state)
+{
+  Bus          bus;
+  VirtualClock clock;
+  Driver       driver(bus, clock);
+  driver.initialize();
+
+  uint8_t ch = 0;
+  for (auto _ : state)
+  {
+    driver.set_channel(ch);
+    benchmark::DoNotOptimize(driver.read_adc_by_rdata_cmd());
+    benchmark::DoNotOptimize(driver.switch_channel_and_read(ch));
+    ch = (ch + 1) % 12;
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK_TEMPLATE(BM_DriverDispatch, DeviceDriver, VirtualLoopbackBus);
+BENCHMARK_TEMPLATE(BM_DriverDispatch, BasicDeviceDriver<ADS114S08_Traits, LoopbackBus>, LoopbackBus);
+
+// The same against the emulator, where the bus itself costs far more than the call into it
+template <typename Driver> static void BM_DriverDispatchEmulated(benchmark::State &state)
+{
+  SpiEmulator spi;
+  Driver      driver(spi, spi.get_clock());
+  driver.initialize();
+
+  uint8_t ch = 0;
+  for (auto _ : state)
+  {
+    driver.set_channel(ch);
+    benchmark::DoNotOptimize(driver.read_adc_by_rdata_cmd());
+    benchmark::DoNotOptimize(driver.switch_channel_and_read(ch));
+    ch = (ch + 1) % 12;
+  }
+  state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK_TEMPLATE(BM_DriverDispatchEmulated, DeviceDriver);
+BENCHMARK_TEMPLATE(BM_DriverDispatchEmulated, BasicDeviceDriver<ADS114S08_Traits, SpiEmulator>);
+
+// Raw vectored SpiEmulator::transfer, parameterized by transaction size in bytes (all NOPs)
+static void BM_SpiTransfer(benchmark::State &state)
+{
+  SpiEmulator  spi;
+  const size_t len = static_cast<size_t>(state.range(0));
+  uint8_t      tx[256] = {0};
+  uint8_t      rx[256];
+
+  for (auto _ : state)
+  {
+    spi.transfer(tx, rx, len);
+    benchmark::DoNotOptimize(rx);
+  }
+  state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_SpiTransfer)->RangeMultiplier(4)->Range(1, 256);
+
+// Raw per-byte SpiEmulator::transfer through the ISpiInterface vtable
+static void BM_SpiTransferByte(benchmark::State &state)
+{
+  SpiEmulator    spi;
+  ISpiInterface &bus = spi;
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(bus.transfer(ADS114S08_CMD::NOP));
+  }
+  state.SetBytesProcessed(state.iterations());
+}
+BENCHMARK(BM_SpiTransferByte);
@@ -0,0 +1,115 @@
+// Raw throughput of the emulated ADC: how many bytes per second SpiEmulator can clock through
+// ADS114S08_Emulator::simulate_op() for the kinds of frames the driver actually sends.
+// Bytes/s shows up as "bytes_per_second" in the output.
+#include <benchmark/benchmark.h>
+
+#include "adc_constants.h"
+#include "signal_engine.h"
+#include "spi_emulator.h"
+
+// RREG of the whole register map: 2 command bytes + 18 NOPs
+static void BM_EmulatorRregBurst(benchmark::State &state)
+{
+  SpiEmulator spi;
+  uint8_t     tx[2 + ADS114S08_REGISTERS::NUM_REGISTERS] = {ADS114S08_CMD::RREG_1ST,
+                                                            ADS114S08_REGISTERS::NUM_REGISTERS - 1};
+  uint8_t     rx[sizeof(tx)];
+
+  for (auto _ : state)
+  {
+    spi.transfer(tx, rx, sizeof(tx));
+    benchmark::DoNotOptimize(rx);
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(tx));
+}
+BENCHMARK(BM_EmulatorRregBurst);
+
+// Single-register WREG: 3 bytes
+static void BM_EmulatorWregSingle(benchmark::State &state)
+{
+  SpiEmulator   spi;
+  const uint8_t tx[3] = {ADS114S08_CMD::WREG_1ST | ADS114S08_REGISTERS::INPMUX, 0x00, 0x3c};
+
+  for (auto _ : state)
+  {
+    spi.transfer(tx, nullptr, sizeof(tx));
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(tx));
+}
+BENCHMARK(BM_EmulatorWregSingle);
+
+// RDATA: command + 2 data bytes
+static void BM_EmulatorRdata(benchmark::State &state)
+{
+  SpiEmulator   spi;
+  const uint8_t tx[3] = {ADS114S08_CMD::RDATA, ADS114S08_CMD::NOP, ADS114S08_CMD::NOP};
+  uint8_t       rx[3];
+
+  for (auto _ : state)
+  {
+    spi.transfer(tx, rx, sizeof(tx));
+    benchmark::DoNotOptimize(rx);
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(tx));
+}
+BENCHMARK(BM_EmulatorRdata);
+
+// One byte at a time through the per-byte interface
+static void BM_EmulatorNopBytes(benchmark::State &state)
+{
+  SpiEmulator spi;
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(spi.transfer(ADS114S08_CMD::NOP));
+  }
+  state.SetBytesProcessed(state.iterations());
+}
+BENCHMARK(BM_EmulatorNopBytes);
+
+// Signal engine: a DC + sine + noise input generated a block at a time, parameterized by block
+// size. Block size 1 is what evaluating one sample per conversion would cost.
+static void BM_SignalGenerate(benchmark::State &state)
+{
+  SignalEngine          engine;
+  const SignalComponent mix[] = {SignalComponent::dc(0x8000), SignalComponent::sine(0x2000, 50),
+                                 SignalComponent::noise(8, 1)};
+  engine.set_source(0, mix, 3);
+
+  const size_t   block_size = static_cast<size_t>(state.range(0));
+  const uint64_t step       = ADS114S08_DATARATE::PERIOD_NANOS[0x0d];
+  uint16_t       block[256];
+  uint64_t       t = 0;
+
+  for (auto _ : state)
+  {
+    engine.generate(0, t, step, block, block_size);
+    benchmark::DoNotOptimize(block);
+    t += block_size * step;
+  }
+  state.SetItemsProcessed(state.iterations() * block_size);
+}
+BENCHMARK(BM_SignalGenerate)->RangeMultiplier(4)->Range(1, 256);
+
+// Continuous conversion on that input at 4000 SPS: simulated time advanced one conversion period
+// at a time, each conversion drawn from the emulator's block of generated samples (INPMUX resets
+// to AIN0, so that's the input)
+static void BM_EmulatorConversions(benchmark::State &state)
+{
+  SpiEmulator           spi;
+  const SignalComponent mix[] = {SignalComponent::dc(0x8000), SignalComponent::sine(0x2000, 50),
+                                 SignalComponent::noise(8, 1)};
+  spi.get_signals().set_source(0, mix, 3);
+
+  const uint8_t setup[] = {ADS114S08_CMD::WREG_1ST | ADS114S08_REGISTERS::DATARATE, 0x00,
+                           ADS114S08_DATARATE::FILTER | 0x0d, ADS114S08_CMD::START};
+  spi.transfer(setup, nullptr, sizeof(setup));
+
+  const uint32_t period = ADS114S08_DATARATE::PERIOD_NANOS[0x0d];
+  for (auto _ : state)
+  {
+    spi.advance_time(period);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EmulatorConversions);
@@ -0,0 +1,167 @@
+// The device's configuration as typed fields instead of register bytes
+//
+// AdcConfig covers everything from INPMUX through SYS: the input mux, PGA, data rate and
+// filter, reference, excitation currents, bias voltage and system control. Those eight
+// registers sit next to each other in the register map, so the driver can write a whole
+// configuration with one WREG and check it with one RREG (BasicDeviceDriver::apply_config()).
+// Switching between configurations from one scan phase to the next costs two frames, not a
+// write and a readback per register.
+//
+// Fields hold the register codes, not physical units: gain is the GAIN code (gain 2^gain),
+// data_rate the DR code (see ADS114S08_DATARATE::PERIOD_NANOS), and so on. A default-constructed
+// AdcConfig is the device's power-up / RESET state.
+//
+// encode() and decode() are constexpr, so a configuration fixed at compile time is encoded at
+// compile time too:
+//
+//   constexpr AdcConfig BRIDGE = [] {
+//     AdcConfig config;
+//     config.ch_plus     = 2;
+//     config.ch_minus    = 3;
+//     config.pga_enabled = true;
+//     config.gain        = 7;
+//     return config;
+//   }();
+//   static_assert(AdcConfig::encode(BRIDGE)[0] == 0x23);
+
+#ifndef ADC_CONFIG_DOT_AITCH
+#define ADC_CONFIG_DOT_AITCH
+
+#include <array>
+#include <stdint.h>
+
+#include "adc_constants.h"
+
+struct AdcConfig
+{
+    // INPMUX .. SYS, in register order
+    inline static constexpr uint8_t FIRST_REGISTER = ADS114S08_REGISTERS::INPMUX;
+    inline static constexpr uint8_t NUM_REGISTERS  = ADS114S08_REGISTERS::SYS - ADS114S08_REGISTERS::INPMUX + 1;
+    using Registers                                = std::array<uint8_t, NUM_REGISTERS>;
+
+    // INPMUX: mux codes (0 - 11 = AIN0 - AIN11, ADS114S08_INPMUX::AINCOM)
+    uint8_t ch_plus  = 0;
+    uint8_t ch_minus = 1;
+
+    // PGA
+    uint8_t delay       = 0; // Conversion start delay code, DELAY[2:0]
+    bool    pga_enabled = false;
+    uint8_t gain        = 0; // Gain 2^gain, 0 - 7; only counts with the PGA enabled
+
+    // DATARATE
+    bool    global_chop    = false;
+    bool    external_clock = false;
+    bool    single_shot    = false;
+    bool    low_latency    = true; // Low-latency filter rather than sinc3
+    uint8_t data_rate      = 4;    // DR[3:0]: 20 SPS
+
+    // REF
+    uint8_t ref_monitor = 0;     // FL_REF_EN[1:0]
+    bool    refp_buffer = true;  // Positive reference buffer in use
+    bool    refn_buffer = false; // Negative reference buffer in use
+    uint8_t ref_select  = 0;     // REFSEL[1:0]: REF0, REF1, internal
+    uint8_t ref_control = 0;     // REFCON[1:0]: internal reference off, on but powers down, always on
+
+    // IDACMAG
+    bool    rail_flags      = false; // FL_RAIL_EN
+    bool    low_side_switch = false; // PSW
+    uint8_t idac_magnitude  = 0;     // IMAG[3:0] - see ADS114S08_IDACMAG::IMAG_MASK
+
+    // IDACMUX: mux codes, or ADS114S08_IDACMUX::DISCONNECTED
+    uint8_t idac1_mux = ADS114S08_IDACMUX::DISCONNECTED;
+    uint8_t idac2_mux = ADS114S08_IDACMUX::DISCONNECTED;
+
+    // VBIAS
+    bool    vbias_twelfth = false; // (AVDD + AVSS) / 12 rather than / 2
+    uint8_t vbias_inputs  = 0;     // VB_AINC, VB_AIN5 .. VB_AIN0 as bits 6 .. 0
+
+    // SYS
+    uint8_t sys_monitor = 0; // SYS_MON[2:0]
+    uint8_t cal_samples = 2; // CAL_SAMP[1:0]: 1, 4, 8 or 16 conversions averaged by calibration
+    bool    spi_timeout = false;
+    bool    crc         = false;
+    bool    sendstat    = false;
+
+    // INPMUX .. SYS as the device holds them. Fields wider than their register field are cut
+    // down to it.
+    static constexpr Registers encode(const AdcConfig &config)
+    {
+      return {
+          static_cast<uint8_t>((config.ch_plus & 0x0f) << 4 | (config.ch_minus & 0x0f)),
+
+          static_cast<uint8_t>((config.delay << 5 & ADS114S08_PGA::DELAY_MASK) |
+                               (config.pga_enabled ? ADS114S08_PGA::PGA_EN : 0) | (config.gain & ADS114S08_PGA::GAIN_MASK)),
+
+          static_cast<uint8_t>((config.global_chop ? ADS114S08_DATARATE::G_CHOP : 0) |
+                               (config.external_clock ? ADS114S08_DATARATE::CLK : 0) |
+                               (config.single_shot ? ADS114S08_DATARATE::MODE : 0) |
+                               (config.low_latency ? ADS114S08_DATARATE::FILTER : 0) |
+                               (config.data_rate & ADS114S08_DATARATE::DR_MASK)),
+
+          static_cast<uint8_t>((config.ref_monitor << 6 & ADS114S08_REF::FL_REF_EN_MASK) |
+                               (config.refp_buffer ? 0 : ADS114S08_REF::NOT_REFP_BUF) |
+                               (config.refn_buffer ? 0 : ADS114S08_REF::NOT_REFN_BUF) |
+                               (config.ref_select << 2 & ADS114S08_REF::REFSEL_MASK) |
+                               (config.ref_control & ADS114S08_REF::REFCON_MASK)),
+
+          static_cast<uint8_t>((config.rail_flags ? ADS114S08_IDACMAG::FL_RAIL_EN : 0) |
+                               (config.low_side_switch ? ADS114S08_IDACMAG::PSW : 0) |
+                               (config.idac_magnitude & ADS114S08_IDACMAG::IMAG_MASK)),
+
+          static_cast<uint8_t>((config.idac2_mux & 0x0f) << 4 | (config.idac1_mux & 0x0f)),
+
+          static_cast<uint8_t>((config.vbias_twelfth ? ADS114S08_VBIAS::VB_LEVEL : 0) |
+                               (config.vbias_inputs & (ADS114S08_VBIAS::VB_AINC | ADS114S08_VBIAS::VB_AIN_MASK))),
+
+          static_cast<uint8_t>((config.sys_monitor << 5 & ADS114S08_SYS::SYS_MON_MASK) |
+                               (config.cal_samples << 3 & ADS114S08_SYS::CAL_SAMP_MASK) |
+                               (config.spi_timeout ? ADS114S08_SYS::TIMEOUT : 0) | (config.crc ? ADS114S08_SYS::CRC : 0) |
+                               (config.sendstat ? ADS114S08_SYS::SENDSTAT : 0)),
+      };
+    }
+
+    // Back from INPMUX .. SYS (regs[0] is INPMUX)
+    static constexpr AdcConfig decode(const uint8_t *regs)
+    {
+      AdcConfig config;
+      config.ch_plus  = regs[0] >> 4;
+      config.ch_minus = regs[0] & 0x0f;
+
+      config.delay       = (regs[1] & ADS114S08_PGA::DELAY_MASK) >> 5;
+      config.pga_enabled = (regs[1] & ADS114S08_PGA::PGA_EN_MASK) == ADS114S08_PGA::PGA_EN;
+      config.gain        = regs[1] & ADS114S08_PGA::GAIN_MASK;
+
+      config.global_chop    = regs[2] & ADS114S08_DATARATE::G_CHOP;
+      config.external_clock = regs[2] & ADS114S08_DATARATE::CLK;
+      config.single_shot    = regs[2] & ADS114S08_DATARATE::MODE;
+      config.low_latency    = regs[2] & ADS114S08_DATARATE::FILTER;
+      config.data_rate      = regs[2] & ADS114S08_DATARATE::DR_MASK;
+
+      config.ref_monitor = (regs[3] & ADS114S08_REF::FL_REF_EN_MASK) >> 6;
+      config.refp_buffer = !(regs[3] & ADS114S08_REF::NOT_REFP_BUF);
+      config.refn_buffer = !(regs[3] & ADS114S08_REF::NOT_REFN_BUF);
+      config.ref_select  = (regs[3] & ADS114S08_REF::REFSEL_MASK) >> 2;
+      config.ref_control = regs[3] & ADS114S08_REF::REFCON_MASK;
+
+      config.rail_flags      = regs[4] & ADS114S08_IDACMAG::FL_RAIL_EN;
+      config.low_side_switch = regs[4] & ADS114S08_IDACMAG::PSW;
+      config.idac_magnitude  = regs[4] & ADS114S08_IDACMAG::IMAG_MASK;
+
+      config.idac2_mux = regs[5] >> 4;
+      config.idac1_mux = regs[5] & 0x0f;
+
+      config.vbias_twelfth = regs[6] & ADS114S08_VBIAS::VB_LEVEL;
+      config.vbias_inputs  = regs[6] & (ADS114S08_VBIAS::VB_AINC | ADS114S08_VBIAS::VB_AIN_MASK);
+
+      config.sys_monitor = (regs[7] & ADS114S08_SYS::SYS_MON_MASK) >> 5;
+      config.cal_samples = (regs[7] & ADS114S08_SYS::CAL_SAMP_MASK) >> 3;
+      config.spi_timeout = regs[7] & ADS114S08_SYS::TIMEOUT;
+      config.crc         = regs[7] & ADS114S08_SYS::CRC;
+      config.sendstat    = regs[7] & ADS114S08_SYS::SENDSTAT;
+      return config;
+    }
+
+    static constexpr AdcConfig decode(const Registers &regs) { return decode(regs.data()); }
+};
+
+#endif
@@ -16,14 +16,193 @@ static constexpr uint8_t DRDY_BAR      = 0x0F;
 // Timing values
 namespace ADS114S08_TIMING
 {
-static constexpr float nS_TO_mS           = 1000.0;
-// You're gonna need the datasheet for your MCU to find its clock frequency
-static constexpr long TICKS_PER_UNIT_TIME = 1;
-static constexpr long TD_SCCS             = 20;  // nS
-static constexpr long TD_CSSC             = 20;  // nS
-static constexpr long T_CLK               = 245; // 1 / 244.140625 nS = 4.096 MHz
+static constexpr long mS_TO_nS                = 1000000;
+static constexpr long TD_SCCS                 = 20;  // nS
+static constexpr long TD_CSSC                 = 20;  // nS
+static constexpr long T_CLK                   = 245; // 1 / 244.140625 nS = 4.096 MHz
+static constexpr long T_SCLK                  = 100; // nS, fastest SCLK the device accepts
+// tMOD = 16 tCLK = 3906.25 nS, the modulator clock period the conversion start delay counts in
+static constexpr uint64_t t_mod_nanos(uint32_t periods)
+{
+  return static_cast<uint64_t>(periods) * 15625 / 4;
+}
+static constexpr long POWERUP_SETTLING_NANOS  = 22 * mS_TO_nS / 10; // 2.2 mS
+static constexpr long RESET_DELAY_NANOS       = T_CLK * 4096;
+// Waiting for the RDY bit: the first STATUS poll goes out straight away, and the wait before each
+// one after that doubles from the minimum up to the maximum, so a device that's already up costs
+// one read and a cold one is caught within READY_POLL_MAX_NANOS of coming up. After
+// READY_TIMEOUT_NANOS it isn't coming.
+static constexpr long READY_POLL_MIN_NANOS = 10000;  // 10 uS
+static constexpr long READY_POLL_MAX_NANOS = 250000; // 250 uS
+static constexpr long READY_TIMEOUT_NANOS  = 10 * POWERUP_SETTLING_NANOS;
 }; // namespace ADS114S08_TIMING
 
+// Device status register (STATUS) flags - datasheet p. 72
+namespace ADS114S08_STATUS
+{
+static constexpr uint8_t FL_POR = 0x80; // A power-on reset has happened since this was last cleared
+static constexpr uint8_t RDY    = 0x20; // 1 = not ready for communication yet
+}; // namespace ADS114S08_STATUS
+
+// Data rate register (DATARATE) fields - datasheet p. 75
+namespace ADS114S08_DATARATE
+{
+static constexpr uint8_t G_CHOP  = 0x80; // Global chop enable
+static constexpr uint8_t CLK     = 0x40; // 1 = external clock
+static constexpr uint8_t MODE    = 0x20; // 0 = continuous conversion, 1 = single-shot
+static constexpr uint8_t FILTER  = 0x10; // 0 = sinc3, 1 = low-latency
+static constexpr uint8_t DR_MASK = 0x0f;
+
+// Conversion period (nS) for each DR[3:0] setting: 2.5, 5, 10, 16.6, 20, 50, 60, 100, 200,
+// 400, 800, 1000, 2000, 4000, 4000 SPS (1111 is reserved, treat it like the fastest rate)
+static constexpr uint32_t PERIOD_NANOS[16] = {400000000, 200000000, 100000000, 60000000,
+                                              50000000,  20000000,  16666667,  10000000,
+                                              5000000,   2500000,   1250000,   1000000,
+                                              500000,    250000,    250000,    250000};
+
+// The filter's share of the time from a conversion (re)start to the first settled result: one
+// conversion period with the low-latency filter, three with the sinc3 filter. The start delay
+// comes on top - see ADS114S08_CONVERSION.
+static constexpr uint64_t settling_nanos(uint8_t datarate_reg)
+{
+  return static_cast<uint64_t>(PERIOD_NANOS[datarate_reg & DR_MASK]) * ((datarate_reg & FILTER) ? 1 : 3);
+}
+}; // namespace ADS114S08_DATARATE
+
+// INPMUX codes - datasheet p. 73: 0000 - 1011 = AIN0 - AIN11, 1100 = AINCOM, the rest reserved
+namespace ADS114S08_INPMUX
+{
+static constexpr uint8_t AINCOM = 0x0c;
+}; // namespace ADS114S08_INPMUX
+
+// Gain setting register (PGA) fields - datasheet p. 74
+namespace ADS114S08_PGA
+{
+static constexpr uint8_t DELAY_MASK  = 0xe0; // Conversion start delay
+static constexpr uint8_t PGA_EN_MASK = 0x18; // 00 = PGA bypassed (gain 1), 01 = enabled, 1x reserved
+static constexpr uint8_t PGA_EN      = 0x08;
+static constexpr uint8_t GAIN_MASK   = 0x07; // Gain 2^GAIN: 1, 2, 4 ... 128
+
+// Gain actually applied to the input: GAIN only counts with the PGA enabled
+static constexpr uint8_t gain(uint8_t pga_reg)
+{
+  return ((pga_reg & PGA_EN_MASK) == PGA_EN) ? static_cast<uint8_t>(1u << (pga_reg & GAIN_MASK)) : 1;
+}
+
+// Conversion start delay for each DELAY[2:0] setting, in tMOD: the wait after a (re)start before
+// the filter starts on the input, for the PGA and input to settle
+static constexpr uint16_t DELAY_TMOD[8] = {14, 25, 64, 256, 1024, 2048, 4096, 1};
+
+static constexpr uint64_t delay_nanos(uint8_t pga_reg)
+{
+  return ADS114S08_TIMING::t_mod_nanos(DELAY_TMOD[(pga_reg & DELAY_MASK) >> 5]);
+}
+}; // namespace ADS114S08_PGA
+
+// When conversion results come out (datasheet, Conversion Latency and Global Chop Mode). A
+// (re)start - START, or a write to a configuration register while converting - waits out the
+// start delay in PGA and then the filter's settling time; in continuous mode, results follow one
+// data rate period apart after that. Global chop swaps the inputs and restarts the
+// conversion for each result and averages it with the one before, so every result costs a whole
+// delay plus settling, and the first needs two of them.
+namespace ADS114S08_CONVERSION
+{
+static constexpr uint64_t first_result_nanos(uint8_t datarate_reg, uint8_t pga_reg)
+{
+  const uint64_t restart = ADS114S08_PGA::delay_nanos(pga_reg) + ADS114S08_DATARATE::settling_nanos(datarate_reg);
+  return (datarate_reg & ADS114S08_DATARATE::G_CHOP) ? 2 * restart : restart;
+}
+
+static constexpr uint64_t result_period_nanos(uint8_t datarate_reg, uint8_t pga_reg)
+{
+  return (datarate_reg & ADS114S08_DATARATE::G_CHOP)
+             ? ADS114S08_PGA::delay_nanos(pga_reg) + ADS114S08_DATARATE::settling_nanos(datarate_reg)
+             : ADS114S08_DATARATE::PERIOD_NANOS[datarate_reg & ADS114S08_DATARATE::DR_MASK];
+}
+}; // namespace ADS114S08_CONVERSION
+
+// Reference control register (REF) fields - datasheet p. 76
+namespace ADS114S08_REF
+{
+static constexpr uint8_t FL_REF_EN_MASK = 0xc0; // Reference monitor
+static constexpr uint8_t NOT_REFP_BUF   = 0x20; // 1 = positive reference buffer bypassed
+static constexpr uint8_t NOT_REFN_BUF   = 0x10; // 1 = negative reference buffer bypassed
+static constexpr uint8_t REFSEL_MASK    = 0x0c;
+static constexpr uint8_t REFSEL_REF0    = 0x00; // REFP0 - REFN0
+static constexpr uint8_t REFSEL_REF1    = 0x04; // REFP1 - REFN1
+static constexpr uint8_t REFSEL_INT     = 0x08; // Internal 2.5 V reference (0x0c is reserved)
+static constexpr uint8_t REFCON_MASK    = 0x03; // Internal reference off / on but powers down / always on
+
+static constexpr double INTERNAL_REF_VOLTS = 2.5;
+}; // namespace ADS114S08_REF
+
+// Excitation current register 1 (IDACMAG) fields - datasheet p. 77
+namespace ADS114S08_IDACMAG
+{
+static constexpr uint8_t FL_RAIL_EN = 0x80; // PGA output rail flag enable
+static constexpr uint8_t PSW        = 0x40; // Low-side power switch closed
+static constexpr uint8_t IMAG_MASK  = 0x0f; // Off, 10, 50, 100, 250, 500, 750, 1000, 1500, 2000 uA
+}; // namespace ADS114S08_IDACMAG
+
+// Excitation current register 2 (IDACMUX) fields - datasheet p. 78: each a mux code like INPMUX's
+// (0000 - 1011 = AIN0 - AIN11, 1100 = AINCOM), 1101 - 1111 = disconnected
+namespace ADS114S08_IDACMUX
+{
+static constexpr uint8_t I2MUX_MASK   = 0xf0;
+static constexpr uint8_t I1MUX_MASK   = 0x0f;
+static constexpr uint8_t DISCONNECTED = 0x0f;
+}; // namespace ADS114S08_IDACMUX
+
+// Sensor biasing register (VBIAS) fields - datasheet p. 79
+namespace ADS114S08_VBIAS
+{
+static constexpr uint8_t VB_LEVEL    = 0x80; // 0 = (AVDD + AVSS) / 2, 1 = (AVDD + AVSS) / 12
+static constexpr uint8_t VB_AINC     = 0x40; // Bias voltage on AINCOM
+static constexpr uint8_t VB_AIN_MASK = 0x3f; // Bias voltage on AIN5 .. AIN0, one bit each
+}; // namespace ADS114S08_VBIAS
+
+// System control register (SYS) fields - datasheet p. 80
+namespace ADS114S08_SYS
+{
+static constexpr uint8_t SYS_MON_MASK  = 0xe0; // System monitor input
+static constexpr uint8_t CAL_SAMP_MASK = 0x18; // Samples averaged by the calibration commands
+static constexpr uint8_t TIMEOUT       = 0x04; // SPI timeout enable
+static constexpr uint8_t CRC           = 0x02; // Append a CRC byte to conversion data
+static constexpr uint8_t SENDSTAT      = 0x01; // Prepend the STATUS byte to conversion data
+
+// Bytes in a conversion data readback (RDATA or direct read) with the given SYS setting:
+// [STATUS] MSB LSB [CRC]
+static constexpr uint8_t data_frame_bytes(uint8_t sys_reg)
+{
+  return 2 + ((sys_reg & SENDSTAT) ? 1 : 0) + ((sys_reg & CRC) ? 1 : 0);
+}
+static constexpr uint8_t MAX_DATA_FRAME_BYTES = 4;
+
+// Conversions averaged by SYOCAL, SYGCAL and SFOCAL: 1, 4, 8 or 16
+static constexpr uint8_t calibration_samples(uint8_t sys_reg)
+{
+  return ((sys_reg & CAL_SAMP_MASK) >> 3) ? static_cast<uint8_t>(2u << ((sys_reg & CAL_SAMP_MASK) >> 3)) : 1;
+}
+static constexpr uint8_t MAX_CALIBRATION_SAMPLES = 16;
+
+// Time a calibration command takes: the filter settles, then the averaged conversions follow one
+// period apart. Conversions start over once it's done.
+static constexpr uint64_t calibration_nanos(uint8_t datarate_reg, uint8_t sys_reg)
+{
+  return ADS114S08_DATARATE::settling_nanos(datarate_reg) +
+         static_cast<uint64_t>(ADS114S08_DATARATE::PERIOD_NANOS[datarate_reg & ADS114S08_DATARATE::DR_MASK]) *
+             (calibration_samples(sys_reg) - 1);
+}
+}; // namespace ADS114S08_SYS
+
+// Offset and gain calibration registers (OFCAL0/1, FSCAL0/1): both 16 bits, low byte first.
+// Every conversion result comes out as (result - OFCAL) * FSCAL / 4000h, so OFCAL is a two's
+// complement code and FSCAL = 4000h is a gain of one.
+namespace ADS114S08_CAL
+{
+static constexpr uint16_t FSCAL_UNITY = 0x4000;
+}; // namespace ADS114S08_CAL
+
 // ADC Commands - datasheet p. 63
 namespace ADS114S08_CMD
 {
@@ -68,6 +247,31 @@ static constexpr uint8_t FSCAL0    = 0x0E;
 static constexpr uint8_t FSCAL1    = 0x0F;
 static constexpr uint8_t GPIODAT   = 0x10;
 static constexpr uint8_t GPIOCON   = 0x11;
+
+static constexpr uint8_t NUM_REGISTERS = 18;
+
+// Register contents after power-up or RESET - datasheet p. 70
+// (ID reads 0x04 on an ADS114S08; it's read-only, so RESET leaves it alone on real hardware)
+static constexpr uint8_t RESET_VALUES[NUM_REGISTERS] = {
+    0x04, // ID
+    0x80, // STATUS (FL_POR set)
+    0x01, // INPMUX
+    0x00, // PGA
+    0x14, // DATARATE
+    0x10, // REF
+    0x00, // IDACMAG
+    0xff, // IDAC_MUX
+    0x00, // VBIAS
+    0x10, // SYS
+    0x00, // RESERVED0
+    0x00, // OFCAL0
+    0x00, // OFCAL1
+    0x00, // RESERVED1
+    0x00, // FSCAL0
+    0x40, // FSCAL1
+    0x00, // GPIODAT
+    0x00, // GPIOCON
+};
 }; // namespace ADS114S08_REGISTERS
 
 #endif
@@ -2,9 +2,11 @@
 #define ADC_EMULATOR_DOT_AITCH
 
 #include <array>
-#include <list>
+#include <stddef.h>
 #include <stdint.h>
-#include <unordered_map>
+
+#include "adc_constants.h"
+#include "signal_engine.h"
 
 class ADS114S08_Emulator
 {
@@ -20,15 +22,36 @@ class ADS114S08_Emulator
     // For storing the first byte of two-byte combos (i.e. RREG and WREG)
     uint8_t input_register;
 
-    // Magic number from datasheet. Defined as a constant in DeviceDriver
-    std::array<uint8_t, 18>  reg_addrs;
-    std::list<uint8_t>       output_buffer;
-    std::array<uint16_t, 12> FAKE_VOLTAGES;
+    // Flat register file, indexed by register address
+    std::array<uint8_t, ADS114S08_REGISTERS::NUM_REGISTERS> registers;
+
+    // What's on the analog inputs, as a function of simulated time
+    SignalEngine signals;
+
+    // Conversion results for the current mux setting are generated a block at a time, one
+    // conversion period apart, and used up one per conversion until the mux, rate or signals
+    // change. signal_block_minus holds the negative input's samples while a block is worked out.
+    static constexpr uint8_t               SIGNAL_BLOCK_SIZE = 64;
+    std::array<uint16_t, SIGNAL_BLOCK_SIZE> signal_block;
+    std::array<uint16_t, SIGNAL_BLOCK_SIZE> signal_block_minus;
+    uint8_t                                signal_block_pos;
+    uint8_t                                signal_block_len;
+    uint8_t                                signal_block_mux;
+    uint32_t                               signal_block_generation;
+    uint64_t                               signal_block_next_nanos;
+    uint64_t                               signal_block_step_nanos;
 
-    std::unordered_map<uint8_t, uint8_t> registers;
+    // Bytes queued up to be clocked out on CIPO (e.g. RDATA results). Tiny fixed FIFO; the
+    // longest thing we ever queue is a conversion result
+    static constexpr uint8_t   OUTPUT_FIFO_SIZE = 8;
+    std::array<uint8_t, OUTPUT_FIFO_SIZE> output_fifo;
+    uint8_t                               output_head;
+    uint8_t                               output_count;
 
-    volatile uint16_t storage_buffer;
-    uint16_t          generate_adc_value();
+    void push_output(uint8_t data);
+    uint8_t pop_output(void);
+
+    uint16_t generate_adc_value();
 
     uint8_t simulate_spi_read(void);
     void    simulate_spi_write(uint8_t data);
@@ -36,17 +59,115 @@ class ADS114S08_Emulator
 
     void store_new_data(uint8_t data);
     void handle_two_byte_command(uint8_t data);
-    void handle_rdata_command(void);
 
-    bool simulate_startup_delay;
+    // Command decoding is one table lookup on the first command byte - see datasheet p. 63
+    using CommandHandler = void (ADS114S08_Emulator::*)(uint8_t data);
+    static const std::array<CommandHandler, 256> command_table;
+    static constexpr std::array<CommandHandler, 256> build_command_table(void);
+
+    void handle_ignored_command(uint8_t data);
+    void handle_reset_command(uint8_t data);
+    void handle_start_command(uint8_t data);
+    void handle_stop_command(uint8_t data);
+    void handle_rdata_command(uint8_t data);
+    void handle_register_command(uint8_t data);
+    void handle_calibration_command(uint8_t data);
+
+    // STATUS reads RDY = 1 (not ready) until this much simulated time after power-up; 0 once it's up
+    uint64_t ready_nanos;
+
+    // Conversions under way (START / STOP) - see datasheet p. 64. In single-shot mode (MODE in
+    // DATARATE) converting clears again once the conversion completes.
+    bool     converting;
+    uint64_t elapsed_nanos;
+    uint64_t next_conversion_nanos;
+    bool     advancing;
+
+    // The last completed conversion (what RDATA returns while converting), and the same
+    // result waiting in the output shift register for a direct read, framed the way SYS said
+    // when it was loaded
+    uint16_t conversion_data;
+    std::array<uint8_t, ADS114S08_SYS::MAX_DATA_FRAME_BYTES> output_shift_register;
+    uint8_t                                                  output_shift_bytes;
+    uint8_t                                                  direct_read_bytes;
+
+    // [STATUS] MSB LSB [CRC], per the SENDSTAT and CRC bits in SYS. Returns the frame length
+    uint8_t build_data_frame(uint16_t value, uint8_t *frame);
+
+    // Stands in for the DRDY pin's falling edge
+    void (*drdy_isr)(void *);
+    void *drdy_isr_context;
+
+    // The DRDY pin: low from a completed conversion until its data is read (RDATA or the first
+    // byte of a direct read) or conversions restart
+    bool     drdy_low;
+    uint32_t completed_conversions;
+
+    // RDATA in standby returns the last completed conversion, as the device does, rather than
+    // converting the inputs on the spot (which is the shortcut when this is off)
+    bool timing_accurate;
+
+    // Set by a WREG touching INPMUX..IDAC_MUX; conversion restarts once the WREG completes
+    bool restart_pending;
+
+    // The converter's own offset (in codes) and gain error, which calibration is there to take
+    // out. A property of the part rather than of its registers, so RESET leaves them alone.
+    int16_t offset_error;
+    double  gain_error;
+
+    // What the ID register holds after RESET: which member of the family this is
+    uint8_t device_id;
+
+    // Input code -> what the converter makes of it (errors) -> what comes out (OFCAL and FSCAL)
+    uint16_t apply_conversion_errors(uint16_t input);
+    uint16_t apply_calibration(uint16_t result);
+
+    uint8_t  selected_mux(void);
+    void     generate_mux(uint8_t mux, uint64_t t0_nanos, uint64_t step_nanos, uint16_t *dest, uint8_t num_samples);
+    uint16_t sample_input(void);
+    uint16_t convert_input_at(uint64_t t_nanos);
+    uint32_t conversion_period_nanos(void);
+    void     restart_conversion(void);
+    void     complete_conversion(uint64_t t_nanos);
 
   public:
     ADS114S08_Emulator(uint8_t *const copi, uint8_t *const cipo, bool simulate_startup_delay = false);
 
     void simulate_op();
+    // simulate_op() once per byte of a whole frame; rx may be nullptr
+    void simulate_frame(const uint8_t *tx, uint8_t *rx, size_t len);
     void reset();
+    void reset_registers();
+
+    // Let simulated time pass. While converting, every completed conversion is latched into
+    // the output shift register and DRDY fires (i.e. the attached ISR gets called)
+    void advance_time(uint64_t nanos);
+    void attach_drdy_isr(void (*isr)(void *), void *context);
+    bool is_converting() { return converting; }
+    bool is_drdy_low() { return drdy_low; }
+    // Conversions completed since power-up, read or not
+    uint32_t get_conversions() { return completed_conversions; }
+
+    // On by default: in standby, RDATA returns the last conversion that completed, stale or not,
+    // so a driver has to START one (single-shot or continuous) and wait for it like it would on
+    // the real part. Off, RDATA converts the selected inputs there and then, which saves the
+    // tests that only want a reading a START and a wait.
+    void set_timing_accurate(bool on) { timing_accurate = on; }
+
+    // Configure the analog inputs. After reset() each one is a different flat DC level.
+    SignalEngine &get_signals() { return signals; }
+
+    // What input idx reads right now
+    uint16_t get_raw_adc_test_val(uint8_t idx) { return signals.sample(idx, elapsed_nanos); }
+    // Offset and gain error of the emulated converter (none by default)
+    void set_conversion_errors(int16_t offset_codes, double gain);
+    // Make this part identify as another member of the family (ID 0x05 for an ADS114S06; 0x04,
+    // an ADS114S08, by default). Only the ID register changes: every input still reads.
+    void set_device_id(uint8_t id);
 
-    uint16_t get_raw_adc_test_val(uint8_t idx) { return FAKE_VOLTAGES.at(idx); }
+    // What a conversion of ch_plus against ch_minus would give right now, errors and calibration
+    // included
+    uint16_t get_differential_test_val(uint8_t ch_plus, uint8_t ch_minus);
 };
 
 #endif
@@ -0,0 +1,185 @@
+// Non-blocking access to the devices on a SpiBus: requests are queued and moved along together
+//
+// Every DeviceDriver call blocks its caller until the bus work - and any settling time in
+// between - is done, so one thread serving many devices spends most of its time waiting on one
+// of them while the rest sit idle. AsyncBus takes reads, register transfers and scans as
+// requests instead. submit_*() queues one and hands back a ticket straight away, without
+// touching the bus; poll() then does whatever bus work is due, across every device, one
+// transaction at a time, earliest deadline first. A request that has to let a conversion settle
+// just gets a deadline, and the bus serves the other devices until then.
+//
+//   AsyncBus      async(bus);
+//   const uint8_t adc = async.add_device(driver);
+//   async.submit_read_input(adc, 3);
+//   ...
+//   while (async.get_pending())
+//   {
+//     async.wait();
+//     while (async.get_completion(done)) { ... }
+//   }
+//
+// Each device's requests complete in the order they were submitted; different devices' requests
+// overlap. A request with a callback completes by calling it, on the thread running poll();
+// one without goes on the completion queue as an AsyncCompletion. That queue is an SpscRing, so
+// completions can be picked up on another thread. Everything else - adding devices, submitting,
+// polling - belongs to the thread driving the bus, like the SpiBus itself. Several buses can
+// share a thread: poll() each, then sleep until the earliest get_next_deadline().
+//
+// Buffers handed to a request (destinations, scan lists, results) have to stay put until it
+// completes; register data to write is copied. Don't call a driver directly while it has
+// requests pending. Nothing allocates: requests come from a fixed pool of MAX_REQUESTS, and
+// submit_*() returns 0 once it's used up.
+
+#ifndef ASYNC_BUS_DOT_AITCH
+#define ASYNC_BUS_DOT_AITCH
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "adc_constants.h"
+#include "device_driver.h"
+#include "scan_sequencer.h"
+#include "spi_bus.h"
+#include "spsc_ring.h"
+
+enum class AsyncOp : uint8_t
+{
+  READ_REGISTERS = 0,
+  WRITE_REGISTERS,
+  READ_INPUT,
+  SCAN
+};
+
+struct AsyncCompletion
+{
+  uint32_t id;     // Ticket submit_*() returned
+  AsyncOp  op;
+  uint8_t  device; // Index add_device() returned
+  bool     ok;     // False if a conversion read failed its CRC
+  uint16_t value;  // READ_INPUT: the reading. SCAN: the number of readings
+  uint64_t completed_nanos;
+  void    *context; // As passed to submit_*()
+};
+
+using AsyncCallback = void (*)(const AsyncCompletion &completion);
+
+class AsyncBus
+{
+  public:
+    inline static const size_t   MAX_REQUESTS              = 64;
+    inline static const size_t   COMPLETION_QUEUE_CAPACITY = 64;
+    inline static const uint8_t  NO_DEVICE                 = 0xff;
+    inline static const uint64_t NO_DEADLINE               = UINT64_MAX;
+
+    AsyncBus(SpiBus &bus);
+
+    // The driver must be on this bus. Returns its index for submit_*(), or NO_DEVICE if there
+    // are MAX_DEVICES already.
+    uint8_t add_device(DeviceDriver &driver);
+    size_t  get_num_devices(void) { return num_devices; }
+
+    // Each returns the request's ticket, or 0 if the request is no good (unknown device, too many
+    // registers, an input the device doesn't have) or every request slot is taken.
+    // num_regs consecutive registers from start_reg into dest, in one RREG
+    uint32_t submit_read_registers(uint8_t device, uint8_t start_reg, uint8_t num_regs, uint8_t *dest,
+                                   AsyncCallback callback = nullptr, void *context = nullptr);
+    // num_regs bytes from src into consecutive registers from start_reg, in one WREG
+    uint32_t submit_write_registers(uint8_t device, uint8_t start_reg, const uint8_t *src, uint8_t num_regs,
+                                    AsyncCallback callback = nullptr, void *context = nullptr);
+    // One reading of ch_plus against ch_minus. If the device is converting and the mux has to
+    // move, the reading waits for the new input to settle - without holding up the bus. In
+    // standby, it STARTs a conversion on the input, waits for it the same way and reads it out;
+    // in continuous conversion mode (DATARATE.MODE = 0) it then STOPs, leaving the device as it was.
+    uint32_t submit_read_input(uint8_t device, uint8_t ch_plus, uint8_t ch_minus = ADS114S08_INPMUX::AINCOM,
+                               AsyncCallback callback = nullptr, void *context = nullptr);
+    // One pipelined pass over a scan list, as ScanSequencer::scan() does it: results[n] gets entry n.
+    // Leaves the device converting, in continuous mode even if it was set to single-shot.
+    uint32_t submit_scan(uint8_t device, const MuxPair *pairs, size_t num_pairs, uint16_t *results,
+                         AsyncCallback callback = nullptr, void *context = nullptr);
+
+    // Do every bit of bus work that's due now, without waiting for anything. Returns the number
+    // of requests that completed.
+    size_t poll(void);
+    // poll(), waiting (through the bus clock) for the next deadline whenever nothing is due,
+    // until at least one request completes. Returns 0 straight away if nothing can: nothing's
+    // pending, or everything pending is held up by a full completion queue.
+    size_t wait(void);
+    // When poll() next has work to do: now or earlier if it's due, NO_DEADLINE if nothing's pending
+    uint64_t get_next_deadline(void);
+    size_t   get_pending(void) { return pending; }
+
+    // Consumer side of the completion queue; safe on another thread
+    bool   get_completion(AsyncCompletion &completion) { return completions.pop(completion); }
+    size_t get_completions(AsyncCompletion *dest, size_t max_completions)
+    {
+      return completions.pop_bulk(dest, max_completions);
+    }
+
+  private:
+    inline static const uint16_t NO_REQUEST = 0xffff;
+
+    struct Request
+    {
+      uint32_t id;
+      AsyncOp  op;
+      uint8_t  device;
+
+      // READ_REGISTERS / WRITE_REGISTERS
+      uint8_t                                                start_reg;
+      uint8_t                                                num_regs;
+      uint8_t                                               *dest;
+      std::array<uint8_t, DeviceDriver::MAX_BURST_REGISTERS> data;
+
+      // READ_INPUT / SCAN
+      MuxPair        mux;
+      const MuxPair *pairs;
+      size_t         num_pairs;
+      uint16_t      *results;
+
+      // Transactions done so far, and whether every reading among them checked out
+      size_t step;
+      bool   ok;
+      // READ_INPUT: started conversions from standby and has to stop them again
+      bool stop_after;
+
+      AsyncCallback callback;
+      void         *context;
+      // Next request in the device's queue, or in the free list
+      uint16_t next;
+    };
+
+    struct Device
+    {
+      DeviceDriver *driver;
+      uint16_t      head;
+      uint16_t      tail;
+      // The head request's next transaction can't go out before this
+      uint64_t ready_at;
+    };
+
+    IClock &clock;
+
+    std::array<Request, MAX_REQUESTS>       requests;
+    uint16_t                                free_list;
+    std::array<Device, SpiBus::MAX_DEVICES> devices;
+    size_t                                  num_devices;
+    size_t                                  pending;
+    uint32_t                                next_id;
+
+    SpscRing<AsyncCompletion, COMPLETION_QUEUE_CAPACITY> completions;
+
+    // A free slot for device, filled in with everything but the op's own fields; nullptr if
+    // there's no such device or no slot
+    Request *allocate(uint8_t device, AsyncOp op, AsyncCallback callback, void *context);
+    uint32_t enqueue(Request *request);
+
+    // Whether device's head request can go ahead at all: one that completes onto the queue has
+    // to have room there
+    bool can_run(const Device &dev);
+    // One transaction for device's head request. Returns true if that completed it.
+    bool step(Device &dev);
+    void complete(Device &dev, bool ok, uint16_t value);
+};
+
+#endif
@@ -0,0 +1,915 @@
+// Device driver for the ADS114S0x family, specialized at compile time
+//
+//   BasicDeviceDriver<DeviceTraits, Spi>
+//
+// DeviceTraits (device_traits.h) fixes which device this is: its ID, input count, valid mux codes
+// and register defaults are all constexpr, and initialize() checks the ID it reads against them.
+//
+// Spi is the bus, as a static policy: any type with
+//   void init(uint8_t SPI_mode);
+//   void write(uint8_t data);
+//   void transfer(const uint8_t *tx, uint8_t *rx, size_t len);   // rx may be nullptr
+// The driver calls these directly, so with a bus whose methods the compiler can see (a class in a
+// header, or one marked final) every transaction is a plain - or fully inlined - call instead of
+// going through a vtable. On an MCU, hand it the SPI peripheral's own class.
+//
+// DeviceDriver (device_driver.h) is the type-erased flavour: the bus is an ISpiInterface and the
+// device is whichever of the family answers. Everything else in the driver library (sequencers,
+// SpiBus, SharedDeviceDriver) works in terms of that one.
+
+#ifndef BASIC_DEVICE_DRIVER_DOT_AITCH
+#define BASIC_DEVICE_DRIVER_DOT_AITCH
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "adc_config.h"
+#include "adc_constants.h"
+#include "bus_stats.h"
+#include "crc8.h"
+#include "device_traits.h"
+#include "i_clock.h"
+#include "monotonic_clock.h"
+#include "spsc_ring.h"
+#include "trace_log.h"
+
+template <typename Traits, typename Spi> class BasicDeviceDriver
+{
+  public:
+    inline static const uint8_t NUM_REGISTERS = 18;
+    // RREG / WREG count field is 5 bits wide and holds (count - 1)
+    inline static const uint8_t MAX_BURST_REGISTERS = 32;
+    // Samples the DRDY handler can queue before the consumer has to drain them
+    inline static const size_t SAMPLE_RING_CAPACITY = 1024;
+    // All waiting goes through the clock: real time by default, or e.g. the emulator's
+    // VirtualClock so that tests run at full speed with exact simulated latencies
+    BasicDeviceDriver(Spi &spiInterface, IClock &clock = MonotonicClock::instance());
+    ~BasicDeviceDriver() = default;
+
+    uint8_t get_device_id(void);
+    uint8_t get_num_channels(void);
+
+    void reset(void);
+    // Waits for the device to be ready, then resets it and points the mux at AIN0. False if it
+    // never got ready or the ID register doesn't name a device Traits covers (get_num_channels()
+    // is 0 then, and the device is left as it was: no RESET, nothing written).
+    bool initialize(void);
+    // Same, but leaves the device holding config (ID, STATUS and GPIODAT aside) instead. If the
+    // device already holds it - the app restarted, the ADC didn't - there's no RESET and nothing
+    // gets written again: the burst read that checks for readiness is all it takes to find out.
+    // Otherwise it's written after the RESET and read back to check; false if it didn't take.
+    bool initialize(const std::array<uint8_t, NUM_REGISTERS> &config);
+    // Same again, for INPMUX .. SYS only: the rest (OFCAL and FSCAL, say) is whatever the device
+    // holds for a warm start, and the defaults after a RESET
+    bool initialize(const AdcConfig &config);
+    // Whether the last initialize() found its configuration already in place
+    bool was_warm_start(void) { return warm_start; }
+
+    // Whether code is an input (or AINCOM) this device has - see device_traits.h
+    static constexpr bool is_valid_input(uint8_t code) { return Traits::is_valid_input(code); }
+    // Same, against the part initialize() found: AIN6 - AIN11 are valid for ADS114S0x_Traits but
+    // don't exist on an ADS114S06. Until initialize() has identified the part, only AINCOM is.
+    bool has_input(uint8_t code)
+    {
+      return Traits::is_valid_input(code) && ((code >= Traits::NUM_CHANNELS) || (code < num_channels));
+    }
+
+    // Default negative channel = GND. False, with the mux left alone, if either input isn't one
+    // this device has (see has_input()).
+    bool     set_channel(uint8_t ch_plus, uint8_t ch_minus = 0x0c);
+    // Same, for inputs fixed at compile time: a mux code the device doesn't have won't build
+    template <uint8_t CH_PLUS, uint8_t CH_MINUS = ADS114S08_INPMUX::AINCOM> void set_channel(void)
+    {
+      static_assert(Traits::is_valid_input(CH_PLUS) && Traits::is_valid_input(CH_MINUS), "No such input on this device");
+      set_channel(CH_PLUS, CH_MINUS);
+    }
+    uint16_t read_adc_by_rdata_cmd(void);
+
+    // Point the mux at the next input and read out the last completed conversion in one frame.
+    // The new conversion starts before the old result is clocked out, so the two overlap.
+    // Nothing goes out, and the result is 0, if either input isn't one this device has.
+    uint16_t switch_channel_and_read(uint8_t ch_plus, uint8_t ch_minus = 0x0c);
+    // Same, saying whether the frame checked out (see read_adc_by_rdata_cmd(uint16_t &)); false
+    // for an input the device doesn't have, too
+    bool     switch_channel_and_read(uint8_t ch_plus, uint16_t &value);
+    bool     switch_channel_and_read(uint8_t ch_plus, uint8_t ch_minus, uint16_t &value);
+
+    // Write a whole configuration in one WREG burst (only the span that differs from the shadow
+    // goes out) and, with verify, read it back in one RREG burst to check the device holds it.
+    // False if it doesn't.
+    bool      apply_config(const AdcConfig &config, bool verify = true);
+    // The configuration in the shadow registers, staged changes and all
+    AdcConfig get_config(void);
+
+    void    write_register(uint8_t reg, uint8_t value);
+    uint8_t read_register(uint8_t reg);
+
+    // Move a block of consecutive registers in one RREG / WREG command
+    void read_registers(uint8_t start_reg, uint8_t num_reads, uint8_t *dest);
+    void write_registers(uint8_t start_reg, const uint8_t *src, uint8_t num_writes);
+
+    // Continuous conversion mode - see datasheet p. 64 & p. 88
+    void     start_conversions(void);
+    void     stop_conversions(void);
+    bool     is_converting(void) { return converting; }
+    uint16_t read_adc_direct(void);
+
+    // Conversion reads follow the SENDSTAT and CRC bits in SYS: the frame grows to
+    // [STATUS] MSB LSB [CRC], the STATUS byte is kept for get_last_status() and a CRC mismatch is
+    // counted. These overloads also say whether the frame checked out (always true without CRC).
+    bool     read_adc_by_rdata_cmd(uint16_t &value);
+    bool     read_adc_direct(uint16_t &value);
+    uint8_t  get_data_frame_bytes(void) { return ADS114S08_SYS::data_frame_bytes(device_sys); }
+    uint8_t  get_last_status(void) { return last_status.load(std::memory_order_relaxed); }
+    uint32_t get_crc_errors(void) { return crc_errors.load(std::memory_order_relaxed); }
+
+    // Transaction counts, bytes and latencies so far (bus_stats.h), from any thread without a
+    // lock. All zeros unless the library was built with ADS_STATS=1.
+    BusStatsSnapshot get_stats(void) { return bus_stats.snapshot(); }
+    void             reset_stats(void) { bus_stats.reset(); }
+
+    // How long after a (re)start of conversions the first settled result is ready, going by
+    // the current DATARATE and PGA (conversion delay) settings
+    uint64_t get_settling_nanos(void);
+
+    // Calibration commands - see datasheet p. 63. Each one goes out with whatever's staged already
+    // synced, waits out the calibration time and reads back OFCAL and FSCAL, which the device
+    // applies to every result from then on. SYOCAL and SYGCAL measure the selected inputs, so the
+    // system has to be holding them at its zero or full-scale point meanwhile.
+    void     self_offset_calibration(void);
+    void     system_offset_calibration(void);
+    void     system_gain_calibration(void);
+    uint64_t get_calibration_nanos(void);
+    IClock  &get_clock(void) { return clock; }
+
+    // DRDY falling edge: read the new conversion straight out of the output shift register and
+    // queue it. Attach adc_ready_isr (with this driver as its argument) to the DRDY interrupt.
+    void        on_data_ready(void);
+    static void adc_ready_isr(void *driver);
+
+    // Consumer side of the sample ring. Returns the number of samples copied into dest
+    size_t   read_samples(uint16_t *dest, size_t max_samples);
+    size_t   get_queued_samples(void) { return sample_ring.size(); }
+    uint32_t get_dropped_samples(void) { return dropped_samples.load(std::memory_order_relaxed); }
+
+    // Shadow register map. Getters are served from here without touching the bus.
+    uint8_t get_cached_register(uint8_t reg);
+    uint8_t get_active_channel(void);
+
+    // Update the shadow only; the new value goes out on the next sync()
+    void stage_register(uint8_t reg, uint8_t value);
+    // Write every staged (dirty) register, one WREG burst per contiguous dirty range
+    void sync(void);
+    // Re-read the whole register map from the device in one RREG burst
+    void refresh(void);
+    bool is_dirty(void) { return dirty_registers != 0; }
+
+  private:
+    Spi    &spi;
+    IClock &clock;
+    uint8_t        num_channels;
+    bool           converting;
+    bool           warm_start;
+
+    std::array<uint8_t, NUM_REGISTERS> cached_registers;
+    // Bit n set => cached_registers[n] holds a staged value the device hasn't seen yet
+    uint32_t dirty_registers;
+
+    SpscRing<uint16_t, SAMPLE_RING_CAPACITY> sample_ring;
+    std::atomic<uint32_t>                    dropped_samples;
+
+    // SYS as the device has it, which decides the shape of conversion data frames (the shadow
+    // may hold a staged value that hasn't gone out yet)
+    uint8_t               device_sys;
+    std::atomic<uint8_t>  last_status;
+    std::atomic<uint32_t> crc_errors;
+    BusStats              bus_stats;
+
+    // Every transaction goes out through one of these, which is where it gets counted
+    void transfer(BusOp op, const uint8_t *tx, uint8_t *rx, size_t len);
+    void send_command(BusOp op, uint8_t command);
+    // Pull the conversion out of a [STATUS] MSB LSB [CRC] frame; false if the CRC doesn't match
+    bool parse_data_frame(const uint8_t *frame, uint16_t &value);
+
+    void run_calibration(uint8_t command);
+
+    // Bit n set => register n is part of the configuration initialize() was handed
+    inline static const uint32_t ALL_CONFIG_REGISTERS = ((0x01ul << NUM_REGISTERS) - 1) &
+                                                        ~((0x01ul << ADS114S08_REGISTERS::ID) |
+                                                          (0x01ul << ADS114S08_REGISTERS::STATUS) |
+                                                          (0x01ul << ADS114S08_REGISTERS::GPIODAT));
+    inline static const uint32_t ADC_CONFIG_REGISTERS = ((0x01ul << AdcConfig::NUM_REGISTERS) - 1)
+                                                        << AdcConfig::FIRST_REGISTER;
+
+    // initialize(), with config nullptr for a plain reset. config is a whole register image, of
+    // which only config_registers count.
+    bool start_up(const uint8_t *config, uint32_t config_registers);
+    bool wait_for_ready(void);
+    bool holds_configuration(const uint8_t *config, uint32_t config_registers);
+
+    // Registers the device changes on its own (status flags, GPIO inputs) or that can't be written
+    static bool is_volatile(uint8_t reg);
+    void        invalidate_cache(void);
+};
+
+// Chip select belongs to the SPI interface, not the driver: either CS is tied low (one device on
+// the bus), or the interface is a SpiBus device that drives this device's own CS line around each
+// transaction. That way several drivers can share a bus, and buses share no state at all.
+
+// Nothing waits for the device to power up here: initialize() watches the RDY bit instead, so
+// the settling time overlaps whatever the app does in between, and costs nothing at all if the
+// device was up already
+template <typename Traits, typename Spi>
+BasicDeviceDriver<Traits, Spi>::BasicDeviceDriver(Spi &spiInterface, IClock &clock)
+    : spi(spiInterface), clock(clock), num_channels(0), converting(false), warm_start(false), cached_registers{},
+      dirty_registers(0), dropped_samples(0), device_sys(Traits::RESET_VALUES[ADS114S08_REGISTERS::SYS]), last_status(0),
+      crc_errors(0)
+{
+  // If we've only just powered up, the device holds its defaults. We don't know what it is
+  // until initialize() has actually read the ID register, though.
+  invalidate_cache();
+  cached_registers[ADS114S08_REGISTERS::ID] = 0;
+}
+
+// If the CS pin is not tied low permanently, configure the microcontroller GPIO connected to CS as an output;
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::initialize()
+{
+  return start_up(nullptr, 0);
+}
+
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::initialize(const std::array<uint8_t, NUM_REGISTERS> &config)
+{
+  return start_up(config.data(), ALL_CONFIG_REGISTERS);
+}
+
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::initialize(const AdcConfig &config)
+{
+  uint8_t                    image[NUM_REGISTERS] = {0};
+  const AdcConfig::Registers regs                 = AdcConfig::encode(config);
+  memcpy(image + AdcConfig::FIRST_REGISTER, regs.data(), regs.size());
+  return start_up(image, ADC_CONFIG_REGISTERS);
+}
+
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::start_up(const uint8_t *config, uint32_t config_registers)
+{
+  const uint64_t start = clock.now_nanos();
+  warm_start           = false;
+
+  // Configure the SPI interface of the microcontroller to SPI mode 1 (CPOL = 0, CPHA = 1);
+  spi.init(0x01);
+
+  // Pull the whole register map into the shadow copy in one go. That's RDY, the ID and the
+  // configuration to compare against all at once; only a device still powering up needs more.
+  refresh();
+  if (cached_registers[ADS114S08_REGISTERS::STATUS] & ADS114S08_STATUS::RDY)
+  {
+    if (!wait_for_ready())
+    {
+      return false;
+    }
+    refresh();
+  }
+
+  // Make sure it's the device we were built for (or, for DeviceDriver, one of the family)
+  const uint8_t device_id = get_device_id();
+  num_channels            = Traits::num_channels_for_id(device_id);
+  if (!num_channels)
+  {
+    // Not a part this driver knows how to configure, so leave it the way it is
+    ADS_TRACE_ERROR(TraceEvent::UNKNOWN_DEVICE, device_id, Traits::DEVICE_ID);
+    return false;
+  }
+
+  if (config && holds_configuration(config, config_registers))
+  {
+    // Configured already, but it may well still be converting for whoever had it last
+    stop_conversions();
+    warm_start = true;
+  }
+  else
+  {
+    reset();
+    if (config)
+    {
+      for (uint8_t reg = 0; reg < NUM_REGISTERS; ++reg)
+      {
+        if (config_registers & (0x01ul << reg))
+        {
+          stage_register(reg, config[reg]);
+        }
+      }
+    }
+    else
+    {
+      // set_channel(0): AIN0 against AINCOM
+      stage_register(ADS114S08_REGISTERS::INPMUX, (0 << 4) | ADS114S08_INPMUX::AINCOM);
+    }
+  }
+
+  // Clear the FL_POR flag by writing 00h to the status register, so the next power cycle shows.
+  // It goes out in the same burst as the configuration.
+  if (cached_registers[ADS114S08_REGISTERS::STATUS] & ADS114S08_STATUS::FL_POR)
+  {
+    stage_register(ADS114S08_REGISTERS::STATUS, 0x00);
+  }
+  sync();
+
+  // Read the whole register map back in one go and make sure the configuration took
+  bool configured = true;
+  if (config && !warm_start)
+  {
+    refresh();
+    configured = holds_configuration(config, config_registers);
+  }
+
+  ADS_TRACE_INFO(TraceEvent::INITIALIZED, warm_start, static_cast<uint32_t>(clock.now_nanos() - start));
+  (void)start;
+  return configured;
+}
+
+// Poll STATUS until RDY goes low, backing off between polls - see ADS114S08_TIMING
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::wait_for_ready(void)
+{
+  ADS_TRACE_INFO(TraceEvent::WAIT_FOR_READY);
+  const uint64_t start    = clock.now_nanos();
+  uint64_t       interval = ADS114S08_TIMING::READY_POLL_MIN_NANOS;
+  uint8_t        status;
+  while ((status = read_register(ADS114S08_REGISTERS::STATUS)) & ADS114S08_STATUS::RDY)
+  {
+    ADS_TRACE_DEBUG(TraceEvent::STATUS_POLL, status);
+    bus_stats.record_status_poll();
+    if (clock.now_nanos() - start >= static_cast<uint64_t>(ADS114S08_TIMING::READY_TIMEOUT_NANOS))
+    {
+      ADS_TRACE_ERROR(TraceEvent::READY_TIMEOUT, status);
+      return false;
+    }
+    clock.delay_nanos(interval);
+    interval = (2 * interval < static_cast<uint64_t>(ADS114S08_TIMING::READY_POLL_MAX_NANOS))
+                   ? 2 * interval
+                   : ADS114S08_TIMING::READY_POLL_MAX_NANOS;
+  }
+  return true;
+}
+
+// Whether the shadow, fresh from the device, matches config in every one of config_registers
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::holds_configuration(const uint8_t *config, uint32_t config_registers)
+{
+  for (uint8_t reg = 0; reg < NUM_REGISTERS; ++reg)
+  {
+    if ((config_registers & (0x01ul << reg)) && (cached_registers[reg] != config[reg]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Traits, typename Spi>
+uint8_t BasicDeviceDriver<Traits, Spi>::get_num_channels(void)
+{
+  return num_channels;
+}
+
+template <typename Traits, typename Spi>
+uint8_t BasicDeviceDriver<Traits, Spi>::get_device_id(void)
+{
+  return cached_registers[ADS114S08_REGISTERS::ID] & 0x07;
+}
+
+// Positive input currently routed by the mux (as last written or read back)
+template <typename Traits, typename Spi>
+uint8_t BasicDeviceDriver<Traits, Spi>::get_active_channel(void)
+{
+  return cached_registers[ADS114S08_REGISTERS::INPMUX] >> 4;
+}
+
+// Configure input MUX - see datasheet p. 73
+// For single-ended reads, set ch_minus to Analog Common (default). With any other ch_minus the
+// result is the difference between the two inputs, as a two's complement code.
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::set_channel(uint8_t ch_plus, uint8_t ch_minus)
+{
+  if (!has_input(ch_plus) || !has_input(ch_minus))
+  {
+    return false;
+  }
+
+  // High nybble sets positive channel, low nybble sets negative
+  uint8_t set_val = (ch_plus << 4) | (ch_minus & 0x0f);
+  write_register(ADS114S08_REGISTERS::INPMUX, set_val);
+  return true;
+}
+
+// ADC reset - see datasheet p. 88
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::reset(void)
+{
+  send_command(BusOp::RESET, ADS114S08_CMD::RESET);
+  invalidate_cache();
+  converting = false;
+  clock.delay_nanos(ADS114S08_TIMING::RESET_DELAY_NANOS);
+}
+
+// Retrieve data from ADC data-holding register - see datasheet p. 68
+// - Writes from ADC Data-holding register
+// - Can be read at any time
+// - Data output cycles as long as SCLK continues
+template <typename Traits, typename Spi>
+uint16_t BasicDeviceDriver<Traits, Spi>::read_adc_by_rdata_cmd()
+{
+  uint16_t value;
+  (void)read_adc_by_rdata_cmd(value);
+  return value;
+}
+
+// With SENDSTAT there's one more byte ahead of the data, and with CRC one more after it
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::read_adc_by_rdata_cmd(uint16_t &value)
+{
+  const uint8_t tx[1 + ADS114S08_SYS::MAX_DATA_FRAME_BYTES] = {ADS114S08_CMD::RDATA};
+  uint8_t       rx[1 + ADS114S08_SYS::MAX_DATA_FRAME_BYTES] = {0};
+
+  transfer(BusOp::RDATA, tx, rx, 1 + get_data_frame_bytes());
+
+  return parse_data_frame(rx + 1, value);
+}
+
+// Conversion data readback - datasheet p. 69
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::parse_data_frame(const uint8_t *frame, uint16_t &value)
+{
+  const uint8_t *data = frame;
+  if (device_sys & ADS114S08_SYS::SENDSTAT)
+  {
+    last_status.store(*data++, std::memory_order_relaxed);
+  }
+  value = (static_cast<uint16_t>(data[0]) << 8) | data[1];
+
+  if ((device_sys & ADS114S08_SYS::CRC) && !ADS114S08_CRC::check_frame(frame, get_data_frame_bytes()))
+  {
+    const uint32_t errors = crc_errors.fetch_add(1, std::memory_order_relaxed) + 1;
+    ADS_TRACE_ERROR(TraceEvent::CRC_ERROR, errors, value);
+    (void)errors;
+    return false;
+  }
+  return true;
+}
+
+// WREG INPMUX followed by RDATA, back to back with CS held low. Writing INPMUX restarts the
+// conversion on the new input straight away, while the data-holding register keeps the previous
+// result until the new one is done, so RDATA still returns the conversion from before the switch.
+template <typename Traits, typename Spi>
+uint16_t BasicDeviceDriver<Traits, Spi>::switch_channel_and_read(uint8_t ch_plus, uint8_t ch_minus)
+{
+  uint16_t value;
+  (void)switch_channel_and_read(ch_plus, ch_minus, value);
+  return value;
+}
+
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::switch_channel_and_read(uint8_t ch_plus, uint16_t &value)
+{
+  return switch_channel_and_read(ch_plus, ADS114S08_INPMUX::AINCOM, value);
+}
+
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::switch_channel_and_read(uint8_t ch_plus, uint8_t ch_minus, uint16_t &value)
+{
+  if (!has_input(ch_plus) || !has_input(ch_minus))
+  {
+    value = 0;
+    return false;
+  }
+
+  const uint8_t mux = (ch_plus << 4) | (ch_minus & 0x0f);
+  const uint8_t tx[4 + ADS114S08_SYS::MAX_DATA_FRAME_BYTES] = {
+      ADS114S08_CMD::WREG_1ST | ADS114S08_REGISTERS::INPMUX, ADS114S08_CMD::WREG_2ND, mux, ADS114S08_CMD::RDATA};
+  uint8_t rx[4 + ADS114S08_SYS::MAX_DATA_FRAME_BYTES] = {0};
+
+  transfer(BusOp::MUX_AND_RDATA, tx, rx, 4 + get_data_frame_bytes());
+
+  cached_registers[ADS114S08_REGISTERS::INPMUX] = mux;
+  dirty_registers &= ~(0x01ul << ADS114S08_REGISTERS::INPMUX);
+
+  return parse_data_frame(rx + 4, value);
+}
+
+// Read a byte
+template <typename Traits, typename Spi>
+uint8_t BasicDeviceDriver<Traits, Spi>::read_register(uint8_t reg_addr)
+{
+  uint8_t value = 0;
+  read_registers(reg_addr, 1, &value);
+  return value;
+}
+
+// Write a byte
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::write_register(uint8_t reg_addr, uint8_t write_val)
+{
+  write_registers(reg_addr, &write_val, 1);
+}
+
+// INPMUX through SYS are contiguous, so a configuration is one WREG burst, and write_registers()
+// trims off whatever at either end already matches. The readback is always the whole span: it's
+// there to catch what the shadow can't know about.
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::apply_config(const AdcConfig &config, bool verify)
+{
+  const AdcConfig::Registers regs = AdcConfig::encode(config);
+  write_registers(AdcConfig::FIRST_REGISTER, regs.data(), AdcConfig::NUM_REGISTERS);
+  if (!verify)
+  {
+    return true;
+  }
+
+  AdcConfig::Registers readback;
+  read_registers(AdcConfig::FIRST_REGISTER, AdcConfig::NUM_REGISTERS, readback.data());
+  for (uint8_t n = 0; n < AdcConfig::NUM_REGISTERS; ++n)
+  {
+    if (readback[n] != regs[n])
+    {
+      ADS_TRACE_ERROR(TraceEvent::CONFIG_MISMATCH, AdcConfig::FIRST_REGISTER + n, (regs[n] << 8) | readback[n]);
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Traits, typename Spi>
+AdcConfig BasicDeviceDriver<Traits, Spi>::get_config(void)
+{
+  return AdcConfig::decode(&cached_registers[AdcConfig::FIRST_REGISTER]);
+}
+
+// Read num_reads consecutive registers with a single RREG command - see datasheet p. 63
+// The second command byte (000n nnnn) holds the number of registers to read MINUS 1, so
+// one command can move up to 32 registers; that's more than the device has, so a request
+// for the whole register map always fits in one transaction.
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::read_registers(uint8_t start_reg, uint8_t num_reads, uint8_t *dest)
+{
+  if (!num_reads || (num_reads > MAX_BURST_REGISTERS) || !dest)
+  {
+    return;
+  }
+
+  const uint8_t cmd_0 = ADS114S08_CMD::RREG_1ST | (start_reg & 0x1f);
+  const uint8_t cmd_1 = ADS114S08_CMD::RREG_2ND | ((num_reads - 1) & 0x1f);
+
+  // Two command bytes followed by one NOP per register we want clocked back in
+  uint8_t tx[2 + MAX_BURST_REGISTERS] = {cmd_0, cmd_1};
+  uint8_t rx[2 + MAX_BURST_REGISTERS];
+
+  transfer(BusOp::RREG, tx, rx, 2 + num_reads);
+  memcpy(dest, rx + 2, num_reads);
+
+  // Keep the shadow in step with whatever the device just told us, except where we've
+  // staged a value it hasn't been sent yet
+  for (uint8_t n = 0; n < num_reads; ++n)
+  {
+    const uint8_t reg = start_reg + n;
+    if ((reg < NUM_REGISTERS) && !(dirty_registers & (0x01ul << reg)))
+    {
+      cached_registers[reg] = dest[n];
+    }
+    if (reg == ADS114S08_REGISTERS::SYS)
+    {
+      device_sys = dest[n];
+    }
+  }
+}
+
+// Write num_writes consecutive registers with a single WREG command - see datasheet p. 63
+// Registers at either end of the block that already hold the requested value are trimmed
+// off, and if nothing's left the bus isn't touched at all.
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::write_registers(uint8_t start_reg, const uint8_t *src, uint8_t num_writes)
+{
+  if (!num_writes || (num_writes > MAX_BURST_REGISTERS) || !src)
+  {
+    return;
+  }
+
+  const uint8_t requested = num_writes;
+  auto          unchanged = [this](uint8_t reg, uint8_t value) {
+    return (reg < NUM_REGISTERS) && !is_volatile(reg) && !(dirty_registers & (0x01ul << reg)) &&
+           (cached_registers[reg] == value);
+  };
+
+  while (num_writes && unchanged(start_reg, *src))
+  {
+    ++start_reg;
+    ++src;
+    --num_writes;
+  }
+  while (num_writes && unchanged(start_reg + num_writes - 1, src[num_writes - 1]))
+  {
+    --num_writes;
+  }
+  if (num_writes != requested)
+  {
+    bus_stats.record_redundant_writes(requested - num_writes);
+  }
+  if (!num_writes)
+  {
+    return;
+  }
+
+  const uint8_t cmd_0 = ADS114S08_CMD::WREG_1ST | (start_reg & 0x1f);
+  const uint8_t cmd_1 = ADS114S08_CMD::WREG_2ND | ((num_writes - 1) & 0x1f);
+
+  uint8_t tx[2 + MAX_BURST_REGISTERS] = {cmd_0, cmd_1};
+  memcpy(tx + 2, src, num_writes);
+
+  transfer(BusOp::WREG, tx, nullptr, 2 + num_writes);
+
+  for (uint8_t n = 0; n < num_writes; ++n)
+  {
+    const uint8_t reg = start_reg + n;
+    if (reg < NUM_REGISTERS)
+    {
+      cached_registers[reg] = src[n];
+      dirty_registers &= ~(0x01ul << reg);
+    }
+    if (reg == ADS114S08_REGISTERS::SYS)
+    {
+      device_sys = src[n];
+    }
+  }
+}
+
+template <typename Traits, typename Spi>
+uint8_t BasicDeviceDriver<Traits, Spi>::get_cached_register(uint8_t reg)
+{
+  return (reg < NUM_REGISTERS) ? cached_registers[reg] : 0;
+}
+
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::stage_register(uint8_t reg, uint8_t value)
+{
+  if (reg >= NUM_REGISTERS)
+  {
+    return;
+  }
+  if (!is_volatile(reg) && (cached_registers[reg] == value))
+  {
+    bus_stats.record_redundant_writes(1);
+    return;
+  }
+
+  cached_registers[reg] = value;
+  dirty_registers |= (0x01ul << reg);
+}
+
+// Write back staged registers. A single clean register sitting between two dirty ranges costs
+// one byte to rewrite but two bytes of command to skip, so those get folded into the burst.
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::sync(void)
+{
+  uint8_t reg = 0;
+  while (dirty_registers && (reg < NUM_REGISTERS))
+  {
+    if (!(dirty_registers & (0x01ul << reg)))
+    {
+      ++reg;
+      continue;
+    }
+
+    uint8_t end = reg + 1;
+    while (end < NUM_REGISTERS)
+    {
+      if (dirty_registers & (0x01ul << end))
+      {
+        ++end;
+      }
+      else if ((end + 1 < NUM_REGISTERS) && (dirty_registers & (0x01ul << (end + 1))) && !is_volatile(end))
+      {
+        end += 2;
+      }
+      else
+      {
+        break;
+      }
+    }
+
+    const uint8_t count = end - reg;
+    const uint8_t cmd_0 = ADS114S08_CMD::WREG_1ST | reg;
+    const uint8_t cmd_1 = ADS114S08_CMD::WREG_2ND | (count - 1);
+
+    uint8_t tx[2 + NUM_REGISTERS] = {cmd_0, cmd_1};
+    memcpy(tx + 2, &cached_registers[reg], count);
+    transfer(BusOp::WREG, tx, nullptr, 2 + count);
+
+    for (uint8_t n = reg; n < end; ++n)
+    {
+      dirty_registers &= ~(0x01ul << n);
+    }
+    if ((reg <= ADS114S08_REGISTERS::SYS) && (ADS114S08_REGISTERS::SYS < end))
+    {
+      device_sys = cached_registers[ADS114S08_REGISTERS::SYS];
+    }
+    reg = end;
+  }
+}
+
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::refresh(void)
+{
+  uint8_t regs[NUM_REGISTERS];
+  read_registers(0, NUM_REGISTERS, regs);
+}
+
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::is_volatile(uint8_t reg)
+{
+  return (reg == ADS114S08_REGISTERS::ID) || (reg == ADS114S08_REGISTERS::STATUS) ||
+         (reg == ADS114S08_REGISTERS::GPIODAT);
+}
+
+// After RESET the device holds its datasheet defaults again, and anything we'd staged is gone.
+// ID is read-only, so whatever we last read from it still stands.
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::invalidate_cache(void)
+{
+  const uint8_t id = cached_registers[ADS114S08_REGISTERS::ID];
+  for (uint8_t reg = 0; reg < NUM_REGISTERS; ++reg)
+  {
+    cached_registers[reg] = Traits::RESET_VALUES[reg];
+  }
+  cached_registers[ADS114S08_REGISTERS::ID] = id;
+  dirty_registers                           = 0;
+  device_sys                                = Traits::RESET_VALUES[ADS114S08_REGISTERS::SYS];
+}
+
+// Send START to begin converting continuously - see datasheet p. 88
+// From here on, every DRDY falling edge means there's a fresh sample to pick up. In single-shot
+// mode (MODE in DATARATE) the device converts once and goes back to standby by itself.
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::start_conversions(void)
+{
+  sample_ring.clear();
+  dropped_samples.store(0, std::memory_order_relaxed);
+
+  send_command(BusOp::START, ADS114S08_CMD::START);
+  converting = !(cached_registers[ADS114S08_REGISTERS::DATARATE] & ADS114S08_DATARATE::MODE);
+}
+
+// Send STOP to put the device back in standby once the current conversion finishes
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::stop_conversions(void)
+{
+  send_command(BusOp::STOP, ADS114S08_CMD::STOP);
+  converting = false;
+}
+
+template <typename Traits, typename Spi>
+uint64_t BasicDeviceDriver<Traits, Spi>::get_settling_nanos(void)
+{
+  return ADS114S08_CONVERSION::first_result_nanos(cached_registers[ADS114S08_REGISTERS::DATARATE],
+                                                  cached_registers[ADS114S08_REGISTERS::PGA]);
+}
+
+// Averaging CAL_SAMP conversions after the filter settles, per the current DATARATE and SYS
+template <typename Traits, typename Spi>
+uint64_t BasicDeviceDriver<Traits, Spi>::get_calibration_nanos(void)
+{
+  return ADS114S08_SYS::calibration_nanos(cached_registers[ADS114S08_REGISTERS::DATARATE],
+                                          cached_registers[ADS114S08_REGISTERS::SYS]);
+}
+
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::self_offset_calibration(void)
+{
+  run_calibration(ADS114S08_CMD::SFOCAL);
+}
+
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::system_offset_calibration(void)
+{
+  run_calibration(ADS114S08_CMD::SYOCAL);
+}
+
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::system_gain_calibration(void)
+{
+  run_calibration(ADS114S08_CMD::SYGCAL);
+}
+
+// The device calibrates what it has, so anything staged goes out first
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::run_calibration(uint8_t command)
+{
+  sync();
+
+  send_command(BusOp::CALIBRATION, command);
+  clock.delay_nanos(get_calibration_nanos());
+
+  // OFCAL0 .. FSCAL1, RESERVED1 and all
+  uint8_t cal[ADS114S08_REGISTERS::FSCAL1 - ADS114S08_REGISTERS::OFCAL0 + 1];
+  read_registers(ADS114S08_REGISTERS::OFCAL0, sizeof(cal), cal);
+  ADS_TRACE_INFO(TraceEvent::CALIBRATION, command,
+                 (static_cast<uint32_t>(cal[1] << 8 | cal[0]) << 16) | (cal[4] << 8 | cal[3]));
+}
+
+// Direct Read  - see datasheet p. 67
+// Writes directly from (continuously updating) OUTPUT SHIFT REGISTER
+// No serial activity shall occur from the falling edge of DRDY to the readback
+// Keep Din low (or ADC will read in the command - full duplex)
+// Finish reading before next DRDY falling edge
+// Might get a STATUS byte (if SYS.SENDSTAT)
+// Will get two data bytes
+// Might get a CRC (if SYS.CRC)
+// Stop reading 28 clock periods before next DRDY falling edge
+template <typename Traits, typename Spi>
+uint16_t BasicDeviceDriver<Traits, Spi>::read_adc_direct(void)
+{
+  uint16_t value;
+  (void)read_adc_direct(value);
+  return value;
+}
+
+template <typename Traits, typename Spi>
+bool BasicDeviceDriver<Traits, Spi>::read_adc_direct(uint16_t &value)
+{
+  const uint8_t tx[ADS114S08_SYS::MAX_DATA_FRAME_BYTES] = {ADS114S08_CMD::NOP};
+  uint8_t       rx[ADS114S08_SYS::MAX_DATA_FRAME_BYTES] = {0};
+
+  transfer(BusOp::DIRECT_READ, tx, rx, get_data_frame_bytes());
+
+  return parse_data_frame(rx, value);
+}
+
+// Runs in interrupt context (or on whatever thread is standing in for it), so it does the bare
+// minimum: one direct read and one lock-free push. If the consumer has fallen so far behind
+// that the ring is full, the sample is counted and dropped rather than blocking the ISR. A frame
+// that fails its CRC is only counted (in get_crc_errors()); corrupt data never reaches the ring.
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::on_data_ready(void)
+{
+  uint16_t value;
+  if (!read_adc_direct(value))
+  {
+    return;
+  }
+
+  if (!sample_ring.push(value))
+  {
+    const uint32_t dropped = dropped_samples.fetch_add(1, std::memory_order_relaxed) + 1;
+    ADS_TRACE_ERROR(TraceEvent::SAMPLE_DROPPED, dropped);
+    (void)dropped;
+  }
+}
+
+// On an RTOS this is what gets attached to the DRDY pin's falling edge, e.g.
+//   attachInterrupt(DRDY_PIN, FALLING, DeviceDriver::adc_ready_isr, &driver);
+// and the consumer task blocks on a notification instead of polling read_samples()
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::adc_ready_isr(void *driver)
+{
+  static_cast<BasicDeviceDriver *>(driver)->on_data_ready();
+}
+
+template <typename Traits, typename Spi>
+size_t BasicDeviceDriver<Traits, Spi>::read_samples(uint16_t *dest, size_t max_samples)
+{
+  return sample_ring.pop_bulk(dest, max_samples);
+}
+
+// With ADS_STATS=0 these are just the bus calls: not even the clock gets read
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::transfer(BusOp op, const uint8_t *tx, uint8_t *rx, size_t len)
+{
+#if ADS_STATS
+  const uint64_t start = clock.now_nanos();
+  spi.transfer(tx, rx, len);
+  bus_stats.record_transaction(op, len, clock.now_nanos() - start);
+#else
+  (void)op;
+  spi.transfer(tx, rx, len);
+#endif
+}
+
+template <typename Traits, typename Spi>
+void BasicDeviceDriver<Traits, Spi>::send_command(BusOp op, uint8_t command)
+{
+#if ADS_STATS
+  const uint64_t start = clock.now_nanos();
+  spi.write(command);
+  bus_stats.record_transaction(op, 1, clock.now_nanos() - start);
+#else
+  (void)op;
+  spi.write(command);
+#endif
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef BROADCAST_RING_DOT_AITCH
+#define BROADCAST_RING_DOT_AITCH
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// Fixed-capacity, lock-free ring for one producer and any number of consumers, every one of which
+// sees every item. Each consumer keeps its own Cursor; the producer never looks at them, so it
+// just keeps overwriting the oldest slot and can't be held up by a consumer that has stalled.
+// A consumer that falls more than Capacity items behind skips ahead and counts what it missed.
+//
+// Each slot is a tiny seqlock: its sequence is zeroed while the slot is being rewritten and set
+// to position + 1 once it holds item number position. A consumer that reads the same sequence
+// before and after copying the item knows the copy is whole.
+template <typename T, size_t Capacity> class BroadcastRing
+{
+    static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "Items are copied while they may be overwritten");
+    static constexpr size_t MASK = Capacity - 1;
+
+    struct Slot
+    {
+      std::atomic<size_t> sequence;
+      std::atomic<T>      item;
+    };
+
+    alignas(64) std::atomic<size_t> head; // Items published so far (only the producer stores this)
+    alignas(64) std::array<Slot, Capacity> slots;
+
+  public:
+    // One consumer's position in the stream. Not shared between threads.
+    struct Cursor
+    {
+      size_t   position = 0;
+      uint64_t missed   = 0;
+    };
+
+    BroadcastRing() : head(0)
+    {
+      for (auto &slot : slots)
+      {
+        slot.sequence.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Producer side. Never fails and never waits.
+    void publish(const T &item)
+    {
+      const size_t pos  = head.load(std::memory_order_relaxed);
+      Slot        &slot = slots[pos & MASK];
+
+      slot.sequence.store(0, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      slot.item.store(item, std::memory_order_relaxed);
+      slot.sequence.store(pos + 1, std::memory_order_release);
+      head.store(pos + 1, std::memory_order_release);
+    }
+
+    // A cursor that picks up with the next item published
+    Cursor subscribe() const
+    {
+      Cursor cursor;
+      cursor.position = head.load(std::memory_order_acquire);
+      return cursor;
+    }
+
+    // Consumer side: copy up to max_items this cursor hasn't seen yet into dest
+    size_t read(Cursor &cursor, T *dest, size_t max_items) const
+    {
+      size_t count = 0;
+      while (count < max_items)
+      {
+        const size_t h = head.load(std::memory_order_acquire);
+        if (cursor.position == h)
+        {
+          break;
+        }
+
+        // Lapped: the oldest item still in the ring is Capacity behind the head
+        if (h - cursor.position > Capacity)
+        {
+          cursor.missed += h - Capacity - cursor.position;
+          cursor.position = h - Capacity;
+        }
+
+        const Slot  &slot     = slots[cursor.position & MASK];
+        const size_t expected = cursor.position + 1;
+        if (slot.sequence.load(std::memory_order_acquire) == expected)
+        {
+          const T item = slot.item.load(std::memory_order_relaxed);
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (slot.sequence.load(std::memory_order_relaxed) == expected)
+          {
+            dest[count++] = item;
+            ++cursor.position;
+            continue;
+          }
+        }
+
+        // Overwritten under us; go round again and let the lap check skip past it
+        if (head.load(std::memory_order_acquire) - cursor.position <= Capacity)
+        {
+          // Not lapped after all - the producer is mid-publish on a slot we've caught up to
+          break;
+        }
+      }
+      return count;
+    }
+
+    // Items this cursor has yet to read (may be more than Capacity if it has been lapped)
+    size_t pending(const Cursor &cursor) const { return head.load(std::memory_order_acquire) - cursor.position; }
+    size_t published() const { return head.load(std::memory_order_acquire); }
+};
+
+#endif
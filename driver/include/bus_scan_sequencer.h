@@ -0,0 +1,73 @@
+// Pipelined scans across every device on a SpiBus, interleaved to hide conversion time
+//
+// ScanSequencer on its own leaves the bus idle while each conversion settles. With several ADCs
+// on the bus there's no need to: all of them convert at once, and while one device's next entry
+// is settling the bus reads out whichever other device is ready first. A pass over N devices
+// then takes about as long as the longest single-device pass, not the sum of them.
+//
+// Each device's readings go through DeviceDriver::switch_channel_and_read(), exactly as with
+// ScanSequencer, so per device there's still one frame per sample.
+
+#ifndef BUS_SCAN_SEQUENCER_DOT_AITCH
+#define BUS_SCAN_SEQUENCER_DOT_AITCH
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "device_driver.h"
+#include "scan_sequencer.h"
+#include "spi_bus.h"
+
+class BusScanSequencer
+{
+  public:
+    BusScanSequencer(SpiBus &bus);
+
+    // Add a device (its driver must be on this bus) with its own scan list. Returns false if the
+    // list is empty, too long or names a mux input the device doesn't have, or the bus is full.
+    bool   add_device(DeviceDriver &driver, const MuxPair *pairs, size_t num_pairs);
+    size_t get_num_devices(void) { return num_devices; }
+
+    // Readings per pass, over every device
+    size_t get_scan_length(void) { return scan_length; }
+
+    // One pass over every device's scan list. Results are grouped by device in the order they
+    // were added: device 0's entries, then device 1's, and so on. False if any reading failed its
+    // CRC (see get_bad_readings()).
+    bool scan(uint16_t *results);
+
+    // num_scans passes, each one started scan_period_nanos after the previous one (or as soon as
+    // possible). Pass s starts at results[s * get_scan_length()]. Returns the number of readings.
+    size_t run(uint16_t *results, size_t num_scans, uint64_t scan_period_nanos = 0);
+
+    // Device passes that couldn't start on time
+    uint32_t get_overruns(void) { return overruns; }
+    // Readings in the last scan() or run() whose frame failed its CRC, stored as received
+    size_t get_bad_readings(void) { return bad_readings; }
+
+  private:
+    struct ScanDevice
+    {
+      DeviceDriver                                        *driver;
+      std::array<MuxPair, ScanSequencer::MAX_SCAN_LENGTH> scan_list;
+      size_t                                               scan_length;
+      // Where this device's entries start within a pass
+      size_t offset;
+      // Progress through run(): readings taken so far, and when the next one has settled
+      size_t   taken;
+      uint64_t ready_at;
+    };
+
+    IClock &clock;
+
+    std::array<ScanDevice, SpiBus::MAX_DEVICES> devices;
+    size_t                                      num_devices;
+    size_t                                      scan_length;
+    uint32_t                                    overruns;
+    size_t                                      bad_readings;
+
+    void wait_until(uint64_t deadline_nanos);
+};
+
+#endif
@@ -0,0 +1,150 @@
+// Calibration results kept per configuration, so a warm start can put them back instead of
+// calibrating all over again
+//
+// OFCAL and FSCAL only hold for the configuration they were measured in: the mux setting, the
+// gain and the data rate (filter included) all move the offset and gain errors. A profile is one
+// configuration's calibration registers, stamped with when they were measured. At startup, load()
+// brings back every profile the last run save()d, and restore() puts the driver's current
+// configuration's registers back - unless there's no profile for it or the one there is has
+// gone stale, and then it has to be calibrated again:
+//
+//   CalibrationStore store;
+//   store.load(cal_file);
+//   for (each configuration)
+//   {
+//     set it up on the driver;
+//     store.restore_or_calibrate(driver, now, MAX_AGE);
+//   }
+//   store.save(cal_file);
+//
+// restore_or_calibrate() uses SFOCAL, which needs nothing from the system. For system
+// calibration, run the SYOCAL / SYGCAL sequence on the driver and then capture() the result.
+//
+// Timestamps are in whatever units the caller keeps time in across boots (seconds since the
+// epoch, say) and are only ever compared with each other. A store belongs to one device; keep one
+// file per ADC.
+//
+// File format, little-endian and packed:
+//   offset  size  field
+//        0     4  magic          "ACAL"
+//        4     2  version        1
+//        6     2  num_profiles
+//        8       profiles, PROFILE_SIZE bytes each:
+//                  inpmux, pga, datarate, 0, ofcal (2), fscal (2), timestamp (4)
+
+#ifndef CALIBRATION_STORE_DOT_AITCH
+#define CALIBRATION_STORE_DOT_AITCH
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "adc_constants.h"
+
+struct CalibrationProfile
+{
+  // Configuration
+  uint8_t inpmux;
+  uint8_t pga;
+  uint8_t datarate;
+
+  // OFCAL1:OFCAL0 and FSCAL1:FSCAL0
+  uint16_t ofcal;
+  uint16_t fscal;
+
+  uint32_t timestamp;
+};
+
+class CalibrationStore
+{
+  public:
+    inline static const size_t   MAX_PROFILES = 64;
+    inline static const uint16_t VERSION      = 1;
+    inline static const size_t   HEADER_SIZE  = 8;
+    inline static const size_t   PROFILE_SIZE = 12;
+
+    CalibrationStore();
+
+    // The profile for this configuration, or nullptr if there isn't one
+    const CalibrationProfile *find(uint8_t inpmux, uint8_t pga, uint8_t datarate);
+    // Adds the profile, or replaces the one for the same configuration. False if the store is full
+    bool   store(const CalibrationProfile &profile);
+    size_t get_num_profiles(void) { return num_profiles; }
+    void   clear(void) { num_profiles = 0; }
+
+    static bool is_fresh(const CalibrationProfile &profile, uint32_t now, uint32_t max_age)
+    {
+      return (now >= profile.timestamp) && (now - profile.timestamp <= max_age);
+    }
+
+    // The FILE stays the caller's to close. load() replaces everything in the store, and leaves
+    // it empty if the file isn't a calibration file (or is cut short).
+    bool save(FILE *out);
+    bool load(FILE *in);
+
+    // If there's a fresh profile for the driver's current configuration, stage its OFCAL and
+    // FSCAL and sync them (only what differs goes out). Returns false if there wasn't one.
+    template <typename Driver> bool restore(Driver &driver, uint32_t now, uint32_t max_age);
+
+    // Keep the driver's current calibration registers as the profile for its configuration
+    template <typename Driver> bool capture(Driver &driver, uint32_t now);
+
+    // restore(), or failing that a self offset calibration that's then captured. Returns true if
+    // it had to calibrate.
+    template <typename Driver> bool restore_or_calibrate(Driver &driver, uint32_t now, uint32_t max_age);
+
+  private:
+    std::array<CalibrationProfile, MAX_PROFILES> profiles;
+    size_t                                       num_profiles;
+
+    CalibrationProfile *lookup(uint8_t inpmux, uint8_t pga, uint8_t datarate);
+};
+
+template <typename Driver> bool CalibrationStore::restore(Driver &driver, uint32_t now, uint32_t max_age)
+{
+  const CalibrationProfile *profile = find(driver.get_cached_register(ADS114S08_REGISTERS::INPMUX),
+                                           driver.get_cached_register(ADS114S08_REGISTERS::PGA),
+                                           driver.get_cached_register(ADS114S08_REGISTERS::DATARATE));
+  if (!profile || !is_fresh(*profile, now, max_age))
+  {
+    return false;
+  }
+
+  driver.stage_register(ADS114S08_REGISTERS::OFCAL0, profile->ofcal & 0xff);
+  driver.stage_register(ADS114S08_REGISTERS::OFCAL1, profile->ofcal >> 8);
+  driver.stage_register(ADS114S08_REGISTERS::FSCAL0, profile->fscal & 0xff);
+  driver.stage_register(ADS114S08_REGISTERS::FSCAL1, profile->fscal >> 8);
+  driver.sync();
+  return true;
+}
+
+template <typename Driver> bool CalibrationStore::capture(Driver &driver, uint32_t now)
+{
+  CalibrationProfile profile;
+  profile.inpmux    = driver.get_cached_register(ADS114S08_REGISTERS::INPMUX);
+  profile.pga       = driver.get_cached_register(ADS114S08_REGISTERS::PGA);
+  profile.datarate  = driver.get_cached_register(ADS114S08_REGISTERS::DATARATE);
+  profile.ofcal     = static_cast<uint16_t>(driver.get_cached_register(ADS114S08_REGISTERS::OFCAL1) << 8 |
+                                        driver.get_cached_register(ADS114S08_REGISTERS::OFCAL0));
+  profile.fscal     = static_cast<uint16_t>(driver.get_cached_register(ADS114S08_REGISTERS::FSCAL1) << 8 |
+                                        driver.get_cached_register(ADS114S08_REGISTERS::FSCAL0));
+  profile.timestamp = now;
+  return store(profile);
+}
+
+template <typename Driver> bool CalibrationStore::restore_or_calibrate(Driver &driver, uint32_t now, uint32_t max_age)
+{
+  // Calibrate what the shadow describes, not whatever the device had before
+  driver.sync();
+  if (restore(driver, now, max_age))
+  {
+    return false;
+  }
+
+  driver.self_offset_calibration();
+  capture(driver, now);
+  return true;
+}
+
+#endif
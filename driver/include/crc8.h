@@ -0,0 +1,105 @@
+#ifndef CRC8_DOT_AITCH
+#define CRC8_DOT_AITCH
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC on conversion data readback, enabled with SYS.CRC - datasheet p. 69
+// CRC-8-ATM: polynomial x^8 + x^2 + x + 1, MSB first, preset to all ones, no final XOR. It covers
+// the STATUS byte too when that's enabled, and is sent as the last byte of the frame.
+//
+// With no reflection and no final XOR, running the CRC over a whole frame including its CRC byte
+// leaves zero, so checking a frame doesn't need to know where the data ends.
+namespace ADS114S08_CRC
+{
+static constexpr uint8_t POLYNOMIAL = 0x07;
+static constexpr uint8_t SEED       = 0xff;
+
+// One entry per value of (crc ^ next byte): the CRC is exactly one byte wide, so each input byte
+// costs a single lookup
+static constexpr std::array<uint8_t, 256> build_table(void)
+{
+  std::array<uint8_t, 256> table{};
+  for (unsigned n = 0; n < 256; ++n)
+  {
+    uint8_t crc = static_cast<uint8_t>(n);
+    for (uint8_t bit = 0; bit < 8; ++bit)
+    {
+      crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ POLYNOMIAL) : static_cast<uint8_t>(crc << 1);
+    }
+    table[n] = crc;
+  }
+  return table;
+}
+inline constexpr std::array<uint8_t, 256> TABLE = build_table();
+
+inline uint8_t crc8(const uint8_t *data, size_t len, uint8_t crc = SEED)
+{
+  while (len--)
+  {
+    crc = TABLE[crc ^ *data++];
+  }
+  return crc;
+}
+
+inline bool check_frame(const uint8_t *frame, size_t frame_len)
+{
+  return crc8(frame, frame_len) == 0;
+}
+
+// Check a block of buffered frames, each frame_len bytes including its CRC, laid end to end.
+// Returns how many failed; if failed isn't nullptr, failed[n] says whether frame n did.
+// A frame is only a few bytes, so checking one at a time is a short chain of dependent table
+// lookups. Frames don't depend on each other, though, so four run side by side and the lookups
+// overlap.
+inline size_t check_frames(const uint8_t *frames, size_t frame_len, size_t count, bool *failed = nullptr)
+{
+  size_t num_failed = 0;
+  size_t n          = 0;
+
+  for (; n + 4 <= count; n += 4)
+  {
+    const uint8_t *f0 = frames + n * frame_len;
+    const uint8_t *f1 = f0 + frame_len;
+    const uint8_t *f2 = f1 + frame_len;
+    const uint8_t *f3 = f2 + frame_len;
+
+    uint8_t c0 = SEED, c1 = SEED, c2 = SEED, c3 = SEED;
+    for (size_t b = 0; b < frame_len; ++b)
+    {
+      c0 = TABLE[c0 ^ f0[b]];
+      c1 = TABLE[c1 ^ f1[b]];
+      c2 = TABLE[c2 ^ f2[b]];
+      c3 = TABLE[c3 ^ f3[b]];
+    }
+
+    // Nearly every group is clean, so test all four at once and only sort out which failed when
+    // one has (counting them every time gets vectorized by the compiler, and runs slower)
+    if (c0 | c1 | c2 | c3)
+    {
+      num_failed += (c0 != 0) + (c1 != 0) + (c2 != 0) + (c3 != 0);
+    }
+    if (failed)
+    {
+      failed[n]     = c0;
+      failed[n + 1] = c1;
+      failed[n + 2] = c2;
+      failed[n + 3] = c3;
+    }
+  }
+
+  for (; n < count; ++n)
+  {
+    const bool bad = !check_frame(frames + n * frame_len, frame_len);
+    num_failed += bad;
+    if (failed)
+    {
+      failed[n] = bad;
+    }
+  }
+  return num_failed;
+}
+}; // namespace ADS114S08_CRC
+
+#endif
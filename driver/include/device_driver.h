@@ -7,38 +7,41 @@
 //
 //   ability to read/write all the registers on the device
 //   - DeviceDriver::read_register() & DeviceDriver::write_register()
+//   - DeviceDriver::read_registers() & DeviceDriver::write_registers() for bursts
 //
 //   read valid ADC values from device
 //   - DeviceDriver::read_adc()
+//
+//   continuous conversions, read directly on each DRDY into a lock-free sample ring
+//   - DeviceDriver::start_conversions(), DeviceDriver::adc_ready_isr() & DeviceDriver::read_samples()
+//
+//   pipelined multi-channel scans
+//   - ScanSequencer (scan_sequencer.h)
+//
+//   several devices per bus, each on its own chip select, with scans interleaved across them
+//   - SpiBus (spi_bus.h) & BusScanSequencer (bus_scan_sequencer.h)
+//
+//   share one device between threads, with samples fanned out to any number of subscribers
+//   - SharedDeviceDriver (shared_device_driver.h)
+//
+//   keep a shadow copy of the register map so redundant writes never reach the bus
+//   - DeviceDriver::stage_register(), DeviceDriver::sync() & DeviceDriver::refresh()
+//
+//   STATUS byte and CRC on conversion data, whenever SYS turns them on
+//   - DeviceDriver::get_last_status() & DeviceDriver::get_crc_errors(), ADS114S08_CRC (crc8.h)
+//
+//   specialize for one device and one bus at compile time, with no virtual calls per transaction
+//   - BasicDeviceDriver<DeviceTraits, Spi> (basic_device_driver.h, device_traits.h)
 
 #ifndef DEVICE_DRIVER_DOT_AITCH
 #define DEVICE_DRIVER_DOT_AITCH
 
+#include "basic_device_driver.h"
 #include "i_spi_interface.h"
 
-class DeviceDriver
-{
-    ISpiInterface &spi;
-    uint8_t        num_channels;
-    uint8_t        device_id;
-
-  public:
-    inline static const uint8_t NUM_REGISTERS = 18;
-    DeviceDriver(ISpiInterface &spiInterface);
-    ~DeviceDriver() = default;
-
-    uint8_t get_device_id(void);
-    uint8_t get_num_channels(void);
-
-    void reset(void);
-    void initialize(void);
-
-    // Default negative channel = GND
-    void     set_channel(uint8_t ch_plus, uint8_t ch_minus = 0x0c);
-    uint16_t read_adc_by_rdata_cmd(void);
-
-    void    write_register(uint8_t reg, uint8_t value);
-    uint8_t read_register(uint8_t reg);
-};
+// Any device of the family, on any ISpiInterface. The driver itself is BasicDeviceDriver; this
+// instantiation is compiled once, in device_driver.cpp.
+using DeviceDriver = BasicDeviceDriver<ADS114S0x_Traits, ISpiInterface>;
+extern template class BasicDeviceDriver<ADS114S0x_Traits, ISpiInterface>;
 
 #endif
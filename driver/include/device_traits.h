@@ -0,0 +1,80 @@
+// What BasicDeviceDriver needs to know about each member of the family, fixed at compile time
+//
+//   ADS114S08_Traits   12 inputs, ID 0x04
+//   ADS114S06_Traits    6 inputs, ID 0x05 (same register map, AIN6 - AIN11 don't exist)
+//   ADS114S0x_Traits   Either one, told apart by the ID register at initialize(). This is what
+//                      DeviceDriver uses.
+//
+// A traits type provides:
+//   DEVICE_ID                 ID register value it expects (0 = anything is_supported_id() takes)
+//   NUM_CHANNELS              Analog inputs on the largest device it covers
+//   RESET_VALUES              Register map after power-up or RESET
+//   is_supported_id(id)       Whether ID register contents id (low three bits) is a device it covers
+//   num_channels_for_id(id)   Input count of that device (0 if unsupported)
+//   is_valid_input(code)      Whether code is a usable INPMUX nybble (an input or AINCOM)
+
+#ifndef DEVICE_TRAITS_DOT_AITCH
+#define DEVICE_TRAITS_DOT_AITCH
+
+#include <array>
+#include <stdint.h>
+
+#include "adc_constants.h"
+
+// The ADS114S06 and ADS114S08 share a register map; only ID tells them apart
+static constexpr std::array<uint8_t, ADS114S08_REGISTERS::NUM_REGISTERS> reset_values_for_id(uint8_t id)
+{
+  std::array<uint8_t, ADS114S08_REGISTERS::NUM_REGISTERS> values{};
+  for (uint8_t reg = 0; reg < ADS114S08_REGISTERS::NUM_REGISTERS; ++reg)
+  {
+    values[reg] = ADS114S08_REGISTERS::RESET_VALUES[reg];
+  }
+  values[ADS114S08_REGISTERS::ID] = id;
+  return values;
+}
+
+struct ADS114S08_Traits
+{
+    static constexpr uint8_t DEVICE_ID    = 0x04;
+    static constexpr uint8_t NUM_CHANNELS = 12;
+
+    static constexpr std::array<uint8_t, ADS114S08_REGISTERS::NUM_REGISTERS> RESET_VALUES = reset_values_for_id(DEVICE_ID);
+
+    static constexpr bool    is_supported_id(uint8_t id) { return id == DEVICE_ID; }
+    static constexpr uint8_t num_channels_for_id(uint8_t id) { return is_supported_id(id) ? NUM_CHANNELS : 0; }
+    static constexpr bool    is_valid_input(uint8_t code) { return (code < NUM_CHANNELS) || (code == ADS114S08_INPMUX::AINCOM); }
+};
+
+struct ADS114S06_Traits
+{
+    static constexpr uint8_t DEVICE_ID    = 0x05;
+    static constexpr uint8_t NUM_CHANNELS = 6;
+
+    static constexpr std::array<uint8_t, ADS114S08_REGISTERS::NUM_REGISTERS> RESET_VALUES = reset_values_for_id(DEVICE_ID);
+
+    static constexpr bool    is_supported_id(uint8_t id) { return id == DEVICE_ID; }
+    static constexpr uint8_t num_channels_for_id(uint8_t id) { return is_supported_id(id) ? NUM_CHANNELS : 0; }
+    static constexpr bool    is_valid_input(uint8_t code) { return (code < NUM_CHANNELS) || (code == ADS114S08_INPMUX::AINCOM); }
+};
+
+// Whichever of the two turns up. Without knowing which at compile time, inputs can only be checked
+// against the larger device.
+struct ADS114S0x_Traits
+{
+    static constexpr uint8_t DEVICE_ID    = 0;
+    static constexpr uint8_t NUM_CHANNELS = ADS114S08_Traits::NUM_CHANNELS;
+
+    static constexpr std::array<uint8_t, ADS114S08_REGISTERS::NUM_REGISTERS> RESET_VALUES = ADS114S08_Traits::RESET_VALUES;
+
+    static constexpr bool is_supported_id(uint8_t id)
+    {
+      return ADS114S08_Traits::is_supported_id(id) || ADS114S06_Traits::is_supported_id(id);
+    }
+    static constexpr uint8_t num_channels_for_id(uint8_t id)
+    {
+      return ADS114S08_Traits::num_channels_for_id(id) + ADS114S06_Traits::num_channels_for_id(id);
+    }
+    static constexpr bool is_valid_input(uint8_t code) { return ADS114S08_Traits::is_valid_input(code); }
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef ICLOCK_DOT_AITCH
+#define ICLOCK_DOT_AITCH
+
+#include <stdint.h>
+
+// Abstract Base Class for the driver's timing policy: where "now" comes from and how to wait.
+// On hardware this is a monotonic timer; against the emulator it's simulated time.
+class IClock
+{
+  public:
+    virtual ~IClock() = default;
+
+    virtual uint64_t now_nanos(void)              = 0;
+    virtual void     delay_nanos(uint64_t nanos) = 0;
+};
+
+#endif
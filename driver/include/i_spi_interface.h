@@ -1,6 +1,7 @@
 #ifndef ISPI_INTERFACE_DOT_AITCH
 #define ISPI_INTERFACE_DOT_AITCH
 
+#include <stddef.h>
 #include <stdint.h>
 
 // Abstract Base Class for hardware or simulated SPI interface
@@ -18,6 +19,16 @@ class ISpiInterface
     virtual uint8_t transfer(uint8_t data) = 0;
     virtual void    write(uint8_t data)    = 0;
     virtual uint8_t read(void)             = 0;
+
+    // Full-duplex transfer of a whole frame in one call: tx[n] is clocked out while rx[n] is
+    // clocked in. Pass rx = nullptr to discard the response (e.g. for register writes)
+    virtual void transfer(const uint8_t *tx, uint8_t *rx, size_t len) = 0;
+
+    // Chip select: drive the CS line of device cs on this bus low and every other one high, or
+    // release them all with NO_CHIP_SELECT. The default does nothing, which suits a single device
+    // with CS tied low - see datasheet p. 60. With more than one device, let SpiBus drive this.
+    inline static const uint8_t NO_CHIP_SELECT = 0xff;
+    virtual void                set_chip_select(uint8_t cs) { (void)cs; }
 };
 
 #endif
@@ -0,0 +1,22 @@
+#ifndef MONOTONIC_CLOCK_DOT_AITCH
+#define MONOTONIC_CLOCK_DOT_AITCH
+
+#include "i_clock.h"
+
+// Real time from the host's monotonic clock. Long delays sleep; short ones (the SPI setup and
+// hold times) spin on the clock so they don't get rounded up to a scheduler tick.
+// On an MCU you'd implement IClock on top of a hardware timer instead.
+class MonotonicClock : public IClock
+{
+  public:
+    // Delays shorter than this spin instead of sleeping
+    inline static const uint64_t SPIN_THRESHOLD_NANOS = 100000;
+
+    virtual uint64_t now_nanos(void) override;
+    virtual void     delay_nanos(uint64_t nanos) override;
+
+    // Shared instance for drivers that aren't given a clock of their own
+    static MonotonicClock &instance(void);
+};
+
+#endif
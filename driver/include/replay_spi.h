@@ -0,0 +1,88 @@
+// ISpiInterface backend that plays a SpiRecorder capture back (format: spi_recording.h)
+//
+// The recording is memory-mapped, not read: each transfer checks the bytes the driver sends
+// against the COPI bytes that were recorded and copies the recorded CIPO bytes straight out of
+// the mapping. Nothing is emulated and nothing waits, so a capture replays as fast as the driver
+// can issue transactions, and the kernel only pages in what's been reached - multi-gigabyte
+// captures are fine on a 64-bit host.
+//
+//   ReplaySpi    replay("field_issue.aspr");
+//   VirtualClock clock;
+//   DeviceDriver driver(replay, clock);
+//   ... same calls as when recording ...
+//   if (replay.get_divergences()) { ... replay.get_first_divergence_offset() ... }
+//
+// Any difference between what the driver sends and what was recorded (different COPI bytes,
+// frame lengths, chip selects or SPI mode, or running off the end) counts as a divergence.
+// Replay carries on regardless: where the lengths match the recorded CIPO bytes are still served,
+// and anything past the end of the recording reads back as 0xff (nobody driving CIPO).
+//
+// Replay never raises DRDY. A transaction a DRDY handler made while recording sits in the file
+// right after the transfer it interrupted, so replay that kind of capture by making the same
+// reads in the same order (e.g. polling with RDATA) rather than from an ISR.
+
+#ifndef REPLAY_SPI_DOT_AITCH
+#define REPLAY_SPI_DOT_AITCH
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "i_spi_interface.h"
+
+class ReplaySpi : public ISpiInterface
+{
+  public:
+    // Maps the whole file. is_open() is false if it can't be opened, mapped or isn't a
+    // recording this version understands; every transfer then diverges.
+    ReplaySpi(const char *path);
+    ~ReplaySpi();
+    ReplaySpi(const ReplaySpi &)            = delete;
+    ReplaySpi &operator=(const ReplaySpi &) = delete;
+
+    virtual void    init(uint8_t SPI_mode) override;
+    virtual uint8_t transfer(uint8_t data) override;
+    virtual void    write(uint8_t data) override;
+    virtual uint8_t read(void) override;
+    virtual void    transfer(const uint8_t *tx, uint8_t *rx, size_t len) override;
+    virtual void    set_chip_select(uint8_t cs) override;
+
+    bool is_open(void) { return data != nullptr; }
+    bool at_end(void) { return cursor >= size; }
+
+    // Recorded time of the last record replayed
+    uint64_t get_recorded_nanos(void) { return recorded_nanos; }
+    uint64_t get_frames_replayed(void) { return frames_replayed; }
+
+    uint64_t get_divergences(void) { return divergences; }
+    // File offset of the record where replay first diverged (or the file size, if it ran off the
+    // end); only meaningful once get_divergences() is non-zero
+    uint64_t get_first_divergence_offset(void) { return first_divergence_offset; }
+
+  private:
+    const uint8_t *data;
+    size_t         size;
+    size_t         cursor;
+
+    uint64_t recorded_nanos;
+    uint64_t frames_replayed;
+    uint64_t divergences;
+    uint64_t first_divergence_offset;
+    uint8_t  last_cipo;
+
+    struct Record
+    {
+      uint8_t        kind;
+      uint8_t        arg;
+      uint16_t       len;
+      const uint8_t *copi;
+      const uint8_t *cipo;
+    };
+
+    // Step to the next record other than RECORD_TIME (those only move the clock). Returns false
+    // at the end of the recording, or if what's left is truncated.
+    bool next_record(Record &record);
+    void diverged(size_t offset);
+    void expect_control(uint8_t kind, uint8_t arg);
+};
+
+#endif
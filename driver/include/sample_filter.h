@@ -0,0 +1,223 @@
+// Filtering and decimating multi-channel sample streams, a block at a time
+//
+// Everything that consumes scans ends up averaging raw codes its own way. These are the usual
+// stages, ready to chain behind ScanSequencer::run() / BusScanSequencer::run() in a
+// FilterPipeline:
+//
+//   BoxcarDecimator  mean of every `factor` frames; one frame out per `factor` in
+//   MovingAverage    mean of the last `window` frames, one frame out per frame in
+//   CicDecimator     cascaded integrator-comb decimation, `order` stages, gain taken out
+//   FirFilter        FIR with the caller's taps, optionally keeping only every `decimation`th output
+//   MedianFilter     median of the last `window` frames per channel, to knock out single-sample spikes
+//
+// A block is num_frames frames of get_num_channels() samples each, frame after frame - the layout
+// run() produces, entry n of pass s at [s * num_channels + n]. Samples are floats in code units
+// (FilterPipeline converts the codes on the way in; UnitConverter takes it from there if volts are
+// wanted). Filter state is kept as a structure of arrays: one array over channels per delay
+// element, integrator or tap, so every kernel is a loop over taps or stages around a straight loop
+// over channels, which the compiler vectorizes. Nothing allocates: channel counts, taps and
+// windows are bounded by the constants below and the state lives in the filter object.
+//
+// Like set_scan_list(), configure() returns false and keeps the old settings if it's given
+// something it can't do. A default-constructed filter has no channels and passes nothing.
+
+#ifndef SAMPLE_FILTER_DOT_AITCH
+#define SAMPLE_FILTER_DOT_AITCH
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "scan_sequencer.h"
+
+class ISampleFilter
+{
+  public:
+    inline static const size_t MAX_CHANNELS = ScanSequencer::MAX_SCAN_LENGTH;
+
+    virtual ~ISampleFilter() = default;
+
+    virtual size_t get_num_channels(void) = 0;
+    // Frames in per frame out
+    virtual size_t get_decimation(void) = 0;
+
+    // Filters num_frames frames from in and writes the frames that come out to out, returning how
+    // many there were. A decimator keeps its phase from one block to the next, so blocks needn't
+    // be a multiple of its factor. out can be in.
+    virtual size_t process(const float *in, size_t num_frames, float *out) = 0;
+    // Back to the state configure() left it in
+    virtual void reset(void) = 0;
+};
+
+class BoxcarDecimator : public ISampleFilter
+{
+  public:
+    inline static const size_t MAX_FACTOR = 65536;
+
+    BoxcarDecimator();
+    bool configure(size_t num_channels, size_t factor);
+
+    size_t get_num_channels(void) override { return num_channels; }
+    size_t get_decimation(void) override { return factor; }
+    size_t process(const float *in, size_t num_frames, float *out) override;
+    void   reset(void) override;
+
+  private:
+    size_t num_channels;
+    size_t factor;
+    float  scale;
+    size_t count;
+
+    alignas(32) std::array<float, MAX_CHANNELS> sums;
+};
+
+// Until `window` frames have gone through, the first frame stands in for the ones before it
+class MovingAverage : public ISampleFilter
+{
+  public:
+    inline static const size_t MAX_WINDOW = 64;
+
+    MovingAverage();
+    bool configure(size_t num_channels, size_t window);
+
+    size_t get_num_channels(void) override { return num_channels; }
+    size_t get_decimation(void) override { return 1; }
+    size_t process(const float *in, size_t num_frames, float *out) override;
+    void   reset(void) override;
+
+  private:
+    size_t num_channels;
+    size_t window;
+    size_t position;
+    bool   primed;
+
+    // history[k] is one frame; the running sums are doubles so adding and dropping samples
+    // forever doesn't drift
+    alignas(32) std::array<std::array<float, MAX_CHANNELS>, MAX_WINDOW> history;
+    alignas(32) std::array<double, MAX_CHANNELS> sums;
+};
+
+// Integrators run in 64-bit integers that are allowed to wrap, as a CIC's are: the combs take the
+// wrap back out exactly. Input is rounded to 1/256 of a code on the way in, and the output is
+// scaled by 1 / factor^order, so a steady input comes out unchanged. order * log2(factor) can't
+// exceed 40 bits, which leaves room in 64 for a 16-bit code with 8 bits of fraction.
+class CicDecimator : public ISampleFilter
+{
+  public:
+    inline static const size_t MAX_ORDER = 5;
+
+    CicDecimator();
+    bool configure(size_t num_channels, size_t factor, size_t order);
+
+    size_t get_num_channels(void) override { return num_channels; }
+    size_t get_decimation(void) override { return factor; }
+    size_t get_order(void) { return order; }
+    size_t process(const float *in, size_t num_frames, float *out) override;
+    void   reset(void) override;
+
+  private:
+    inline static const float  INPUT_SCALE   = 256.0f;
+    inline static const size_t MAX_GAIN_BITS = 40;
+
+    size_t num_channels;
+    size_t factor;
+    size_t order;
+    float  scale;
+    size_t count;
+
+    alignas(32) std::array<std::array<uint64_t, MAX_CHANNELS>, MAX_ORDER> integrators;
+    alignas(32) std::array<std::array<uint64_t, MAX_CHANNELS>, MAX_ORDER> combs;
+};
+
+// out = sum of taps[k] * (the frame k frames back), k < num_taps. History starts out zero.
+class FirFilter : public ISampleFilter
+{
+  public:
+    inline static const size_t MAX_TAPS = 64;
+
+    FirFilter();
+    // The taps are copied
+    bool configure(size_t num_channels, const float *taps, size_t num_taps, size_t decimation = 1);
+
+    size_t get_num_channels(void) override { return num_channels; }
+    size_t get_decimation(void) override { return decimation; }
+    size_t process(const float *in, size_t num_frames, float *out) override;
+    void   reset(void) override;
+
+  private:
+    size_t num_channels;
+    size_t num_taps;
+    size_t decimation;
+    size_t position;
+    size_t count;
+
+    std::array<float, MAX_TAPS> taps;
+    // Every frame goes in twice, at position and position + num_taps, so the last num_taps
+    // frames are always history[position + 1 .. position + num_taps] in order, newest last
+    alignas(32) std::array<std::array<float, MAX_CHANNELS>, 2 * MAX_TAPS> history;
+};
+
+// window is odd. Until `window` frames have gone through, the first frame stands in for the ones
+// before it.
+class MedianFilter : public ISampleFilter
+{
+  public:
+    inline static const size_t MAX_WINDOW = 15;
+
+    MedianFilter();
+    bool configure(size_t num_channels, size_t window);
+
+    size_t get_num_channels(void) override { return num_channels; }
+    size_t get_decimation(void) override { return 1; }
+    size_t process(const float *in, size_t num_frames, float *out) override;
+    void   reset(void) override;
+
+  private:
+    size_t num_channels;
+    size_t window;
+    size_t position;
+    bool   primed;
+
+    alignas(32) std::array<std::array<float, MAX_CHANNELS>, MAX_WINDOW> history;
+    // Where the window is sorted, every channel at once, by a network of min/max exchanges
+    alignas(32) std::array<std::array<float, MAX_CHANNELS>, MAX_WINDOW> sorted;
+};
+
+// Stages run one after the other over the same block, in place
+//
+//   FilterPipeline pipeline;
+//   pipeline.add_stage(median);
+//   pipeline.add_stage(cic);
+//   sequencer.run(codes, num_scans);
+//   const size_t frames = pipeline.process(codes, num_scans, filtered);
+class FilterPipeline
+{
+  public:
+    inline static const size_t MAX_STAGES = 8;
+
+    FilterPipeline();
+
+    // The stage isn't copied, and has to have the same number of channels as the ones before it.
+    // Returns false if it doesn't, or there are MAX_STAGES already.
+    bool   add_stage(ISampleFilter &stage);
+    size_t get_num_stages(void) { return num_stages; }
+    size_t get_num_channels(void) { return num_stages ? stages[0]->get_num_channels() : 0; }
+    // Frames in per frame out, over every stage
+    size_t get_decimation(void);
+
+    // Codes in, filtered frames out. out has to have room for all num_frames frames: the
+    // stages work in it. Returns the number of frames that came out of the last stage (none
+    // without any stages).
+    size_t process(const uint16_t *codes, size_t num_frames, float *out);
+    size_t process(const int16_t *codes, size_t num_frames, float *out);
+    size_t process(const float *in, size_t num_frames, float *out);
+    void   reset(void);
+
+  private:
+    std::array<ISampleFilter *, MAX_STAGES> stages;
+    size_t                                  num_stages;
+
+    size_t run_stages(float *samples, size_t num_frames);
+};
+
+#endif
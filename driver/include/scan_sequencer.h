@@ -0,0 +1,73 @@
+// Pipelined multi-channel scans on top of DeviceDriver
+//
+// Scanning by hand means set_channel() + read_adc_by_rdata_cmd() per channel, one after the
+// other, with the bus sitting idle while each conversion settles (or, worse, reading before it
+// has). The sequencer runs the ADC in continuous conversion mode (a device left in single-shot
+// mode is switched out of it) and, for every entry in the scan list, waits out the settling time
+// and then sends a single frame that points the mux at the NEXT entry and reads back the CURRENT
+// one. The next conversion is already under way while
+// the current result is being clocked out, and there's one transaction per sample instead of two.
+//
+// Don't combine with DRDY-driven streaming (adc_ready_isr) on the same device; both want the bus.
+
+#ifndef SCAN_SEQUENCER_DOT_AITCH
+#define SCAN_SEQUENCER_DOT_AITCH
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "device_driver.h"
+
+// One entry in a scan list: positive and negative mux inputs (0x0c = AINCOM/GND)
+struct MuxPair
+{
+  uint8_t ch_plus;
+  uint8_t ch_minus;
+};
+
+class ScanSequencer
+{
+  public:
+    inline static const size_t MAX_SCAN_LENGTH = 32;
+
+    ScanSequencer(DeviceDriver &driver);
+
+    // Copies the list; returns false (and keeps the old list) if it's empty or too long, or
+    // names a mux input the device doesn't have
+    bool   set_scan_list(const MuxPair *pairs, size_t num_pairs);
+    size_t get_scan_length(void) { return scan_length; }
+
+    // One pass over the scan list. results[n] gets the reading for scan list entry n. False if
+    // any reading failed its CRC (see get_bad_readings()).
+    bool scan(uint16_t *results);
+
+    // num_scans back-to-back passes, each one started scan_period_nanos after the previous one
+    // (or as soon as possible, if a pass takes longer than that). Results are contiguous:
+    // results[s * get_scan_length() + n] is entry n of pass s. Returns the number of readings.
+    size_t run(uint16_t *results, size_t num_scans, uint64_t scan_period_nanos = 0);
+
+    // The same, for lists of differential pairs: a reading is the positive input minus the
+    // negative one, so results come back as signed codes, one per entry with nothing in between
+    bool   scan(int16_t *results);
+    size_t run(int16_t *results, size_t num_scans, uint64_t scan_period_nanos = 0);
+
+    // Passes that couldn't start on time because the previous one overran the scan period
+    uint32_t get_overruns(void) { return overruns; }
+    // Readings in the last scan() or run() whose frame failed its CRC. They're still stored, as
+    // received, so the caller decides what to do with them.
+    size_t get_bad_readings(void) { return bad_readings; }
+
+  private:
+    DeviceDriver &driver;
+    IClock       &clock;
+
+    std::array<MuxPair, MAX_SCAN_LENGTH> scan_list;
+    size_t                               scan_length;
+    uint32_t                             overruns;
+    size_t                               bad_readings;
+
+    void wait_until(uint64_t deadline_nanos);
+};
+
+#endif
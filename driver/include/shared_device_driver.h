@@ -0,0 +1,92 @@
+// Thread-safe facade over one DeviceDriver
+//
+// DeviceDriver itself assumes a single caller. Wrap it in a SharedDeviceDriver and any number of
+// threads can use the device at once:
+//
+//   - Register access and other bus traffic is serialized per transaction by a small per-device
+//     bus lock. Compound sequences that must not be interleaved go through transaction().
+//   - Samples are acquired on DRDY (attach adc_ready_isr) and published to a BroadcastRing that
+//     any number of subscribers (logger, control loop, UI...) read at their own pace, each with
+//     its own cursor. A subscriber that stalls misses samples; it never holds up acquisition.
+//
+// The DRDY handler never waits for the bus lock. If the lock is free it reads the new sample
+// directly, as DeviceDriver::on_data_ready() does. If a transaction holds the bus it just leaves
+// a flag, and the transaction picks the sample up with RDATA on its way out - by then the output
+// shift register may have been disturbed, but the data-holding register still has the result.
+// Either way, a sample whose CRC (if enabled in SYS) doesn't check out is never published.
+//
+// Once wrapped, don't use the DeviceDriver directly from anywhere else.
+
+#ifndef SHARED_DEVICE_DRIVER_DOT_AITCH
+#define SHARED_DEVICE_DRIVER_DOT_AITCH
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "broadcast_ring.h"
+#include "device_driver.h"
+
+class SharedDeviceDriver
+{
+  public:
+    // Samples kept for subscribers; anyone further behind than this starts missing them
+    inline static const size_t SAMPLE_HISTORY = 4096;
+    using SampleRing                          = BroadcastRing<uint16_t, SAMPLE_HISTORY>;
+    using Subscriber                          = SampleRing::Cursor;
+
+    SharedDeviceDriver(DeviceDriver &driver);
+
+    // Single transactions, each one atomic with respect to every other thread
+    uint8_t  read_register(uint8_t reg);
+    void     write_register(uint8_t reg, uint8_t value);
+    void     read_registers(uint8_t start_reg, uint8_t num_reads, uint8_t *dest);
+    void     write_registers(uint8_t start_reg, const uint8_t *src, uint8_t num_writes);
+    bool     set_channel(uint8_t ch_plus, uint8_t ch_minus = 0x0c);
+    uint16_t read_adc_by_rdata_cmd(void);
+    void     start_conversions(void);
+    void     stop_conversions(void);
+
+    // Run f(DeviceDriver &) with the bus held, for sequences that have to stay together (e.g.
+    // set_channel() then read_adc_by_rdata_cmd()). Use only the driver handed to f inside it;
+    // calling back into this SharedDeviceDriver from f would deadlock.
+    template <typename F> auto transaction(F &&f) -> decltype(f(*static_cast<DeviceDriver *>(nullptr)))
+    {
+      BusGuard guard(*this);
+      return f(driver);
+    }
+
+    // DRDY falling edge. Attach adc_ready_isr (with this facade as its argument) to the DRDY
+    // interrupt instead of DeviceDriver::adc_ready_isr.
+    void        on_data_ready(void);
+    static void adc_ready_isr(void *shared);
+
+    // Sample fan-out. Each consumer subscribes once and keeps its Subscriber to itself.
+    Subscriber subscribe(void) { return samples.subscribe(); }
+    size_t     read_samples(Subscriber &subscriber, uint16_t *dest, size_t max_samples);
+    size_t     get_published_samples(void) { return samples.published(); }
+
+    // DRDY edges that had to be picked up with RDATA because a transaction held the bus
+    uint32_t get_deferred_samples(void) { return deferred_samples.load(std::memory_order_relaxed); }
+
+  private:
+    DeviceDriver &driver;
+
+    std::atomic_flag      bus_lock;
+    std::atomic<bool>     drdy_pending;
+    std::atomic<uint32_t> deferred_samples;
+    SampleRing            samples;
+
+    void lock(void);
+    bool try_lock(void);
+    void unlock(void);
+
+    struct BusGuard
+    {
+      SharedDeviceDriver &shared;
+      BusGuard(SharedDeviceDriver &shared) : shared(shared) { shared.lock(); }
+      ~BusGuard() { shared.unlock(); }
+    };
+};
+
+#endif
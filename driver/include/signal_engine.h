@@ -0,0 +1,99 @@
+// Synthetic analog inputs for the ADC emulator
+//
+// Each of the 12 inputs gets a source made of up to MAX_COMPONENTS components that are summed:
+// DC levels, sines, ramps, squares and seeded Gaussian noise. Everything is a function of
+// simulated time only, so a given input reads the same at the same instant no matter how or when
+// it's asked, and a run can be reproduced exactly from its seeds.
+//
+// Values are in output codes, the same units RDATA returns; the sum is rounded and clamped to
+// 0x0000..0xFFFF. Periodic components swing +/- amplitude around zero, so they're normally added
+// to a DC level:
+//
+//   const SignalComponent mains_hum[] = {SignalComponent::dc(0x8000), SignalComponent::sine(2000, 50),
+//                                        SignalComponent::noise(12, 0xC0FFEE)};
+//   engine.set_source(3, mains_hum, 3);
+//
+// generate() produces a whole block of samples at a fixed step in one call; each component is one
+// straight-line loop over the block, with no per-sample branching on the kind of signal.
+
+#ifndef SIGNAL_ENGINE_DOT_AITCH
+#define SIGNAL_ENGINE_DOT_AITCH
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+enum class SignalKind : uint8_t
+{
+  DC,     // amplitude is the level
+  SINE,   // amplitude * sin(2 pi (f t + phase))
+  RAMP,   // Sawtooth rising from -amplitude to +amplitude once per cycle
+  SQUARE, // +amplitude for the first half of each cycle, -amplitude for the second
+  NOISE,  // Gaussian, standard deviation = amplitude, reproducible from the seed
+};
+
+struct SignalComponent
+{
+  SignalKind kind;
+  double     amplitude;
+  double     frequency_hz;
+  double     phase; // Fraction of a cycle, 0..1
+  uint64_t   seed;
+
+  static constexpr SignalComponent dc(double level) { return {SignalKind::DC, level, 0, 0, 0}; }
+  static constexpr SignalComponent sine(double amplitude, double hz, double phase = 0)
+  {
+    return {SignalKind::SINE, amplitude, hz, phase, 0};
+  }
+  static constexpr SignalComponent ramp(double amplitude, double hz, double phase = 0)
+  {
+    return {SignalKind::RAMP, amplitude, hz, phase, 0};
+  }
+  static constexpr SignalComponent square(double amplitude, double hz, double phase = 0)
+  {
+    return {SignalKind::SQUARE, amplitude, hz, phase, 0};
+  }
+  static constexpr SignalComponent noise(double sigma, uint64_t seed) { return {SignalKind::NOISE, sigma, 0, 0, seed}; }
+};
+
+class SignalEngine
+{
+  public:
+    inline static const uint8_t NUM_INPUTS     = 12;
+    inline static const size_t  MAX_COMPONENTS = 4;
+
+    // Every input starts out as a flat 0
+    SignalEngine();
+
+    // Replace an input's source. Returns false (and leaves it alone) if the input doesn't exist
+    // or there are too many components; no components at all means a flat 0.
+    bool set_source(uint8_t input, const SignalComponent *components, size_t num_components);
+    void set_dc(uint8_t input, double level);
+
+    // The input's value at t_nanos of simulated time
+    uint16_t sample(uint8_t input, uint64_t t_nanos);
+
+    // dest[n] = sample(input, t0_nanos + n * step_nanos) for n < num_samples
+    void generate(uint8_t input, uint64_t t0_nanos, uint64_t step_nanos, uint16_t *dest, size_t num_samples);
+
+    // Bumped on every set_source(), so anyone caching generated blocks knows to throw them out
+    uint32_t get_generation(void) { return generation; }
+
+  private:
+    struct Source
+    {
+      std::array<SignalComponent, MAX_COMPONENTS> components;
+      size_t                                       num_components;
+    };
+
+    std::array<Source, NUM_INPUTS> sources;
+    uint32_t                       generation;
+
+    // Samples worked on at a time; keeps the scratch accumulator on the stack
+    static constexpr size_t CHUNK = 64;
+
+    static void add_component(const SignalComponent &c, uint64_t t0_nanos, uint64_t step_nanos, double *acc,
+                              size_t count);
+};
+
+#endif
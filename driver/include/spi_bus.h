@@ -0,0 +1,77 @@
+// Several ADCs on one SPI bus, each with its own chip select
+//
+// The bus wraps the controller (hardware or SpiEmulator) and hands out one ISpiInterface per
+// device, so each device still gets a plain DeviceDriver:
+//
+//   SpiBus       bus(controller, clock);
+//   DeviceDriver adc0(bus.device(0), clock);
+//   DeviceDriver adc1(bus.device(1), clock);
+//
+// Every transaction goes through the bus, which makes sure the right CS line is low before the
+// frame goes out. CS stays asserted after a transaction, so a run of transactions to the same
+// device only pays for chip select once; switching to another device releases the old CS (after
+// its hold time) and asserts the new one (before its setup time).
+//
+// A bus and everything on it belong to one thread - there's no lock to take. Separate buses
+// share nothing, so each one can be driven from its own thread.
+
+#ifndef SPI_BUS_DOT_AITCH
+#define SPI_BUS_DOT_AITCH
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "i_clock.h"
+#include "i_spi_interface.h"
+#include "monotonic_clock.h"
+
+class SpiBus
+{
+  public:
+    inline static const uint8_t MAX_DEVICES = 8;
+
+    // One device's view of the bus: selects its own CS, then passes straight through
+    class Device : public ISpiInterface
+    {
+      public:
+        virtual void    init(uint8_t SPI_mode) override;
+        virtual uint8_t transfer(uint8_t data) override;
+        virtual void    write(uint8_t data) override;
+        virtual uint8_t read(void) override;
+        virtual void    transfer(const uint8_t *tx, uint8_t *rx, size_t len) override;
+
+        uint8_t get_chip_select(void) { return cs; }
+
+      private:
+        friend class SpiBus;
+        SpiBus *bus;
+        uint8_t cs;
+    };
+
+    SpiBus(ISpiInterface &controller, IClock &clock = MonotonicClock::instance());
+
+    // The ISpiInterface for the device on CS line cs (0 .. MAX_DEVICES - 1)
+    Device &device(uint8_t cs) { return devices[cs % MAX_DEVICES]; }
+    IClock &get_clock(void) { return clock; }
+
+    // Release whichever CS is asserted, e.g. before handing the bus to something else
+    void release(void);
+
+    // Device currently holding the bus (ISpiInterface::NO_CHIP_SELECT if none), and how many
+    // times ownership has changed hands
+    uint8_t  get_selected(void) { return selected; }
+    uint32_t get_chip_select_switches(void) { return chip_select_switches; }
+
+  private:
+    ISpiInterface &controller;
+    IClock        &clock;
+
+    std::array<Device, MAX_DEVICES> devices;
+    uint8_t                         selected;
+    uint32_t                        chip_select_switches;
+
+    void acquire(uint8_t cs);
+};
+
+#endif
@@ -2,13 +2,15 @@
 #define SPI_EMULATOR_SPI_DOT_AITCH
 
 #include <cstdint>
-#include <iostream>
+#include <vector>
 
 #include "adc_emulator.h"
 #include "device_driver.h"
 #include "i_spi_interface.h"
+#include "virtual_clock.h"
 
-class SpiEmulator : public ISpiInterface
+// final, so that a BasicDeviceDriver built on it calls straight in rather than through the vtable
+class SpiEmulator final : public ISpiInterface
 {
     uint16_t sim_data;
 
@@ -17,13 +19,28 @@ class SpiEmulator : public ISpiInterface
 
   public:
     SpiEmulator();
+    // With simulate_startup_delay, the ADCs have only just powered up: STATUS reads RDY = 1 for the
+    // first POWERUP_SETTLING_NANOS of simulated time. Without it they've been up all along.
     SpiEmulator(bool simulate_startup_delay);
+    // Several emulated ADCs sharing the bus, told apart by chip select (0 .. num_devices - 1)
+    SpiEmulator(uint8_t num_devices, bool simulate_startup_delay);
     ~SpiEmulator() = default;
 
+    // Not copyable (or movable): the ADCs point at this object's COPI / CIPO buffers and the clock
+    // calls back into it. Pass it by reference.
+    SpiEmulator(const SpiEmulator &)            = delete;
+    SpiEmulator &operator=(const SpiEmulator &) = delete;
+
     virtual void    init(uint8_t SPI_mode) override;
     virtual uint8_t transfer(uint8_t data) override;
     virtual void    write(uint8_t data) override;
     virtual uint8_t read(void) override;
+    virtual void    transfer(const uint8_t *tx, uint8_t *rx, size_t len) override;
+
+    // Only the selected ADC sees the bus. With nothing selected, CIPO floats and reads back 0xff.
+    // Device 0 is selected from the start, so single-device setups never need to call this.
+    virtual void set_chip_select(uint8_t cs) override;
+    uint8_t      get_num_devices(void) { return static_cast<uint8_t>(adcs.size()); }
 
     ////////////////////////// WARNING ////////////////////////
     // The following functions should never make their way into production code;
@@ -38,16 +55,55 @@ class SpiEmulator : public ISpiInterface
 
     uint8_t *get_pCipo() { return &fake_cipo_buffer; }
 
-    uint16_t get_raw_adc_test_val(uint8_t idx) { return adc.get_raw_adc_test_val(idx); }
+    uint16_t get_raw_adc_test_val(uint8_t idx, uint8_t cs = 0) { return adcs.at(cs).get_raw_adc_test_val(idx); }
+    uint16_t get_differential_test_val(uint8_t ch_plus, uint8_t ch_minus, uint8_t cs = 0)
+    {
+      return adcs.at(cs).get_differential_test_val(ch_plus, ch_minus);
+    }
+
+    // Offset and gain error of the ADC on chip select cs, for calibration to take out
+    void set_conversion_errors(int16_t offset_codes, double gain, uint8_t cs = 0)
+    {
+      adcs.at(cs).set_conversion_errors(offset_codes, gain);
+    }
+    // Which part the ADC on chip select cs identifies as (see ADS114S08_Emulator::set_device_id())
+    void set_device_id(uint8_t id, uint8_t cs = 0) { adcs.at(cs).set_device_id(id); }
+
+    // Analog inputs of the ADC on chip select cs (DC by default; see signal_engine.h)
+    SignalEngine &get_signals(uint8_t cs = 0) { return adcs.at(cs).get_signals(); }
     ///////////////////// END OF WARNING /////////////////////
 
+    // Simulated time shared by the bus and the emulated ADC. Every byte on the bus takes
+    // 8 SCLK periods of it; hand it to DeviceDriver so its delays cost nothing in real time.
+    VirtualClock &get_clock() { return clock; }
+
+    // Stand-ins for the ADCs' clock and DRDY pins. Whoever calls advance_time() plays the part
+    // of the hardware, so the attached ISRs run on that thread.
+    void advance_time(uint64_t nanos) { clock.advance(nanos); }
+    void attach_drdy_isr(void (*isr)(void *), void *context, uint8_t cs = 0)
+    {
+      adcs.at(cs).attach_drdy_isr(isr, context);
+    }
+    bool     is_drdy_low(uint8_t cs = 0) { return adcs.at(cs).is_drdy_low(); }
+    uint32_t get_conversions(uint8_t cs = 0) { return adcs.at(cs).get_conversions(); }
+
+    // Whether every ADC's RDATA in standby returns its last completed conversion (the default)
+    // or converts on the spot (see ADS114S08_Emulator::set_timing_accurate())
+    void set_timing_accurate(bool on)
+    {
+      for (auto &adc : adcs)
+      {
+        adc.set_timing_accurate(on);
+      }
+    }
+
   private:
-    ADS114S08_Emulator adc;
-    friend uint16_t    read_adc_channel(DeviceDriver &adc, uint8_t ch);
-};
+    // Sized once at construction; every ADC shares the COPI / CIPO buffers above
+    std::vector<ADS114S08_Emulator> adcs;
+    ADS114S08_Emulator             *selected;
+    VirtualClock                    clock;
 
-// TODO: just a placeholder to remind me that I may want to set up a thread in the app that writes
-// a sine wave to the simulated SPI registers or something if I get really ambitious
-// extern void simulate_adc_data(void);
+    static void on_clock_advance(void *spi, uint64_t elapsed_nanos);
+};
 
 #endif
@@ -0,0 +1,68 @@
+// ISpiInterface decorator that records every transaction to a file (format: spi_recording.h)
+//
+// Sits between a driver and the real (or emulated) bus and passes everything straight through,
+// logging both directions of every transfer with a timestamp from the given clock:
+//
+//   FILE        *capture = fopen("field_issue.aspr", "wb");
+//   SpiRecorder  recorder(spi, clock, capture);
+//   DeviceDriver driver(recorder, clock);
+//
+// Records are packed into an in-memory buffer and only written out when it fills up, on flush()
+// or on destruction, so recording costs a memcpy per transaction rather than a write.
+
+#ifndef SPI_RECORDER_DOT_AITCH
+#define SPI_RECORDER_DOT_AITCH
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "i_clock.h"
+#include "i_spi_interface.h"
+
+class SpiRecorder : public ISpiInterface
+{
+  public:
+    inline static const size_t BUFFER_SIZE      = 64 * 1024;
+    inline static const size_t NESTING_HEADROOM = 1024;
+
+    // Writes the file header straight away. The FILE stays the caller's to close, after the
+    // recorder is gone.
+    SpiRecorder(ISpiInterface &inner, IClock &clock, FILE *out);
+    ~SpiRecorder();
+
+    virtual void    init(uint8_t SPI_mode) override;
+    virtual uint8_t transfer(uint8_t data) override;
+    virtual void    write(uint8_t data) override;
+    virtual uint8_t read(void) override;
+    virtual void    transfer(const uint8_t *tx, uint8_t *rx, size_t len) override;
+    virtual void    set_chip_select(uint8_t cs) override;
+
+    void     flush(void);
+    uint64_t get_frames_recorded(void) { return frames_recorded; }
+    // Nested transactions (e.g. from a DRDY handler) that didn't fit in the headroom
+    uint64_t get_dropped_records(void) { return dropped_records; }
+    uint64_t get_bytes_written(void) { return bytes_written + buffered; }
+
+  private:
+    ISpiInterface &inner;
+    IClock        &clock;
+    FILE          *out;
+
+    std::vector<uint8_t> buffer;
+    size_t               buffered;
+    uint64_t             bytes_written;
+    uint64_t             last_nanos;
+    uint64_t             frames_recorded;
+    uint64_t             dropped_records;
+    // Transfers currently in flight through this recorder
+    uint8_t depth;
+
+    // Room for a record header (and len bytes each way) at the end of the buffer; flushes first
+    // if there isn't enough. Returns where the payload goes, or nullptr if the record is dropped.
+    // A continuation (a later chunk of a long transfer) gets a delta of 0 and leaves the time the
+    // next record counts from at the start of the transfer.
+    uint8_t *begin_record(uint8_t kind, uint8_t arg, uint16_t len, bool continuation = false);
+};
+
+#endif
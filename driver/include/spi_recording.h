@@ -0,0 +1,54 @@
+// SPI recording file format, written by SpiRecorder and read back by ReplaySpi
+//
+// A recording is a 16-byte file header followed by a stream of variable-length records, all
+// packed (no padding, no alignment) and little-endian.
+//
+// File header:
+//   offset  size  field
+//        0     4  magic          "ASPR"
+//        4     2  version        1
+//        6     2  header_size    16 (records start here)
+//        8     8  start_nanos    Clock reading when recording started
+//
+// Every record starts with the same 8-byte header:
+//   offset  size  field
+//        0     1  kind           One of the RECORD_* values below
+//        1     1  arg            Kind-specific
+//        2     2  len            Payload bytes per direction (FRAME only, otherwise 0)
+//        4     4  delta_nanos    Time since the previous record (or start_nanos)
+//
+//   RECORD_FRAME        A full-duplex transfer. arg is unused. The header is followed by the len
+//                       bytes sent on COPI, then the len bytes received on CIPO - each direction
+//                       contiguous, so a replay can hand the CIPO bytes back with a single copy.
+//                       A transfer longer than MAX_FRAME_BYTES is split into consecutive FRAME
+//                       records, the later ones with a delta of 0.
+//   RECORD_CHIP_SELECT  set_chip_select(arg)
+//   RECORD_INIT         init(arg), arg being the SPI mode
+//   RECORD_TIME         delta_nanos didn't fit in 32 bits: the header is followed by the absolute
+//                       time as 8 bytes, and the next record's delta counts from there
+//
+// A byte-at-a-time transfer() or write() is recorded as a one-byte FRAME. read() puts nothing on
+// the bus and isn't recorded.
+
+#ifndef SPI_RECORDING_DOT_AITCH
+#define SPI_RECORDING_DOT_AITCH
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace SPI_RECORDING
+{
+static constexpr char     MAGIC[4]    = {'A', 'S', 'P', 'R'};
+static constexpr uint16_t VERSION     = 1;
+static constexpr uint16_t HEADER_SIZE = 16;
+
+static constexpr uint8_t RECORD_FRAME       = 0;
+static constexpr uint8_t RECORD_CHIP_SELECT = 1;
+static constexpr uint8_t RECORD_INIT        = 2;
+static constexpr uint8_t RECORD_TIME        = 3;
+
+static constexpr size_t   RECORD_HEADER_SIZE = 8;
+static constexpr uint16_t MAX_FRAME_BYTES    = 4096;
+}; // namespace SPI_RECORDING
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef SPSC_RING_DOT_AITCH
+#define SPSC_RING_DOT_AITCH
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+
+// Fixed-capacity, lock-free ring buffer for exactly one producer (e.g. the DRDY ISR) and
+// exactly one consumer thread. No allocation, no locks, so it's safe to push from interrupt
+// context. Capacity has to be a power of two so the indices can just wrap with a mask.
+template <typename T, size_t Capacity> class SpscRing
+{
+    static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity must be a power of two");
+    static constexpr size_t MASK = Capacity - 1;
+
+    // Producer and consumer indices live on separate cache lines so they don't ping-pong
+    alignas(64) std::atomic<size_t> head; // Next slot to write (only the producer stores this)
+    alignas(64) std::atomic<size_t> tail; // Next slot to read (only the consumer stores this)
+    alignas(64) std::array<T, Capacity> slots;
+
+  public:
+    SpscRing() : head(0), tail(0) {}
+
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Producer side. Returns false (and drops the item) if the consumer has fallen behind
+    bool push(const T &item)
+    {
+      const size_t h = head.load(std::memory_order_relaxed);
+      if (h - tail.load(std::memory_order_acquire) == Capacity)
+      {
+        return false;
+      }
+
+      slots[h & MASK] = item;
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Consumer side
+    bool pop(T &item)
+    {
+      const size_t t = tail.load(std::memory_order_relaxed);
+      if (t == head.load(std::memory_order_acquire))
+      {
+        return false;
+      }
+
+      item = slots[t & MASK];
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Consumer side: drain up to max_items in one go with a single index update
+    size_t pop_bulk(T *dest, size_t max_items)
+    {
+      const size_t t     = tail.load(std::memory_order_relaxed);
+      const size_t avail = head.load(std::memory_order_acquire) - t;
+      const size_t count = (avail < max_items) ? avail : max_items;
+
+      for (size_t n = 0; n < count; ++n)
+      {
+        dest[n] = slots[(t + n) & MASK];
+      }
+
+      tail.store(t + count, std::memory_order_release);
+      return count;
+    }
+
+    // Approximate when called while the other side is running
+    size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    bool   empty() const { return size() == 0; }
+
+    // Only safe while neither side is running
+    void clear()
+    {
+      head.store(0, std::memory_order_relaxed);
+      tail.store(0, std::memory_order_relaxed);
+    }
+};
+
+#endif
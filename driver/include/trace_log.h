@@ -0,0 +1,130 @@
+// Low-overhead binary trace log for the driver and the emulator
+//
+// Call sites record small fixed-size events into a lock-free in-memory ring instead of
+// formatting text. Turning events into text happens later, off the hot path, either from a
+// TraceDrainer thread or by dumping the raw records to a file for offline decoding.
+//
+// The level is picked at compile time with ADS_TRACE_LEVEL:
+//   0 = off (every ADS_TRACE_* macro expands to nothing), 1 = errors, 2 = info, 3 = debug
+
+#ifndef TRACE_LOG_DOT_AITCH
+#define TRACE_LOG_DOT_AITCH
+
+#include <array>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+
+#ifndef ADS_TRACE_LEVEL
+#define ADS_TRACE_LEVEL 2
+#endif
+
+namespace TRACE_LEVEL
+{
+static constexpr uint8_t OFF   = 0;
+static constexpr uint8_t ERROR = 1;
+static constexpr uint8_t INFO  = 2;
+static constexpr uint8_t DEBUG = 3;
+}; // namespace TRACE_LEVEL
+
+// Add new events at the end; the numbers end up in dump files
+enum class TraceEvent : uint16_t
+{
+  WAIT_FOR_READY = 0, // arg0: unused
+  STATUS_POLL,        // arg0: STATUS register value
+  SAMPLE_DROPPED,     // arg0: total dropped so far
+  EMU_RDATA,          // arg0: INPMUX register value, arg1: conversion result
+  CRC_ERROR,          // arg0: total CRC errors so far, arg1: conversion result as received
+  UNKNOWN_DEVICE,     // arg0: ID read from the device, arg1: ID expected (0 = any of the family)
+  CALIBRATION,        // arg0: calibration command, arg1: OFCAL << 16 | FSCAL afterwards
+  READY_TIMEOUT,      // arg0: STATUS register value
+  INITIALIZED,        // arg0: 1 if the configuration was already in place, arg1: nanos it took
+  CONFIG_MISMATCH,    // arg0: register, arg1: value written << 8 | value read back
+  NUM_EVENTS
+};
+
+// One entry in the log. Fixed size so it can be copied around (and dumped) as-is
+struct TraceRecord
+{
+  uint64_t timestamp_nanos;
+  uint16_t event;
+  uint8_t  level;
+  uint8_t  reserved;
+  uint32_t arg0;
+  uint32_t arg1;
+};
+
+// Bounded multi-producer / single-consumer ring. Producers never block: if the drainer has
+// fallen behind and the ring is full, the event is counted as dropped and thrown away.
+class TraceLog
+{
+  public:
+    inline static const size_t CAPACITY = 4096;
+
+    TraceLog();
+
+    void record(uint8_t level, TraceEvent event, uint32_t arg0 = 0, uint32_t arg1 = 0);
+
+    // Consumer side. Copies up to max_records out of the ring, oldest first
+    size_t drain(TraceRecord *dest, size_t max_records);
+    // Drain everything currently in the ring as text, one line per event
+    size_t drain_to(FILE *out);
+    // Drain everything currently in the ring as raw TraceRecords for offline decoding
+    size_t dump_binary(FILE *out);
+
+    uint32_t get_dropped(void) { return dropped.load(std::memory_order_relaxed); }
+
+    static int         format(const TraceRecord &rec, char *buf, size_t buf_size);
+    static const char *event_name(uint16_t event);
+
+  private:
+    struct Slot
+    {
+      std::atomic<size_t> sequence;
+      TraceRecord         rec;
+    };
+
+    static constexpr size_t MASK = CAPACITY - 1;
+
+    alignas(64) std::atomic<size_t> head; // Next slot producers claim
+    alignas(64) size_t tail;              // Next slot the consumer reads
+    alignas(64) std::array<Slot, CAPACITY> slots;
+    std::atomic<uint32_t> dropped;
+};
+
+// The one log everything records into
+TraceLog &trace_log(void);
+
+// Background thread that periodically formats whatever's in the log to a FILE
+class TraceDrainer
+{
+    FILE             *out;
+    std::atomic<bool> running;
+    std::thread       worker;
+
+  public:
+    TraceDrainer(FILE *out);
+    ~TraceDrainer();
+};
+
+#if ADS_TRACE_LEVEL >= 1
+#define ADS_TRACE_ERROR(event, ...) trace_log().record(TRACE_LEVEL::ERROR, event, ##__VA_ARGS__)
+#else
+#define ADS_TRACE_ERROR(event, ...) ((void)0)
+#endif
+
+#if ADS_TRACE_LEVEL >= 2
+#define ADS_TRACE_INFO(event, ...) trace_log().record(TRACE_LEVEL::INFO, event, ##__VA_ARGS__)
+#else
+#define ADS_TRACE_INFO(event, ...) ((void)0)
+#endif
+
+#if ADS_TRACE_LEVEL >= 3
+#define ADS_TRACE_DEBUG(event, ...) trace_log().record(TRACE_LEVEL::DEBUG, event, ##__VA_ARGS__)
+#else
+#define ADS_TRACE_DEBUG(event, ...) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+// Conversion results to volts, a block at a time
+//
+// A result is a 16-bit two's complement code; full scale is +/- VREF / gain, so one code is
+// worth VREF / (gain * 2^15) volts (datasheet, Data Format). Both come from registers: the gain
+// from PGA, the reference from REFSEL in REF. The voltages on the external reference pins are a
+// property of the board, so they're passed in.
+//
+// The coefficient is only worked out again when the gain or reference settings differ from the
+// last update(), so calling update() before every block is cheap. Converting a block is then one
+// multiply per sample in a straight loop the compiler can vectorize.
+//
+// OFCAL and FSCAL don't come into it: the device applies them to every conversion before the
+// result is clocked out (datasheet, Calibration), so correcting the codes for them again here
+// would count the calibration twice.
+
+#ifndef UNIT_CONVERTER_DOT_AITCH
+#define UNIT_CONVERTER_DOT_AITCH
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "adc_constants.h"
+
+class UnitConverter
+{
+  public:
+    UnitConverter(double refp0_refn0_volts = 2.5, double refp1_refn1_volts = 2.5);
+
+    // Voltage across REFP0 - REFN0 (refsel_input 0) or REFP1 - REFN1 (1)
+    void set_external_reference(uint8_t refsel_input, double volts);
+
+    // Work out the coefficient for these PGA and REF settings, unless they're the ones it already
+    // has. Returns true if it changed.
+    bool update(uint8_t pga_reg, uint8_t ref_reg);
+
+    // Same, using a driver's shadow of PGA and REF
+    template <typename Driver> bool update(Driver &driver)
+    {
+      return update(driver.get_cached_register(ADS114S08_REGISTERS::PGA), driver.get_cached_register(ADS114S08_REGISTERS::REF));
+    }
+
+    uint8_t get_gain(void) { return gain; }
+    // NaN with the reserved REFSEL setting, and so is everything converted with it
+    double get_reference_volts(void) { return reference_volts; }
+    float  get_volts_per_code(void) { return volts_per_code; }
+
+    float to_volts(uint16_t code) { return static_cast<int16_t>(code) * volts_per_code; }
+    float to_microvolts(uint16_t code) { return static_cast<int16_t>(code) * microvolts_per_code; }
+
+    // dest[n] = codes[n] in volts / microvolts, n < num_samples
+    void to_volts(const uint16_t *codes, float *dest, size_t num_samples);
+    void to_microvolts(const uint16_t *codes, float *dest, size_t num_samples);
+
+  private:
+    double external_reference_volts[2];
+
+    // PGA (PGA_EN and GAIN) and REF (REFSEL) the coefficients were worked out for; valid is false
+    // until the first update()
+    uint8_t pga_reg;
+    uint8_t ref_reg;
+    bool    valid;
+
+    uint8_t gain;
+    double  reference_volts;
+    float   volts_per_code;
+    float   microvolts_per_code;
+
+    void recalculate(void);
+    static void scale_codes(const uint16_t *codes, float *dest, size_t num_samples, float scale);
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef VIRTUAL_CLOCK_DOT_AITCH
+#define VIRTUAL_CLOCK_DOT_AITCH
+
+#include <atomic>
+
+#include "i_clock.h"
+
+// Simulated time for running against the emulator. A delay doesn't wait at all: it just moves
+// the clock forward and tells the listener (the emulated hardware) how much time went by, so
+// conversions, DRDY etc. happen exactly when they would have, at full speed.
+class VirtualClock : public IClock
+{
+    std::atomic<uint64_t> now;
+
+    void (*listener)(void *context, uint64_t elapsed_nanos);
+    void *listener_context;
+
+  public:
+    VirtualClock() : now(0), listener(nullptr), listener_context(nullptr) {}
+
+    virtual uint64_t now_nanos(void) override { return now.load(std::memory_order_relaxed); }
+    virtual void     delay_nanos(uint64_t nanos) override { advance(nanos); }
+
+    void advance(uint64_t nanos)
+    {
+      now.fetch_add(nanos, std::memory_order_relaxed);
+      if (listener)
+      {
+        listener(listener_context, nanos);
+      }
+    }
+
+    void set_listener(void (*on_advance)(void *, uint64_t), void *context)
+    {
+      listener         = on_advance;
+      listener_context = context;
+    }
+};
+
+#endif
@@ -1,12 +1,61 @@
 #include "adc_emulator.h"
 #include "adc_constants.h"
+#include "crc8.h"
+#include "trace_log.h"
 #include <array>
-#include <iomanip>
-#include <iostream>
+#include <cmath>
+
+// Conversion results are 16-bit two's complement and saturate at 7FFFh / 8000h
+static inline uint16_t clip_to_code(int64_t value)
+{
+  return static_cast<uint16_t>((value > INT16_MAX) ? INT16_MAX : ((value < INT16_MIN) ? INT16_MIN : value));
+}
+
+// Every possible first command byte maps straight to its handler. Anything the datasheet
+// doesn't define (or we don't emulate yet) is ignored, like the real device would.
+constexpr std::array<ADS114S08_Emulator::CommandHandler, 256> ADS114S08_Emulator::build_command_table(void)
+{
+  std::array<CommandHandler, 256> table{};
+  for (auto &handler : table)
+  {
+    handler = &ADS114S08_Emulator::handle_ignored_command;
+  }
+
+  // 0000 011x, 0000 100x, 0000 101x, 0001 001x
+  table[ADS114S08_CMD::RESET]     = table[ADS114S08_CMD::RESET | 0x01] = &ADS114S08_Emulator::handle_reset_command;
+  table[ADS114S08_CMD::START]     = table[ADS114S08_CMD::START | 0x01] = &ADS114S08_Emulator::handle_start_command;
+  table[ADS114S08_CMD::STOP]      = table[ADS114S08_CMD::STOP | 0x01]  = &ADS114S08_Emulator::handle_stop_command;
+  table[ADS114S08_CMD::POWERDOWN] = table[ADS114S08_CMD::POWERDOWN | 0x01] = &ADS114S08_Emulator::handle_stop_command;
+  table[ADS114S08_CMD::RDATA]     = table[ADS114S08_CMD::RDATA | 0x01] = &ADS114S08_Emulator::handle_rdata_command;
+
+  // 0001 0110, 0001 0111, 0001 1001
+  table[ADS114S08_CMD::SYOCAL] = &ADS114S08_Emulator::handle_calibration_command;
+  table[ADS114S08_CMD::SYGCAL] = &ADS114S08_Emulator::handle_calibration_command;
+  table[ADS114S08_CMD::SFOCAL] = &ADS114S08_Emulator::handle_calibration_command;
+
+  // 001r rrrr (RREG) and 010r rrrr (WREG)
+  for (uint8_t addr = 0; addr < 0x20; ++addr)
+  {
+    table[ADS114S08_CMD::RREG_1ST | addr] = &ADS114S08_Emulator::handle_register_command;
+    table[ADS114S08_CMD::WREG_1ST | addr] = &ADS114S08_Emulator::handle_register_command;
+  }
+
+  return table;
+}
+
+const std::array<ADS114S08_Emulator::CommandHandler, 256> ADS114S08_Emulator::command_table =
+    ADS114S08_Emulator::build_command_table();
 
 ADS114S08_Emulator::ADS114S08_Emulator(uint8_t *const copi, uint8_t *const cipo, bool simulate_startup_delay)
-    : simulate_startup_delay(simulate_startup_delay), COPI(copi), CIPO(cipo)
+    : COPI(copi), CIPO(cipo), ready_nanos(simulate_startup_delay ? ADS114S08_TIMING::POWERUP_SETTLING_NANOS : 0),
+      elapsed_nanos(0), advancing(false), drdy_isr(nullptr), drdy_isr_context(nullptr), completed_conversions(0),
+      timing_accurate(true), offset_error(0), gain_error(1.0),
+      device_id(ADS114S08_REGISTERS::RESET_VALUES[ADS114S08_REGISTERS::ID])
 {
+  signal_block_pos        = 0;
+  signal_block_len        = 0;
+  signal_block_mux        = 0xff;
+  signal_block_next_nanos = 0;
   reset();
 }
 
@@ -20,33 +69,48 @@ void ADS114S08_Emulator::simulate_spi_write(uint8_t data)
   *CIPO = data;
 }
 
+void ADS114S08_Emulator::push_output(uint8_t data)
+{
+  if (output_count < OUTPUT_FIFO_SIZE)
+  {
+    output_fifo[(output_head + output_count) % OUTPUT_FIFO_SIZE] = data;
+    ++output_count;
+  }
+}
+
+uint8_t ADS114S08_Emulator::pop_output(void)
+{
+  const uint8_t data = output_fifo[output_head];
+  output_head        = (output_head + 1) % OUTPUT_FIFO_SIZE;
+  --output_count;
+  return data;
+}
+
 void ADS114S08_Emulator::simulate_outgoing_data(void)
 {
-  if (!output_buffer.empty())
+  if (output_count)
   {
-    uint8_t val = output_buffer.back();
-    output_buffer.pop_back();
-    simulate_spi_write(val);
+    simulate_spi_write(pop_output());
   }
   else if (read_counter)
   {
     --read_counter;
     if (reg_pointer < registers.size())
     {
-      if (simulate_startup_delay && (reg_pointer == ADS114S08_REGISTERS::STATUS))
+      // Still powering up: RDY reads 1 until it's done, then clears for good
+      if (ready_nanos && (reg_pointer == ADS114S08_REGISTERS::STATUS))
       {
-        registers[reg_pointer] |= 0x01 << 5;
-        static uint8_t tries = 3;
-        if (tries)
+        if (elapsed_nanos < ready_nanos)
         {
-          --tries;
+          registers[reg_pointer] |= ADS114S08_STATUS::RDY;
         }
         else
         {
-          registers[reg_pointer] &= ~(0x01 << 5);
+          registers[reg_pointer] &= ~ADS114S08_STATUS::RDY;
+          ready_nanos = 0;
         }
       }
-      simulate_spi_write(registers.at(reg_pointer));
+      simulate_spi_write(registers[reg_pointer]);
       ++reg_pointer;
     }
     else
@@ -54,6 +118,13 @@ void ADS114S08_Emulator::simulate_outgoing_data(void)
       simulate_spi_write(0);
     }
   }
+  else if (direct_read_bytes)
+  {
+    // Direct read: no command, just clock the conversion result out of the shift register
+    drdy_low = false;
+    simulate_spi_write(output_shift_register[output_shift_bytes - direct_read_bytes]);
+    --direct_read_bytes;
+  }
   else
   {
     simulate_spi_write(0);
@@ -65,11 +136,25 @@ void ADS114S08_Emulator::store_new_data(uint8_t data)
   --write_counter;
   if (reg_pointer < registers.size())
   {
+    // Writing a configuration register restarts the conversion in progress
+    if ((reg_pointer >= ADS114S08_REGISTERS::INPMUX) && (reg_pointer <= ADS114S08_REGISTERS::IDAC_MUX))
+    {
+      restart_pending = true;
+    }
     registers[reg_pointer] = data;
     ++reg_pointer;
   }
   // else
   // Nowhere to put the data, so just ignore it
+
+  if (!write_counter && restart_pending)
+  {
+    restart_pending = false;
+    if (converting)
+    {
+      restart_conversion();
+    }
+  }
 }
 
 void ADS114S08_Emulator::handle_two_byte_command(uint8_t data)
@@ -91,38 +176,167 @@ void ADS114S08_Emulator::handle_two_byte_command(uint8_t data)
   }
 }
 
-void ADS114S08_Emulator::handle_rdata_command(void)
+// NOP, WAKEUP and anything undefined (calibration commands go to handle_calibration_command())
+void ADS114S08_Emulator::handle_ignored_command(uint8_t data)
 {
-  uint8_t  inmux_reg = registers.at(ADS114S08_REGISTERS::INPMUX);
-  uint16_t pos_input = inmux_reg >> 4;
-  uint16_t neg_input = inmux_reg & 0x0f;
+  (void)data;
+}
 
-  storage_buffer = FAKE_VOLTAGES.at(pos_input);
+void ADS114S08_Emulator::handle_reset_command(uint8_t data)
+{
+  (void)data;
+  reset_registers();
+}
 
-  std::cout << "IN+ = ";
-  if (pos_input < 12)
-    std::cout << pos_input;
-  else if (pos_input == 12)
-    std::cout << "GND";
-  else
-    std::cout << "RESERVED";
+void ADS114S08_Emulator::handle_start_command(uint8_t data)
+{
+  (void)data;
+  // START while already converting restarts the conversion, same as from standby
+  converting = true;
+  restart_conversion();
+}
 
-  std::cout << ", IN- = ";
-  if (neg_input < 12)
-    std::cout << neg_input;
-  else if (neg_input == 12)
-    std::cout << "GND";
+// STOP (and POWERDOWN, which stops conversions too)
+void ADS114S08_Emulator::handle_stop_command(uint8_t data)
+{
+  (void)data;
+  converting = false;
+}
+
+// Handle RDATA by loading conversion data to the output buffer and then
+// clocking it out on the next two to four byte transfers
+void ADS114S08_Emulator::handle_rdata_command(uint8_t data)
+{
+  (void)data;
+  // While converting, RDATA returns whatever finished last (which may well still be from
+  // the previous mux setting), and in standby it's the last conversion before that. Only a
+  // test that has asked for the shortcut gets the input sampled on the spot.
+  const uint16_t storage_buffer = (converting || timing_accurate) ? conversion_data : sample_input();
+  drdy_low                      = false;
+  ADS_TRACE_DEBUG(TraceEvent::EMU_RDATA, registers[ADS114S08_REGISTERS::INPMUX], storage_buffer);
+
+  uint8_t       frame[ADS114S08_SYS::MAX_DATA_FRAME_BYTES];
+  const uint8_t len = build_data_frame(storage_buffer, frame);
+  for (uint8_t n = 0; n < len; ++n)
+  {
+    push_output(frame[n]);
+  }
+}
+
+// Conversion data readback - datasheet p. 69. The STATUS byte is the STATUS register as it
+// stands, and the CRC covers everything before it.
+uint8_t ADS114S08_Emulator::build_data_frame(uint16_t value, uint8_t *frame)
+{
+  const uint8_t sys = registers[ADS114S08_REGISTERS::SYS];
+  uint8_t       len = 0;
+
+  if (sys & ADS114S08_SYS::SENDSTAT)
+  {
+    frame[len++] = registers[ADS114S08_REGISTERS::STATUS];
+  }
+  frame[len++] = value >> 8;
+  frame[len++] = value & 0xff;
+  if (sys & ADS114S08_SYS::CRC)
+  {
+    frame[len] = ADS114S08_CRC::crc8(frame, len);
+    ++len;
+  }
+  return len;
+}
+
+// Byte 0 of RREG or WREG: latch the starting address and wait for the count byte
+void ADS114S08_Emulator::handle_register_command(uint8_t data)
+{
+  reg_pointer    = (data & 0x1f);
+  input_register = data;
+}
+
+// SYOCAL, SYGCAL and SFOCAL - see datasheet p. 63
+// Once the filter has settled, the device averages CAL_SAMP conversions and writes the result to
+// OFCAL or FSCAL:
+//   SFOCAL  Inputs shorted internally, so OFCAL = the converter's own offset
+//   SYOCAL  The selected inputs, which the system holds at its zero point: OFCAL = what they read
+//   SYGCAL  The selected inputs, held at full scale: FSCAL = whatever makes them read 7FFFh
+// The conversions are worked out up front from the signals at the times they'd happen, and the
+// register changes straight away. Conversions start over once the calibration time is up, so
+// nothing gets to read a result in between.
+void ADS114S08_Emulator::handle_calibration_command(uint8_t data)
+{
+  const uint8_t  datarate    = registers[ADS114S08_REGISTERS::DATARATE];
+  const uint8_t  sys         = registers[ADS114S08_REGISTERS::SYS];
+  const uint8_t  num_samples = ADS114S08_SYS::calibration_samples(sys);
+  const uint64_t first_nanos = elapsed_nanos + ADS114S08_DATARATE::settling_nanos(datarate);
+
+  uint16_t inputs[ADS114S08_SYS::MAX_CALIBRATION_SAMPLES] = {};
+  if (data != ADS114S08_CMD::SFOCAL)
+  {
+    generate_mux(selected_mux(), first_nanos, conversion_period_nanos(), inputs, num_samples);
+  }
+  int32_t sum = 0;
+  for (uint8_t n = 0; n < num_samples; ++n)
+  {
+    sum += static_cast<int16_t>(apply_conversion_errors(inputs[n]));
+  }
+  const int32_t average = (sum + ((sum < 0) ? -num_samples : num_samples) / 2) / num_samples;
+
+  if (data == ADS114S08_CMD::SYGCAL)
+  {
+    const int32_t offset = static_cast<int16_t>(registers[ADS114S08_REGISTERS::OFCAL0] |
+                                                (registers[ADS114S08_REGISTERS::OFCAL1] << 8));
+    const int32_t span   = average - offset;
+    // Nothing (or less than nothing) above the offset can't be scaled up to full scale
+    if (span > 0)
+    {
+      const int64_t fscal = (static_cast<int64_t>(ADS114S08_CAL::FSCAL_UNITY) * INT16_MAX + span / 2) / span;
+      const uint16_t value = static_cast<uint16_t>((fscal > UINT16_MAX) ? UINT16_MAX : fscal);
+      registers[ADS114S08_REGISTERS::FSCAL0] = value & 0xff;
+      registers[ADS114S08_REGISTERS::FSCAL1] = value >> 8;
+    }
+  }
   else
-    std::cout << "RESERVED";
-  std::cout << std::endl;
+  {
+    registers[ADS114S08_REGISTERS::OFCAL0] = static_cast<uint16_t>(average) & 0xff;
+    registers[ADS114S08_REGISTERS::OFCAL1] = static_cast<uint16_t>(average) >> 8;
+  }
 
-  // Just emulating single-ended reads for now
+  if (converting)
+  {
+    next_conversion_nanos = elapsed_nanos + ADS114S08_SYS::calibration_nanos(datarate, sys) +
+                            ADS114S08_CONVERSION::first_result_nanos(datarate, registers[ADS114S08_REGISTERS::PGA]);
+    direct_read_bytes = 0;
+  }
+}
 
-  uint8_t msb = (storage_buffer >> 8);
-  uint8_t lsb = (storage_buffer & 0xff);
+uint16_t ADS114S08_Emulator::apply_conversion_errors(uint16_t input)
+{
+  int64_t value = static_cast<int16_t>(input);
+  if (gain_error != 1.0)
+  {
+    value = std::llround(value * gain_error);
+  }
+  return clip_to_code(value + offset_error);
+}
+
+// Every result leaves the device as (result - OFCAL) * FSCAL / 4000h
+uint16_t ADS114S08_Emulator::apply_calibration(uint16_t result)
+{
+  const int16_t  ofcal = static_cast<int16_t>(registers[ADS114S08_REGISTERS::OFCAL0] |
+                                             (registers[ADS114S08_REGISTERS::OFCAL1] << 8));
+  const uint16_t fscal = registers[ADS114S08_REGISTERS::FSCAL0] | (registers[ADS114S08_REGISTERS::FSCAL1] << 8);
+  const int64_t  value = (static_cast<int64_t>(static_cast<int16_t>(result)) - ofcal) * fscal;
+  return clip_to_code((value + ADS114S08_CAL::FSCAL_UNITY / 2) >> 14);
+}
+
+void ADS114S08_Emulator::set_conversion_errors(int16_t offset_codes, double gain)
+{
+  offset_error = offset_codes;
+  gain_error   = gain;
+}
 
-  output_buffer.push_back(lsb);
-  output_buffer.push_back(msb);
+void ADS114S08_Emulator::set_device_id(uint8_t id)
+{
+  device_id                          = id;
+  registers[ADS114S08_REGISTERS::ID] = id;
 }
 
 void ADS114S08_Emulator::simulate_op()
@@ -139,124 +353,222 @@ void ADS114S08_Emulator::simulate_op()
     return store_new_data(data);
   }
 
+  // Anything other than a NOP means the controller has moved on from a direct read
+  if (data != ADS114S08_CMD::NOP)
+  {
+    direct_read_bytes = 0;
+  }
+
   // If previously received byte 0 of a WREG or RREG command, this is byte 1
   if (input_register)
   {
     return handle_two_byte_command(data);
   }
 
-  // Handle RDATA by loading conversion data to the output buffer and then
-  // clocking it out on the next two byte transfers
-  if ((data & ~0x01) == ADS114S08_CMD::RDATA)
+  // NOPs are most of the traffic (clocking out reads), so don't bother with a lookup for them
+  if (data != ADS114S08_CMD::NOP)
   {
-    return handle_rdata_command();
+    (this->*command_table[data])(data);
   }
+}
 
-  if (data == ADS114S08_CMD::NOP)
+void ADS114S08_Emulator::simulate_frame(const uint8_t *tx, uint8_t *rx, size_t len)
+{
+  for (size_t n = 0; n < len; ++n)
   {
-    return;
+    *COPI = tx[n];
+    simulate_op();
+    if (rx)
+    {
+      rx[n] = *CIPO;
+    }
   }
+}
 
-  // Check for RREG / WREG
-  uint8_t tmp = data & ~0b11111;
-
-  // TODO: you could make these constants :-/
-  uint8_t read_cmd  = (ADS114S08_CMD::RREG_1ST & ~0b11111);
-  uint8_t write_cmd = (ADS114S08_CMD::WREG_1ST & ~0b11111);
+// Power-on reset: registers go back to their defaults and each analog input gets a new flat level
+void ADS114S08_Emulator::reset()
+{
+  reset_registers();
 
-  // Handle byte 0 of RREG or WREG command
-  if ((tmp == read_cmd) || (tmp == write_cmd))
+  for (uint8_t input = 0; input < SignalEngine::NUM_INPUTS; ++input)
   {
-    reg_pointer    = (data & 0x1f);
-    input_register = data;
-    return;
+    signals.set_dc(input, generate_adc_value());
   }
-
-  // TODO: emulate responses to whatever additional commands you want
 }
 
-void ADS114S08_Emulator::reset()
+// RESET command - see datasheet p. 64
+// Puts the registers back to their defaults and resets the serial interface. The analog
+// inputs aren't part of the device, so they're left alone.
+void ADS114S08_Emulator::reset_registers()
 {
-  storage_buffer = 0;
   reg_pointer    = 0;
   read_counter   = 0;
   write_counter  = 0;
   input_register = 0;
 
-  while (!output_buffer.empty())
-  {
-    output_buffer.pop_back();
-  }
-
-  // Python: all_the_addrs = [addr for addr in filter(lambda x: not x.startswith('_'), dir(ADS114S08_REGISTERS))]
-  // but it's probably 300 times slower
-  uint8_t all_the_addrs[] = {ADS114S08_REGISTERS::ID,
-                             ADS114S08_REGISTERS::STATUS,
-                             ADS114S08_REGISTERS::INPMUX,
-                             ADS114S08_REGISTERS::PGA,
-                             ADS114S08_REGISTERS::DATARATE,
-                             ADS114S08_REGISTERS::REF,
-                             ADS114S08_REGISTERS::IDACMAG,
-                             ADS114S08_REGISTERS::IDAC_MUX,
-                             ADS114S08_REGISTERS::VBIAS,
-                             ADS114S08_REGISTERS::SYS,
-                             ADS114S08_REGISTERS::RESERVED0,
-                             ADS114S08_REGISTERS::OFCAL0,
-                             ADS114S08_REGISTERS::OFCAL1,
-                             ADS114S08_REGISTERS::RESERVED1,
-                             ADS114S08_REGISTERS::FSCAL0,
-                             ADS114S08_REGISTERS::FSCAL1,
-                             ADS114S08_REGISTERS::GPIODAT,
-                             ADS114S08_REGISTERS::GPIOCON};
-
-  // registers.clear();
+  converting            = false;
+  drdy_low              = false;
+  restart_pending       = false;
+  next_conversion_nanos = 0;
+  conversion_data       = 0;
+  output_shift_register = {};
+  output_shift_bytes    = 0;
+  direct_read_bytes     = 0;
+
+  output_head  = 0;
+  output_count = 0;
+
   // Defaults - see datasheet p. 70
-  for (auto addr : all_the_addrs)
+  for (uint8_t addr = 0; addr < ADS114S08_REGISTERS::NUM_REGISTERS; ++addr)
   {
-    uint8_t reg_val = 0;
-    switch (addr)
+    registers[addr] = ADS114S08_REGISTERS::RESET_VALUES[addr];
+  }
+  registers[ADS114S08_REGISTERS::ID] = device_id;
+}
+
+void ADS114S08_Emulator::attach_drdy_isr(void (*isr)(void *), void *context)
+{
+  drdy_isr         = isr;
+  drdy_isr_context = context;
+}
+
+uint32_t ADS114S08_Emulator::conversion_period_nanos(void)
+{
+  return static_cast<uint32_t>(ADS114S08_CONVERSION::result_period_nanos(registers[ADS114S08_REGISTERS::DATARATE],
+                                                                         registers[ADS114S08_REGISTERS::PGA]));
+}
+
+uint8_t ADS114S08_Emulator::selected_mux(void)
+{
+  return registers[ADS114S08_REGISTERS::INPMUX];
+}
+
+// Conversion results for INPMUX = mux: positive input minus negative input, in 16-bit two's
+// complement. Input levels are in output codes relative to AINCOM, so AINCOM reads zero and a
+// single-ended result is just the positive input. A difference past full scale clips at 7FFFh
+// or 8000h, as the device's output does. A reserved mux code connects nothing, and the result
+// is zero.
+void ADS114S08_Emulator::generate_mux(uint8_t mux, uint64_t t0_nanos, uint64_t step_nanos, uint16_t *dest,
+                                      uint8_t num_samples)
+{
+  const uint8_t ch_plus  = mux >> 4;
+  const uint8_t ch_minus = mux & 0x0f;
+  if ((ch_plus > ADS114S08_INPMUX::AINCOM) || (ch_minus > ADS114S08_INPMUX::AINCOM))
+  {
+    for (uint8_t n = 0; n < num_samples; ++n)
     {
-    case ADS114S08_REGISTERS::ID:
-      reg_val = 0x04; // ID for ADS114S08
-      break;
+      dest[n] = 0;
+    }
+    return;
+  }
 
-    case ADS114S08_REGISTERS::STATUS:
-      reg_val = 0x80;
-      break;
+  signals.generate(ch_plus, t0_nanos, step_nanos, dest, num_samples);
+  if (ch_minus == ADS114S08_INPMUX::AINCOM)
+  {
+    return;
+  }
 
-    case ADS114S08_REGISTERS::INPMUX:
-      reg_val = 0x01;
-      break;
+  signals.generate(ch_minus, t0_nanos, step_nanos, signal_block_minus.data(), num_samples);
+  for (uint8_t n = 0; n < num_samples; ++n)
+  {
+    dest[n] = clip_to_code(static_cast<int32_t>(static_cast<int16_t>(dest[n])) - static_cast<int16_t>(signal_block_minus[n]));
+  }
+}
 
-    case ADS114S08_REGISTERS::DATARATE:
-      reg_val = 0x14;
-      break;
+// What the selected inputs give right now
+uint16_t ADS114S08_Emulator::sample_input(void)
+{
+  uint16_t value;
+  generate_mux(selected_mux(), elapsed_nanos, 0, &value, 1);
+  return apply_calibration(apply_conversion_errors(value));
+}
 
-    case ADS114S08_REGISTERS::REF:
-      reg_val = 0x10;
-      break;
+uint16_t ADS114S08_Emulator::get_differential_test_val(uint8_t ch_plus, uint8_t ch_minus)
+{
+  uint16_t value;
+  generate_mux(static_cast<uint8_t>((ch_plus << 4) | (ch_minus & 0x0f)), elapsed_nanos, 0, &value, 1);
+  return apply_calibration(apply_conversion_errors(value));
+}
 
-    case ADS114S08_REGISTERS::IDAC_MUX:
-      reg_val = 0xff;
-      break;
+// Result of the conversion finishing at t_nanos. In steady state that's the next entry of the
+// current block. A new mux setting, data rate or signal (or a restart) throws the block away; since a
+// scan does that on every conversion, the block size starts at one again and only doubles (up
+// to SIGNAL_BLOCK_SIZE) while the same inputs keep converting.
+uint16_t ADS114S08_Emulator::convert_input_at(uint64_t t_nanos)
+{
+  const uint8_t  mux         = selected_mux();
+  const uint32_t step        = conversion_period_nanos();
+  const bool     same_stream = (mux == signal_block_mux) && (t_nanos == signal_block_next_nanos) &&
+                           (step == signal_block_step_nanos) && (signals.get_generation() == signal_block_generation);
 
-    case ADS114S08_REGISTERS::SYS:
-      reg_val = 0x10;
-      break;
+  if (!same_stream || (signal_block_pos >= signal_block_len))
+  {
+    const uint8_t len = !same_stream ? 1 : ((signal_block_len < SIGNAL_BLOCK_SIZE / 2) ? 2 * signal_block_len : SIGNAL_BLOCK_SIZE);
+    generate_mux(mux, t_nanos, step, signal_block.data(), len);
+    signal_block_pos        = 0;
+    signal_block_len        = len;
+    signal_block_mux        = mux;
+    signal_block_generation = signals.get_generation();
+    signal_block_step_nanos = step;
+  }
 
-    case ADS114S08_REGISTERS::FSCAL1:
-      reg_val = 0x40;
-      break;
+  signal_block_next_nanos = t_nanos + step;
+  return apply_calibration(apply_conversion_errors(signal_block[signal_block_pos++]));
+}
 
-    default:
-      break;
-    }
-    registers[addr] = reg_val;
+// The DRDY ISR's own bus traffic lets time pass too, which lands back here. Only the outermost
+// call completes conversions, so they always reach the ISR in order.
+void ADS114S08_Emulator::advance_time(uint64_t nanos)
+{
+  elapsed_nanos += nanos;
+  if (advancing)
+  {
+    return;
+  }
+
+  advancing = true;
+  while (converting && (elapsed_nanos >= next_conversion_nanos))
+  {
+    const uint64_t done_at = next_conversion_nanos;
+    next_conversion_nanos += conversion_period_nanos();
+    complete_conversion(done_at);
+  }
+  advancing = false;
+}
+
+// The digital filter starts over, so the first result only shows up once the start delay has
+// passed and the filter has settled; after that, results follow every conversion period
+void ADS114S08_Emulator::restart_conversion(void)
+{
+  next_conversion_nanos = elapsed_nanos + ADS114S08_CONVERSION::first_result_nanos(registers[ADS114S08_REGISTERS::DATARATE],
+                                                                                    registers[ADS114S08_REGISTERS::PGA]);
+  direct_read_bytes     = 0;
+  drdy_low              = false;
+}
+
+// New data is ready: latch it, load the output shift register and pull DRDY low. The device
+// won't load the shift register while a register read or write is in progress - see datasheet p. 63.
+// In single-shot mode that was the only conversion, and the device goes back to standby.
+void ADS114S08_Emulator::complete_conversion(uint64_t t_nanos)
+{
+  conversion_data = convert_input_at(t_nanos);
+  ++completed_conversions;
+  if (registers[ADS114S08_REGISTERS::DATARATE] & ADS114S08_DATARATE::MODE)
+  {
+    converting = false;
   }
+  if (read_counter || write_counter || input_register)
+  {
+    return;
+  }
+
+  output_shift_bytes = build_data_frame(conversion_data, output_shift_register.data());
+  direct_read_bytes  = output_shift_bytes;
+  drdy_low           = true;
 
-  for (auto &channel_reading : FAKE_VOLTAGES)
+  if (drdy_isr)
   {
-    channel_reading = generate_adc_value();
+    drdy_isr(drdy_isr_context);
   }
 }
 
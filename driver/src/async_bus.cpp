@@ -0,0 +1,338 @@
+#include <cstring>
+
+#include "async_bus.h"
+
+AsyncBus::AsyncBus(SpiBus &bus)
+    : clock(bus.get_clock()), requests{}, free_list(0), devices{}, num_devices(0), pending(0), next_id(1)
+{
+  for (size_t n = 0; n < MAX_REQUESTS; ++n)
+  {
+    requests[n].next = (n + 1 < MAX_REQUESTS) ? static_cast<uint16_t>(n + 1) : NO_REQUEST;
+  }
+}
+
+uint8_t AsyncBus::add_device(DeviceDriver &driver)
+{
+  if (num_devices >= devices.size())
+  {
+    return NO_DEVICE;
+  }
+
+  Device &dev  = devices[num_devices];
+  dev.driver   = &driver;
+  dev.head     = NO_REQUEST;
+  dev.tail     = NO_REQUEST;
+  dev.ready_at = 0;
+  return static_cast<uint8_t>(num_devices++);
+}
+
+AsyncBus::Request *AsyncBus::allocate(uint8_t device, AsyncOp op, AsyncCallback callback, void *context)
+{
+  if ((device >= num_devices) || (free_list == NO_REQUEST))
+  {
+    return nullptr;
+  }
+
+  Request &request = requests[free_list];
+  request.op       = op;
+  request.device   = device;
+  request.step     = 0;
+  request.callback = callback;
+  request.context  = context;
+  return &request;
+}
+
+// Takes the slot off the free list and puts it at the back of its device's queue
+uint32_t AsyncBus::enqueue(Request *request)
+{
+  const uint16_t index = free_list;
+  free_list            = request->next;
+
+  request->id   = next_id;
+  request->next = NO_REQUEST;
+  next_id       = (next_id == UINT32_MAX) ? 1 : next_id + 1;
+
+  Device &dev = devices[request->device];
+  if (dev.tail == NO_REQUEST)
+  {
+    dev.head     = index;
+    dev.ready_at = clock.now_nanos();
+  }
+  else
+  {
+    requests[dev.tail].next = index;
+  }
+  dev.tail = index;
+
+  ++pending;
+  return request->id;
+}
+
+uint32_t AsyncBus::submit_read_registers(uint8_t device, uint8_t start_reg, uint8_t num_regs, uint8_t *dest,
+                                         AsyncCallback callback, void *context)
+{
+  if (!num_regs || (num_regs > DeviceDriver::MAX_BURST_REGISTERS) || !dest)
+  {
+    return 0;
+  }
+
+  Request *request = allocate(device, AsyncOp::READ_REGISTERS, callback, context);
+  if (!request)
+  {
+    return 0;
+  }
+  request->start_reg = start_reg;
+  request->num_regs  = num_regs;
+  request->dest      = dest;
+  return enqueue(request);
+}
+
+uint32_t AsyncBus::submit_write_registers(uint8_t device, uint8_t start_reg, const uint8_t *src, uint8_t num_regs,
+                                          AsyncCallback callback, void *context)
+{
+  if (!num_regs || (num_regs > DeviceDriver::MAX_BURST_REGISTERS) || !src)
+  {
+    return 0;
+  }
+
+  Request *request = allocate(device, AsyncOp::WRITE_REGISTERS, callback, context);
+  if (!request)
+  {
+    return 0;
+  }
+  request->start_reg = start_reg;
+  request->num_regs  = num_regs;
+  memcpy(request->data.data(), src, num_regs);
+  return enqueue(request);
+}
+
+uint32_t AsyncBus::submit_read_input(uint8_t device, uint8_t ch_plus, uint8_t ch_minus, AsyncCallback callback,
+                                     void *context)
+{
+  if ((device >= num_devices) || !devices[device].driver->has_input(ch_plus) ||
+      !devices[device].driver->has_input(ch_minus))
+  {
+    return 0;
+  }
+
+  Request *request = allocate(device, AsyncOp::READ_INPUT, callback, context);
+  if (!request)
+  {
+    return 0;
+  }
+  request->mux = {ch_plus, ch_minus};
+  return enqueue(request);
+}
+
+uint32_t AsyncBus::submit_scan(uint8_t device, const MuxPair *pairs, size_t num_pairs, uint16_t *results,
+                               AsyncCallback callback, void *context)
+{
+  if (!pairs || !num_pairs || (num_pairs > ScanSequencer::MAX_SCAN_LENGTH) || !results || (device >= num_devices))
+  {
+    return 0;
+  }
+  DeviceDriver &driver = *devices[device].driver;
+  for (size_t n = 0; n < num_pairs; ++n)
+  {
+    if (!driver.has_input(pairs[n].ch_plus) || !driver.has_input(pairs[n].ch_minus))
+    {
+      return 0;
+    }
+  }
+
+  Request *request = allocate(device, AsyncOp::SCAN, callback, context);
+  if (!request)
+  {
+    return 0;
+  }
+  request->pairs     = pairs;
+  request->num_pairs = num_pairs;
+  request->results   = results;
+  return enqueue(request);
+}
+
+bool AsyncBus::can_run(const Device &dev)
+{
+  return (dev.head != NO_REQUEST) &&
+         (requests[dev.head].callback || (completions.size() < COMPLETION_QUEUE_CAPACITY));
+}
+
+uint64_t AsyncBus::get_next_deadline(void)
+{
+  uint64_t deadline = NO_DEADLINE;
+  for (size_t d = 0; d < num_devices; ++d)
+  {
+    if (can_run(devices[d]) && (devices[d].ready_at < deadline))
+    {
+      deadline = devices[d].ready_at;
+    }
+  }
+  return deadline;
+}
+
+// Same choice BusScanSequencer makes: serve whichever device has been ready the longest. A
+// device's next request is ready from when the one before it completed (or it was submitted), so
+// a device with a long queue doesn't crowd out the others.
+size_t AsyncBus::poll(void)
+{
+  size_t done = 0;
+  while (true)
+  {
+    const uint64_t now  = clock.now_nanos();
+    Device        *next = nullptr;
+    for (size_t d = 0; d < num_devices; ++d)
+    {
+      Device &dev = devices[d];
+      if (can_run(dev) && (dev.ready_at <= now) && (!next || (dev.ready_at < next->ready_at)))
+      {
+        next = &dev;
+      }
+    }
+    if (!next)
+    {
+      return done;
+    }
+    if (step(*next))
+    {
+      ++done;
+    }
+  }
+}
+
+size_t AsyncBus::wait(void)
+{
+  size_t done;
+  while (!(done = poll()))
+  {
+    const uint64_t deadline = get_next_deadline();
+    if (deadline == NO_DEADLINE)
+    {
+      return 0;
+    }
+    const uint64_t now = clock.now_nanos();
+    if (deadline > now)
+    {
+      clock.delay_nanos(deadline - now);
+    }
+  }
+  return done;
+}
+
+bool AsyncBus::step(Device &dev)
+{
+  Request      &request = requests[dev.head];
+  DeviceDriver &driver  = *dev.driver;
+
+  switch (request.op)
+  {
+  case AsyncOp::READ_REGISTERS:
+    driver.read_registers(request.start_reg, request.num_regs, request.dest);
+    complete(dev, true, 0);
+    return true;
+
+  case AsyncOp::WRITE_REGISTERS:
+    driver.write_registers(request.start_reg, request.data.data(), request.num_regs);
+    complete(dev, true, 0);
+    return true;
+
+  case AsyncOp::READ_INPUT:
+  {
+    // Point the mux at the input; while converting, the result for it is a settling time away.
+    // In standby nothing is converting it at all (RDATA would give whatever was converted last),
+    // so START a conversion and read it out once it's done.
+    if (request.step == 0)
+    {
+      const uint8_t mux     = (request.mux.ch_plus << 4) | (request.mux.ch_minus & 0x0f);
+      const bool    moved   = driver.get_cached_register(ADS114S08_REGISTERS::INPMUX) != mux;
+      const bool    standby = !driver.is_converting();
+      if (moved)
+      {
+        driver.set_channel(request.mux.ch_plus, request.mux.ch_minus);
+      }
+      request.stop_after = false;
+      if (standby)
+      {
+        // One conversion in single-shot mode; in continuous mode it keeps going until the STOP
+        driver.start_conversions();
+        request.stop_after = driver.is_converting();
+      }
+      request.step = 1;
+      if (moved || standby)
+      {
+        dev.ready_at = clock.now_nanos() + driver.get_settling_nanos();
+        return false;
+      }
+    }
+
+    uint16_t   value;
+    const bool ok = driver.read_adc_by_rdata_cmd(value);
+    if (request.stop_after)
+    {
+      driver.stop_conversions();
+    }
+    complete(dev, ok, value);
+    return true;
+  }
+
+  case AsyncOp::SCAN:
+  {
+    // ScanSequencer::scan(), one frame per step: start on the first entry in continuous mode,
+    // then every frame moves the mux on (restarting conversions) and reads out the entry before
+    if (request.step == 0)
+    {
+      request.ok             = true;
+      const uint8_t datarate = driver.get_cached_register(ADS114S08_REGISTERS::DATARATE);
+      driver.stage_register(ADS114S08_REGISTERS::DATARATE, datarate & ~ADS114S08_DATARATE::MODE);
+      driver.sync();
+      driver.set_channel(request.pairs[0].ch_plus, request.pairs[0].ch_minus);
+      driver.start_conversions();
+    }
+    else
+    {
+      const size_t   entry = request.step - 1;
+      const MuxPair &next  = request.pairs[(entry + 1) % request.num_pairs];
+      request.ok &= driver.switch_channel_and_read(next.ch_plus, next.ch_minus, request.results[entry]);
+      if (entry + 1 == request.num_pairs)
+      {
+        complete(dev, request.ok, static_cast<uint16_t>(request.num_pairs));
+        return true;
+      }
+    }
+    ++request.step;
+    dev.ready_at = clock.now_nanos() + driver.get_settling_nanos();
+    return false;
+  }
+  }
+  return false;
+}
+
+// Off the device's queue and back on the free list, then out to the callback or the queue
+void AsyncBus::complete(Device &dev, bool ok, uint16_t value)
+{
+  const uint16_t index   = dev.head;
+  Request       &request = requests[index];
+
+  const AsyncCompletion completion = {request.id, request.op, request.device, ok, value, clock.now_nanos(),
+                                      request.context};
+  const AsyncCallback   callback   = request.callback;
+
+  dev.head = request.next;
+  if (dev.head == NO_REQUEST)
+  {
+    dev.tail = NO_REQUEST;
+  }
+  dev.ready_at = clock.now_nanos();
+
+  request.next = free_list;
+  free_list    = index;
+  --pending;
+
+  if (callback)
+  {
+    callback(completion);
+  }
+  else
+  {
+    (void)completions.push(completion);
+  }
+}
@@ -0,0 +1,115 @@
+#include "bus_scan_sequencer.h"
+
+BusScanSequencer::BusScanSequencer(SpiBus &bus)
+    : clock(bus.get_clock()), devices{}, num_devices(0), scan_length(0), overruns(0), bad_readings(0)
+{
+  ;
+}
+
+bool BusScanSequencer::add_device(DeviceDriver &driver, const MuxPair *pairs, size_t num_pairs)
+{
+  if (!pairs || !num_pairs || (num_pairs > ScanSequencer::MAX_SCAN_LENGTH) || (num_devices >= devices.size()))
+  {
+    return false;
+  }
+  for (size_t n = 0; n < num_pairs; ++n)
+  {
+    if (!driver.has_input(pairs[n].ch_plus) || !driver.has_input(pairs[n].ch_minus))
+    {
+      return false;
+    }
+  }
+
+  ScanDevice &dev = devices[num_devices++];
+  dev.driver      = &driver;
+  for (size_t n = 0; n < num_pairs; ++n)
+  {
+    dev.scan_list[n] = pairs[n];
+  }
+  dev.scan_length = num_pairs;
+  dev.offset      = scan_length;
+  scan_length += num_pairs;
+  return true;
+}
+
+void BusScanSequencer::wait_until(uint64_t deadline_nanos)
+{
+  const uint64_t now = clock.now_nanos();
+  if (deadline_nanos > now)
+  {
+    clock.delay_nanos(deadline_nanos - now);
+  }
+}
+
+bool BusScanSequencer::scan(uint16_t *results)
+{
+  return run(results, 1) && !bad_readings;
+}
+
+size_t BusScanSequencer::run(uint16_t *results, size_t num_scans, uint64_t scan_period_nanos)
+{
+  bad_readings = 0;
+  if (!results || !num_devices || !num_scans)
+  {
+    return 0;
+  }
+
+  // Get every device converting on its first entry before reading anything back, in continuous
+  // mode so each mux change starts the next conversion (see ScanSequencer::run())
+  for (size_t d = 0; d < num_devices; ++d)
+  {
+    ScanDevice   &dev      = devices[d];
+    const uint8_t datarate = dev.driver->get_cached_register(ADS114S08_REGISTERS::DATARATE);
+    dev.driver->stage_register(ADS114S08_REGISTERS::DATARATE, datarate & ~ADS114S08_DATARATE::MODE);
+    dev.driver->sync();
+    dev.driver->set_channel(dev.scan_list[0].ch_plus, dev.scan_list[0].ch_minus);
+    dev.driver->start_conversions();
+    dev.taken    = 0;
+    dev.ready_at = clock.now_nanos() + dev.driver->get_settling_nanos();
+  }
+
+  const uint64_t first_scan_start = clock.now_nanos();
+  const size_t   total            = num_scans * scan_length;
+
+  for (size_t k = 0; k < total; ++k)
+  {
+    // Serve whichever device will have a settled result soonest
+    ScanDevice *next_dev = nullptr;
+    for (size_t d = 0; d < num_devices; ++d)
+    {
+      ScanDevice &dev = devices[d];
+      if ((dev.taken < num_scans * dev.scan_length) && (!next_dev || (dev.ready_at < next_dev->ready_at)))
+      {
+        next_dev = &dev;
+      }
+    }
+    ScanDevice &dev = *next_dev;
+
+    const size_t pass  = dev.taken / dev.scan_length;
+    const size_t entry = dev.taken % dev.scan_length;
+
+    wait_until(dev.ready_at);
+
+    const MuxPair &next = dev.scan_list[(entry + 1) % dev.scan_length];
+    if (!dev.driver->switch_channel_and_read(next.ch_plus, next.ch_minus, results[pass * scan_length + dev.offset + entry]))
+    {
+      ++bad_readings;
+    }
+
+    ++dev.taken;
+    dev.ready_at = clock.now_nanos() + dev.driver->get_settling_nanos();
+
+    // That was the device's last entry this pass: pace its next pass off the start of the first
+    if ((entry + 1 == dev.scan_length) && scan_period_nanos)
+    {
+      const uint64_t scan_start = first_scan_start + (pass + 1) * scan_period_nanos;
+      if ((dev.taken < num_scans * dev.scan_length) && (clock.now_nanos() > scan_start))
+      {
+        ++overruns;
+      }
+      dev.ready_at = (dev.ready_at > scan_start) ? dev.ready_at : scan_start;
+    }
+  }
+
+  return total;
+}
@@ -0,0 +1,121 @@
+#include "bus_stats.h"
+
+#include <cmath>
+
+const char *bus_op_name(BusOp op)
+{
+  static const char *const names[] = {"RREG",  "WREG",  "RDATA", "DIRECT_READ", "MUX_AND_RDATA",
+                                      "RESET", "START", "STOP",  "CALIBRATION"};
+  static_assert(sizeof(names) / sizeof(names[0]) == NUM_BUS_OPS, "Every BusOp needs a name");
+  return (static_cast<size_t>(op) < NUM_BUS_OPS) ? names[static_cast<size_t>(op)] : "UNKNOWN";
+}
+
+uint64_t LatencySnapshot::value_at_percentile(double percentile) const
+{
+  if (!count)
+  {
+    return 0;
+  }
+
+  // The rank of the value we're after, counting from 1
+  const double   wanted = std::ceil((percentile / 100.0) * static_cast<double>(count));
+  const uint64_t rank   = (wanted < 1.0) ? 1 : static_cast<uint64_t>(wanted);
+  uint64_t       seen   = 0;
+  for (size_t bucket = 0; bucket < LATENCY_BUCKETS::NUM_BUCKETS - 1; ++bucket)
+  {
+    seen += buckets[bucket];
+    if (seen >= rank)
+    {
+      const uint64_t highest = LATENCY_BUCKETS::highest_in(bucket);
+      return (highest < max_nanos) ? highest : max_nanos;
+    }
+  }
+  // The last bucket has no top
+  return max_nanos;
+}
+
+void BusStatsSnapshot::print(FILE *out) const
+{
+  fprintf(out, "Bus: %llu bytes, %llu register writes skipped, %llu STATUS polls\n",
+          static_cast<unsigned long long>(bytes), static_cast<unsigned long long>(redundant_writes),
+          static_cast<unsigned long long>(status_polls));
+  for (size_t op = 0; op < NUM_BUS_OPS; ++op)
+  {
+    const LatencySnapshot &lat = latency[op];
+    if (!transactions[op])
+    {
+      continue;
+    }
+    fprintf(out, "  %-13s %10llu x  mean %10llu nS  p50 %10llu  p99 %10llu  max %10llu\n",
+            bus_op_name(static_cast<BusOp>(op)), static_cast<unsigned long long>(transactions[op]),
+            static_cast<unsigned long long>(lat.mean_nanos()),
+            static_cast<unsigned long long>(lat.value_at_percentile(50.0)),
+            static_cast<unsigned long long>(lat.value_at_percentile(99.0)),
+            static_cast<unsigned long long>(lat.max_nanos));
+  }
+}
+
+#if ADS_STATS
+
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+void LatencyHistogram::reset(void)
+{
+  for (auto &bucket : buckets)
+  {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count.store(0, std::memory_order_relaxed);
+  total_nanos.store(0, std::memory_order_relaxed);
+  max_nanos.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::snapshot(LatencySnapshot &dest) const
+{
+  for (size_t n = 0; n < LATENCY_BUCKETS::NUM_BUCKETS; ++n)
+  {
+    dest.buckets[n] = buckets[n].load(std::memory_order_relaxed);
+  }
+  dest.count       = count.load(std::memory_order_relaxed);
+  dest.total_nanos = total_nanos.load(std::memory_order_relaxed);
+  dest.max_nanos   = max_nanos.load(std::memory_order_relaxed);
+}
+
+BusStats::BusStats()
+{
+  reset();
+}
+
+void BusStats::reset(void)
+{
+  bytes.store(0, std::memory_order_relaxed);
+  for (auto &count : transactions)
+  {
+    count.store(0, std::memory_order_relaxed);
+  }
+  redundant_writes.store(0, std::memory_order_relaxed);
+  status_polls.store(0, std::memory_order_relaxed);
+  for (auto &histogram : latency)
+  {
+    histogram.reset();
+  }
+}
+
+BusStatsSnapshot BusStats::snapshot(void) const
+{
+  BusStatsSnapshot stats;
+  stats.bytes = bytes.load(std::memory_order_relaxed);
+  for (size_t op = 0; op < NUM_BUS_OPS; ++op)
+  {
+    stats.transactions[op] = transactions[op].load(std::memory_order_relaxed);
+    latency[op].snapshot(stats.latency[op]);
+  }
+  stats.redundant_writes = redundant_writes.load(std::memory_order_relaxed);
+  stats.status_polls     = status_polls.load(std::memory_order_relaxed);
+  return stats;
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include <cstring>
+
+#include "calibration_store.h"
+
+static constexpr char MAGIC[4] = {'A', 'C', 'A', 'L'};
+
+static inline void put_le(uint8_t *dest, uint32_t value, size_t size)
+{
+  for (size_t n = 0; n < size; ++n)
+  {
+    dest[n] = static_cast<uint8_t>(value >> (8 * n));
+  }
+}
+
+static inline uint32_t get_le(const uint8_t *src, size_t size)
+{
+  uint32_t value = 0;
+  for (size_t n = 0; n < size; ++n)
+  {
+    value |= static_cast<uint32_t>(src[n]) << (8 * n);
+  }
+  return value;
+}
+
+CalibrationStore::CalibrationStore() : profiles{}, num_profiles(0)
+{
+  ;
+}
+
+const CalibrationProfile *CalibrationStore::find(uint8_t inpmux, uint8_t pga, uint8_t datarate)
+{
+  return lookup(inpmux, pga, datarate);
+}
+
+CalibrationProfile *CalibrationStore::lookup(uint8_t inpmux, uint8_t pga, uint8_t datarate)
+{
+  for (size_t n = 0; n < num_profiles; ++n)
+  {
+    CalibrationProfile &profile = profiles[n];
+    if ((profile.inpmux == inpmux) && (profile.pga == pga) && (profile.datarate == datarate))
+    {
+      return &profile;
+    }
+  }
+  return nullptr;
+}
+
+bool CalibrationStore::store(const CalibrationProfile &profile)
+{
+  CalibrationProfile *existing = lookup(profile.inpmux, profile.pga, profile.datarate);
+  if (existing)
+  {
+    *existing = profile;
+    return true;
+  }
+  if (num_profiles >= MAX_PROFILES)
+  {
+    return false;
+  }
+  profiles[num_profiles++] = profile;
+  return true;
+}
+
+bool CalibrationStore::save(FILE *out)
+{
+  if (!out)
+  {
+    return false;
+  }
+
+  uint8_t header[HEADER_SIZE];
+  memcpy(header, MAGIC, sizeof(MAGIC));
+  put_le(header + 4, VERSION, 2);
+  put_le(header + 6, static_cast<uint32_t>(num_profiles), 2);
+  bool ok = (fwrite(header, 1, sizeof(header), out) == sizeof(header));
+
+  for (size_t n = 0; ok && (n < num_profiles); ++n)
+  {
+    const CalibrationProfile &profile = profiles[n];
+    uint8_t                   record[PROFILE_SIZE];
+    record[0] = profile.inpmux;
+    record[1] = profile.pga;
+    record[2] = profile.datarate;
+    record[3] = 0;
+    put_le(record + 4, profile.ofcal, 2);
+    put_le(record + 6, profile.fscal, 2);
+    put_le(record + 8, profile.timestamp, 4);
+    ok = (fwrite(record, 1, sizeof(record), out) == sizeof(record));
+  }
+  return ok && (fflush(out) == 0);
+}
+
+bool CalibrationStore::load(FILE *in)
+{
+  num_profiles = 0;
+
+  uint8_t header[HEADER_SIZE];
+  if (!in || (fread(header, 1, sizeof(header), in) != sizeof(header)) || memcmp(header, MAGIC, sizeof(MAGIC)) ||
+      (get_le(header + 4, 2) != VERSION) || (get_le(header + 6, 2) > MAX_PROFILES))
+  {
+    return false;
+  }
+
+  const size_t count = get_le(header + 6, 2);
+  for (size_t n = 0; n < count; ++n)
+  {
+    uint8_t record[PROFILE_SIZE];
+    if (fread(record, 1, sizeof(record), in) != sizeof(record))
+    {
+      num_profiles = 0;
+      return false;
+    }
+
+    CalibrationProfile &profile = profiles[n];
+    profile.inpmux              = record[0];
+    profile.pga                 = record[1];
+    profile.datarate            = record[2];
+    profile.ofcal               = static_cast<uint16_t>(get_le(record + 4, 2));
+    profile.fscal               = static_cast<uint16_t>(get_le(record + 6, 2));
+    profile.timestamp           = get_le(record + 8, 4);
+  }
+  num_profiles = count;
+  return true;
+}
@@ -0,0 +1,30 @@
+#include "monotonic_clock.h"
+
+#include <chrono>
+#include <thread>
+
+uint64_t MonotonicClock::now_nanos(void)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void MonotonicClock::delay_nanos(uint64_t nanos)
+{
+  const uint64_t deadline = now_nanos() + nanos;
+  if (nanos >= SPIN_THRESHOLD_NANOS)
+  {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(nanos - SPIN_THRESHOLD_NANOS / 2));
+  }
+
+  while (now_nanos() < deadline)
+  {
+    ;
+  }
+}
+
+MonotonicClock &MonotonicClock::instance(void)
+{
+  static MonotonicClock clock;
+  return clock;
+}
@@ -0,0 +1,195 @@
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "replay_spi.h"
+#include "spi_recording.h"
+
+static inline uint64_t get_le(const uint8_t *src, size_t size)
+{
+  uint64_t value = 0;
+  for (size_t n = 0; n < size; ++n)
+  {
+    value |= static_cast<uint64_t>(src[n]) << (8 * n);
+  }
+  return value;
+}
+
+ReplaySpi::ReplaySpi(const char *path)
+    : data(nullptr), size(0), cursor(0), recorded_nanos(0), frames_replayed(0), divergences(0),
+      first_divergence_offset(0), last_cipo(0xff)
+{
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    return;
+  }
+
+  struct stat st;
+  if ((fstat(fd, &st) == 0) && (st.st_size >= SPI_RECORDING::HEADER_SIZE))
+  {
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED)
+    {
+      data = static_cast<const uint8_t *>(map);
+      size = st.st_size;
+    }
+  }
+  // The mapping holds its own reference to the file
+  close(fd);
+
+  if (!data)
+  {
+    return;
+  }
+
+  const uint16_t header_size = get_le(data + 6, 2);
+  if (memcmp(data, SPI_RECORDING::MAGIC, sizeof(SPI_RECORDING::MAGIC)) ||
+      (get_le(data + 4, 2) != SPI_RECORDING::VERSION) || (header_size < SPI_RECORDING::HEADER_SIZE) ||
+      (header_size > size))
+  {
+    munmap(const_cast<uint8_t *>(data), size);
+    data = nullptr;
+    size = 0;
+    return;
+  }
+
+  // Read front to back, once
+  madvise(const_cast<uint8_t *>(data), size, MADV_SEQUENTIAL);
+  recorded_nanos = get_le(data + 8, 8);
+  cursor         = header_size;
+}
+
+ReplaySpi::~ReplaySpi()
+{
+  if (data)
+  {
+    munmap(const_cast<uint8_t *>(data), size);
+  }
+}
+
+bool ReplaySpi::next_record(Record &record)
+{
+  while (cursor + SPI_RECORDING::RECORD_HEADER_SIZE <= size)
+  {
+    const uint8_t *header = data + cursor;
+    record.kind           = header[0];
+    record.arg            = header[1];
+    record.len            = get_le(header + 2, 2);
+
+    if (record.kind == SPI_RECORDING::RECORD_TIME)
+    {
+      if (cursor + SPI_RECORDING::RECORD_HEADER_SIZE + 8 > size)
+      {
+        break;
+      }
+      recorded_nanos = get_le(header + SPI_RECORDING::RECORD_HEADER_SIZE, 8);
+      cursor += SPI_RECORDING::RECORD_HEADER_SIZE + 8;
+      continue;
+    }
+
+    const size_t payload = (record.kind == SPI_RECORDING::RECORD_FRAME) ? 2 * static_cast<size_t>(record.len) : 0;
+    if (cursor + SPI_RECORDING::RECORD_HEADER_SIZE + payload > size)
+    {
+      break;
+    }
+
+    recorded_nanos += get_le(header + 4, 4);
+    record.copi = header + SPI_RECORDING::RECORD_HEADER_SIZE;
+    record.cipo = record.copi + record.len;
+    cursor += SPI_RECORDING::RECORD_HEADER_SIZE + payload;
+    return true;
+  }
+
+  // Nothing (whole) left
+  cursor = size;
+  return false;
+}
+
+void ReplaySpi::diverged(size_t offset)
+{
+  if (!divergences++)
+  {
+    first_divergence_offset = offset;
+  }
+}
+
+void ReplaySpi::expect_control(uint8_t kind, uint8_t arg)
+{
+  const size_t offset = cursor;
+  Record       record;
+  if (!next_record(record) || (record.kind != kind) || (record.arg != arg))
+  {
+    diverged(offset);
+  }
+}
+
+void ReplaySpi::init(uint8_t SPI_mode)
+{
+  CPHA = SPI_mode & 0x01;
+  CPOL = SPI_mode & 0x02;
+  expect_control(SPI_RECORDING::RECORD_INIT, SPI_mode);
+}
+
+void ReplaySpi::set_chip_select(uint8_t cs)
+{
+  expect_control(SPI_RECORDING::RECORD_CHIP_SELECT, cs);
+}
+
+uint8_t ReplaySpi::transfer(uint8_t data)
+{
+  uint8_t rx;
+  transfer(&data, &rx, 1);
+  return rx;
+}
+
+void ReplaySpi::write(uint8_t data)
+{
+  (void)transfer(data);
+}
+
+uint8_t ReplaySpi::read(void)
+{
+  return last_cipo;
+}
+
+// Long transfers were recorded as several consecutive frames, all but the last MAX_FRAME_BYTES
+// long, so keep taking frames until this one is covered. A shorter frame that leaves some of
+// the transfer over was a transaction of its own: the driver has merged it with the next one.
+void ReplaySpi::transfer(const uint8_t *tx, uint8_t *rx, size_t len)
+{
+  while (len)
+  {
+    const size_t offset = cursor;
+    Record       record;
+    if (!next_record(record) || (record.kind != SPI_RECORDING::RECORD_FRAME) || !record.len ||
+        (record.len > len) || ((record.len < len) && (record.len != SPI_RECORDING::MAX_FRAME_BYTES)))
+    {
+      // Off the end, out of step, empty, or a frame the driver didn't send in the same pieces
+      diverged(offset);
+      if (rx)
+      {
+        memset(rx, 0xff, len);
+      }
+      last_cipo = 0xff;
+      return;
+    }
+
+    if (memcmp(tx, record.copi, record.len))
+    {
+      diverged(offset);
+    }
+    if (rx)
+    {
+      memcpy(rx, record.cipo, record.len);
+      rx += record.len;
+    }
+    last_cipo = record.cipo[record.len - 1];
+    ++frames_replayed;
+
+    tx += record.len;
+    len -= record.len;
+  }
+}
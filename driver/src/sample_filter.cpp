@@ -0,0 +1,425 @@
+#include <algorithm>
+#include <cmath>
+
+#include "sample_filter.h"
+
+BoxcarDecimator::BoxcarDecimator() : num_channels(0), factor(1), scale(1.0f), count(0), sums{}
+{
+  ;
+}
+
+bool BoxcarDecimator::configure(size_t channels, size_t decimation)
+{
+  if (!channels || (channels > MAX_CHANNELS) || !decimation || (decimation > MAX_FACTOR))
+  {
+    return false;
+  }
+
+  num_channels = channels;
+  factor       = decimation;
+  scale        = 1.0f / static_cast<float>(decimation);
+  reset();
+  return true;
+}
+
+void BoxcarDecimator::reset(void)
+{
+  count = 0;
+  sums.fill(0.0f);
+}
+
+size_t BoxcarDecimator::process(const float *in, size_t num_frames, float *out)
+{
+  const size_t channels = num_channels;
+  size_t produced = 0;
+  for (size_t f = 0; f < num_frames; ++f)
+  {
+    const float *frame = in + f * channels;
+    for (size_t ch = 0; ch < channels; ++ch)
+    {
+      sums[ch] += frame[ch];
+    }
+
+    if (++count == factor)
+    {
+      float *dest = out + produced * channels;
+      for (size_t ch = 0; ch < channels; ++ch)
+      {
+        dest[ch] = sums[ch] * scale;
+        sums[ch] = 0.0f;
+      }
+      count = 0;
+      ++produced;
+    }
+  }
+  return produced;
+}
+
+MovingAverage::MovingAverage() : num_channels(0), window(1), position(0), primed(false), history{}, sums{}
+{
+  ;
+}
+
+bool MovingAverage::configure(size_t channels, size_t length)
+{
+  if (!channels || (channels > MAX_CHANNELS) || !length || (length > MAX_WINDOW))
+  {
+    return false;
+  }
+
+  num_channels = channels;
+  window       = length;
+  reset();
+  return true;
+}
+
+void MovingAverage::reset(void)
+{
+  position = 0;
+  primed   = false;
+}
+
+size_t MovingAverage::process(const float *in, size_t num_frames, float *out)
+{
+  const size_t channels = num_channels;
+  const double scale = 1.0 / static_cast<double>(window);
+  for (size_t f = 0; f < num_frames; ++f)
+  {
+    const float *frame = in + f * channels;
+    float       *dest  = out + f * channels;
+
+    if (!primed)
+    {
+      for (size_t k = 0; k < window; ++k)
+      {
+        std::copy(frame, frame + channels, history[k].data());
+      }
+      for (size_t ch = 0; ch < channels; ++ch)
+      {
+        sums[ch] = static_cast<double>(frame[ch]) * static_cast<double>(window);
+      }
+      primed = true;
+    }
+
+    float *oldest = history[position].data();
+    for (size_t ch = 0; ch < channels; ++ch)
+    {
+      const float sample = frame[ch];
+      sums[ch] += static_cast<double>(sample) - static_cast<double>(oldest[ch]);
+      oldest[ch] = sample;
+      dest[ch]   = static_cast<float>(sums[ch] * scale);
+    }
+    position = (position + 1 == window) ? 0 : position + 1;
+  }
+  return num_frames;
+}
+
+CicDecimator::CicDecimator()
+    : num_channels(0), factor(1), order(1), scale(1.0f / INPUT_SCALE), count(0), integrators{}, combs{}
+{
+  ;
+}
+
+bool CicDecimator::configure(size_t channels, size_t decimation, size_t stages)
+{
+  if (!channels || (channels > MAX_CHANNELS) || (decimation < 2) || !stages || (stages > MAX_ORDER))
+  {
+    return false;
+  }
+
+  // Each stage grows the word by log2(factor) bits
+  size_t factor_bits = 0;
+  while ((static_cast<size_t>(1) << factor_bits) < decimation)
+  {
+    ++factor_bits;
+  }
+  if (stages * factor_bits > MAX_GAIN_BITS)
+  {
+    return false;
+  }
+
+  num_channels = channels;
+  factor       = decimation;
+  order        = stages;
+  scale        = static_cast<float>(1.0 / (std::pow(static_cast<double>(decimation), static_cast<double>(stages)) *
+                                       static_cast<double>(INPUT_SCALE)));
+  reset();
+  return true;
+}
+
+void CicDecimator::reset(void)
+{
+  count = 0;
+  for (size_t s = 0; s < MAX_ORDER; ++s)
+  {
+    integrators[s].fill(0);
+    combs[s].fill(0);
+  }
+}
+
+size_t CicDecimator::process(const float *in, size_t num_frames, float *out)
+{
+  // A local copy, or the compiler can't tell the integrators (uint64_t) from the channel count
+  // (size_t) and won't vectorize anything that writes them
+  const size_t channels = num_channels;
+  size_t produced = 0;
+  for (size_t f = 0; f < num_frames; ++f)
+  {
+    // Integrators at the input rate. Rounded to 1/256 code and into two's complement, so the
+    // sums wrap the way the combs expect. A code with 8 bits of fraction fits 32 bits, and
+    // converting to those vectorizes where converting straight to 64 doesn't.
+    const float *frame = in + f * channels;
+    uint64_t    *first = integrators[0].data();
+    for (size_t ch = 0; ch < channels; ++ch)
+    {
+      const float   scaled = frame[ch] * INPUT_SCALE;
+      const int32_t fixed  = static_cast<int32_t>(scaled + std::copysign(0.5f, scaled));
+      first[ch] += static_cast<uint64_t>(static_cast<int64_t>(fixed));
+    }
+    for (size_t s = 1; s < order; ++s)
+    {
+      const uint64_t *prev = integrators[s - 1].data();
+      uint64_t       *acc  = integrators[s].data();
+      for (size_t ch = 0; ch < channels; ++ch)
+      {
+        acc[ch] += prev[ch];
+      }
+    }
+
+    if (++count < factor)
+    {
+      continue;
+    }
+    count = 0;
+
+    // Combs at the output rate, worked in place on a copy of the last integrator
+    std::array<uint64_t, MAX_CHANNELS> value;
+    std::copy(integrators[order - 1].begin(), integrators[order - 1].begin() + channels, value.begin());
+    for (size_t s = 0; s < order; ++s)
+    {
+      uint64_t *delay = combs[s].data();
+      for (size_t ch = 0; ch < channels; ++ch)
+      {
+        const uint64_t current = value[ch];
+        value[ch]              = current - delay[ch];
+        delay[ch]              = current;
+      }
+    }
+
+    float *dest = out + produced * channels;
+    for (size_t ch = 0; ch < channels; ++ch)
+    {
+      dest[ch] = static_cast<float>(static_cast<int64_t>(value[ch])) * scale;
+    }
+    ++produced;
+  }
+  return produced;
+}
+
+FirFilter::FirFilter() : num_channels(0), num_taps(1), decimation(1), position(0), count(0), taps{}, history{}
+{
+  taps[0] = 1.0f;
+}
+
+bool FirFilter::configure(size_t channels, const float *coefficients, size_t length, size_t keep_every)
+{
+  if (!channels || (channels > MAX_CHANNELS) || !coefficients || !length || (length > MAX_TAPS) || !keep_every)
+  {
+    return false;
+  }
+
+  num_channels = channels;
+  num_taps     = length;
+  decimation   = keep_every;
+  std::copy(coefficients, coefficients + length, taps.begin());
+  reset();
+  return true;
+}
+
+void FirFilter::reset(void)
+{
+  position = 0;
+  count    = 0;
+  for (auto &frame : history)
+  {
+    frame.fill(0.0f);
+  }
+}
+
+size_t FirFilter::process(const float *in, size_t num_frames, float *out)
+{
+  const size_t channels = num_channels;
+  size_t produced = 0;
+  for (size_t f = 0; f < num_frames; ++f)
+  {
+    const float *frame = in + f * channels;
+    std::copy(frame, frame + channels, history[position].data());
+    std::copy(frame, frame + channels, history[position + num_taps].data());
+
+    const size_t newest = position + num_taps;
+    position            = (position + 1 == num_taps) ? 0 : position + 1;
+    if (++count < decimation)
+    {
+      continue;
+    }
+    count = 0;
+
+    // One multiply-add per tap across every channel
+    alignas(32) std::array<float, MAX_CHANNELS> acc{};
+    for (size_t k = 0; k < num_taps; ++k)
+    {
+      const float  tap    = taps[k];
+      const float *sample = history[newest - k].data();
+      for (size_t ch = 0; ch < channels; ++ch)
+      {
+        acc[ch] += tap * sample[ch];
+      }
+    }
+    std::copy(acc.begin(), acc.begin() + channels, out + produced * channels);
+    ++produced;
+  }
+  return produced;
+}
+
+MedianFilter::MedianFilter() : num_channels(0), window(1), position(0), primed(false), history{}, sorted{}
+{
+  ;
+}
+
+bool MedianFilter::configure(size_t channels, size_t length)
+{
+  if (!channels || (channels > MAX_CHANNELS) || !(length & 1) || (length > MAX_WINDOW))
+  {
+    return false;
+  }
+
+  num_channels = channels;
+  window       = length;
+  reset();
+  return true;
+}
+
+void MedianFilter::reset(void)
+{
+  position = 0;
+  primed   = false;
+}
+
+size_t MedianFilter::process(const float *in, size_t num_frames, float *out)
+{
+  const size_t channels = num_channels;
+  for (size_t f = 0; f < num_frames; ++f)
+  {
+    const float *frame = in + f * channels;
+    if (!primed)
+    {
+      for (size_t k = 0; k < window; ++k)
+      {
+        std::copy(frame, frame + channels, history[k].data());
+      }
+      primed = true;
+    }
+    std::copy(frame, frame + channels, history[position].data());
+    position = (position + 1 == window) ? 0 : position + 1;
+
+    // Odd-even transposition sort: window passes of compare-exchanges between neighbours, each
+    // one a min and a max across all channels, with no data-dependent branches
+    for (size_t k = 0; k < window; ++k)
+    {
+      std::copy(history[k].begin(), history[k].begin() + channels, sorted[k].begin());
+    }
+    for (size_t pass = 0; pass < window; ++pass)
+    {
+      for (size_t k = pass & 1; k + 1 < window; k += 2)
+      {
+        float *lo = sorted[k].data();
+        float *hi = sorted[k + 1].data();
+        for (size_t ch = 0; ch < channels; ++ch)
+        {
+          const float a = lo[ch];
+          const float b = hi[ch];
+          lo[ch]        = std::min(a, b);
+          hi[ch]        = std::max(a, b);
+        }
+      }
+    }
+    std::copy(sorted[window / 2].begin(), sorted[window / 2].begin() + channels, out + f * channels);
+  }
+  return num_frames;
+}
+
+FilterPipeline::FilterPipeline() : stages{}, num_stages(0)
+{
+  ;
+}
+
+bool FilterPipeline::add_stage(ISampleFilter &stage)
+{
+  if ((num_stages >= MAX_STAGES) || !stage.get_num_channels() ||
+      (num_stages && (stage.get_num_channels() != get_num_channels())))
+  {
+    return false;
+  }
+  stages[num_stages++] = &stage;
+  return true;
+}
+
+size_t FilterPipeline::get_decimation(void)
+{
+  size_t decimation = 1;
+  for (size_t s = 0; s < num_stages; ++s)
+  {
+    decimation *= stages[s]->get_decimation();
+  }
+  return decimation;
+}
+
+void FilterPipeline::reset(void)
+{
+  for (size_t s = 0; s < num_stages; ++s)
+  {
+    stages[s]->reset();
+  }
+}
+
+size_t FilterPipeline::run_stages(float *samples, size_t num_frames)
+{
+  if (!num_stages)
+  {
+    return 0;
+  }
+  for (size_t s = 0; (s < num_stages) && num_frames; ++s)
+  {
+    num_frames = stages[s]->process(samples, num_frames, samples);
+  }
+  return num_frames;
+}
+
+size_t FilterPipeline::process(const uint16_t *codes, size_t num_frames, float *out)
+{
+  const size_t num_samples = num_frames * get_num_channels();
+  for (size_t n = 0; n < num_samples; ++n)
+  {
+    out[n] = static_cast<int16_t>(codes[n]);
+  }
+  return run_stages(out, num_frames);
+}
+
+size_t FilterPipeline::process(const int16_t *codes, size_t num_frames, float *out)
+{
+  const size_t num_samples = num_frames * get_num_channels();
+  for (size_t n = 0; n < num_samples; ++n)
+  {
+    out[n] = codes[n];
+  }
+  return run_stages(out, num_frames);
+}
+
+size_t FilterPipeline::process(const float *in, size_t num_frames, float *out)
+{
+  if (in != out)
+  {
+    std::copy(in, in + num_frames * get_num_channels(), out);
+  }
+  return run_stages(out, num_frames);
+}
@@ -0,0 +1,112 @@
+#include "scan_sequencer.h"
+
+ScanSequencer::ScanSequencer(DeviceDriver &driver)
+    : driver(driver), clock(driver.get_clock()), scan_list{}, scan_length(0), overruns(0), bad_readings(0)
+{
+  ;
+}
+
+bool ScanSequencer::set_scan_list(const MuxPair *pairs, size_t num_pairs)
+{
+  if (!pairs || !num_pairs || (num_pairs > MAX_SCAN_LENGTH))
+  {
+    return false;
+  }
+  for (size_t n = 0; n < num_pairs; ++n)
+  {
+    if (!driver.has_input(pairs[n].ch_plus) || !driver.has_input(pairs[n].ch_minus))
+    {
+      return false;
+    }
+  }
+
+  for (size_t n = 0; n < num_pairs; ++n)
+  {
+    scan_list[n] = pairs[n];
+  }
+  scan_length = num_pairs;
+  return true;
+}
+
+void ScanSequencer::wait_until(uint64_t deadline_nanos)
+{
+  const uint64_t now = clock.now_nanos();
+  if (deadline_nanos > now)
+  {
+    clock.delay_nanos(deadline_nanos - now);
+  }
+}
+
+bool ScanSequencer::scan(uint16_t *results)
+{
+  return run(results, 1) && !bad_readings;
+}
+
+bool ScanSequencer::scan(int16_t *results)
+{
+  return run(results, 1) && !bad_readings;
+}
+
+// A code is a code: the device sends two's complement either way, and int16_t and uint16_t may
+// alias each other
+size_t ScanSequencer::run(int16_t *results, size_t num_scans, uint64_t scan_period_nanos)
+{
+  return run(reinterpret_cast<uint16_t *>(results), num_scans, scan_period_nanos);
+}
+
+size_t ScanSequencer::run(uint16_t *results, size_t num_scans, uint64_t scan_period_nanos)
+{
+  bad_readings = 0;
+  if (!results || !scan_length || !num_scans)
+  {
+    return 0;
+  }
+
+  // Every entry after the first is started by the WREG that moves the mux to it, which only
+  // happens in continuous conversion mode: single-shot would convert the first entry and stop
+  const uint8_t datarate = driver.get_cached_register(ADS114S08_REGISTERS::DATARATE);
+  driver.stage_register(ADS114S08_REGISTERS::DATARATE, datarate & ~ADS114S08_DATARATE::MODE);
+  driver.sync();
+
+  const size_t   total   = num_scans * scan_length;
+  const uint64_t settled = driver.get_settling_nanos();
+
+  // (Re)start conversions on the first entry. START restarts the digital filter whether or not
+  // the device was already converting, so either way the first result is one settling time out.
+  driver.set_channel(scan_list[0].ch_plus, scan_list[0].ch_minus);
+  driver.start_conversions();
+
+  const uint64_t first_scan_start = clock.now_nanos();
+  uint64_t       ready_at         = first_scan_start + settled;
+
+  for (size_t k = 0; k < total; ++k)
+  {
+    const size_t entry = k % scan_length;
+
+    // Pace each pass off the start of the first one
+    if (!entry && k && scan_period_nanos)
+    {
+      const uint64_t scan_start = first_scan_start + (k / scan_length) * scan_period_nanos;
+      if (clock.now_nanos() > scan_start)
+      {
+        ++overruns;
+      }
+      ready_at = (ready_at > scan_start) ? ready_at : scan_start;
+    }
+
+    wait_until(ready_at);
+
+    // Read entry k while switching to entry k + 1. On the very last reading there's nothing to
+    // switch to, so set the mux back to where the next run() will start anyway.
+    const MuxPair &next = scan_list[(entry + 1) % scan_length];
+    if (!driver.switch_channel_and_read(next.ch_plus, next.ch_minus, results[k]))
+    {
+      ++bad_readings;
+    }
+
+    // The new conversion started during that frame; it's settled one settling time after it
+    ready_at = clock.now_nanos() + settled;
+  }
+
+  return total;
+}
@@ -0,0 +1,122 @@
+#include <thread>
+
+#include "shared_device_driver.h"
+
+SharedDeviceDriver::SharedDeviceDriver(DeviceDriver &driver)
+    : driver(driver), drdy_pending(false), deferred_samples(0)
+{
+  bus_lock.clear();
+}
+
+// Transactions are a handful of bytes, so waiting threads just yield until the bus is free
+void SharedDeviceDriver::lock(void)
+{
+  while (bus_lock.test_and_set(std::memory_order_acquire))
+  {
+    std::this_thread::yield();
+  }
+}
+
+bool SharedDeviceDriver::try_lock(void)
+{
+  return !bus_lock.test_and_set(std::memory_order_acquire);
+}
+
+// Before letting go of the bus, service any DRDY that came in while we held it. A DRDY that
+// lands after the check finds the bus free and reads its own sample; one that lands between the
+// check and the release fails its try_lock(), so look once more after releasing.
+void SharedDeviceDriver::unlock(void)
+{
+  do
+  {
+    uint16_t value;
+    if (drdy_pending.exchange(false, std::memory_order_acq_rel) && driver.read_adc_by_rdata_cmd(value))
+    {
+      samples.publish(value);
+      deferred_samples.fetch_add(1, std::memory_order_relaxed);
+    }
+    bus_lock.clear(std::memory_order_release);
+  } while (drdy_pending.load(std::memory_order_acquire) && try_lock());
+}
+
+uint8_t SharedDeviceDriver::read_register(uint8_t reg)
+{
+  BusGuard guard(*this);
+  return driver.read_register(reg);
+}
+
+void SharedDeviceDriver::write_register(uint8_t reg, uint8_t value)
+{
+  BusGuard guard(*this);
+  driver.write_register(reg, value);
+}
+
+void SharedDeviceDriver::read_registers(uint8_t start_reg, uint8_t num_reads, uint8_t *dest)
+{
+  BusGuard guard(*this);
+  driver.read_registers(start_reg, num_reads, dest);
+}
+
+void SharedDeviceDriver::write_registers(uint8_t start_reg, const uint8_t *src, uint8_t num_writes)
+{
+  BusGuard guard(*this);
+  driver.write_registers(start_reg, src, num_writes);
+}
+
+bool SharedDeviceDriver::set_channel(uint8_t ch_plus, uint8_t ch_minus)
+{
+  BusGuard guard(*this);
+  return driver.set_channel(ch_plus, ch_minus);
+}
+
+uint16_t SharedDeviceDriver::read_adc_by_rdata_cmd(void)
+{
+  BusGuard guard(*this);
+  return driver.read_adc_by_rdata_cmd();
+}
+
+void SharedDeviceDriver::start_conversions(void)
+{
+  BusGuard guard(*this);
+  driver.start_conversions();
+}
+
+void SharedDeviceDriver::stop_conversions(void)
+{
+  BusGuard guard(*this);
+  driver.stop_conversions();
+}
+
+// Interrupt context: never waits. If someone else has the bus, leave the sample to them.
+void SharedDeviceDriver::on_data_ready(void)
+{
+  if (try_lock())
+  {
+    uint16_t value;
+    if (driver.read_adc_direct(value))
+    {
+      samples.publish(value);
+    }
+    unlock();
+    return;
+  }
+
+  drdy_pending.store(true, std::memory_order_release);
+
+  // The holder may have done its last check and let go in the meantime, in which case nobody
+  // would pick the sample up. If the bus is free now, unlock() does it (unless it's been done).
+  if (try_lock())
+  {
+    unlock();
+  }
+}
+
+void SharedDeviceDriver::adc_ready_isr(void *shared)
+{
+  static_cast<SharedDeviceDriver *>(shared)->on_data_ready();
+}
+
+size_t SharedDeviceDriver::read_samples(Subscriber &subscriber, uint16_t *dest, size_t max_samples)
+{
+  return samples.read(subscriber, dest, max_samples);
+}
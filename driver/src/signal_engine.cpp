@@ -0,0 +1,162 @@
+#include <cmath>
+
+#include "signal_engine.h"
+
+static constexpr double TWO_PI        = 6.283185307179586;
+static constexpr double NANOS_TO_SECS = 1e-9;
+
+// sin(2 pi x) for any x >= 0. Reduce to a quarter cycle and use a short odd polynomial; it's
+// good to about 1e-7 of full scale, far below an LSB, and unlike std::sin it has no branches
+// or calls, so a loop over a block of these can be vectorized.
+static inline double sin_cycles(double x)
+{
+  x -= std::floor(x);                   // [0, 1)
+  x = (x >= 0.5) ? (x - 1.0) : x;       // [-0.5, 0.5)
+  x = (x > 0.25) ? (0.5 - x) : x;       // sin(pi - a) = sin(a)
+  x = (x < -0.25) ? (-0.5 - x) : x;     // [-0.25, 0.25]
+
+  const double y  = TWO_PI * x;         // [-pi/2, pi/2]
+  const double y2 = y * y;
+  return y * (1.0 + y2 * (-1.0 / 6 + y2 * (1.0 / 120 + y2 * (-1.0 / 5040 + y2 * (1.0 / 362880 + y2 * (-1.0 / 39916800))))));
+}
+
+// Counter-based generator (splitmix64 finalizer): the same seed and time always give the same
+// bits, so noise needs no state and can be evaluated for any sample in any order
+static inline uint64_t mix64(uint64_t z)
+{
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+// Standard normal via Box-Muller on two uniforms drawn from (seed, t)
+static inline double gaussian(uint64_t seed, uint64_t t_nanos)
+{
+  const uint64_t bits = mix64(seed ^ mix64(t_nanos + 0x9e3779b97f4a7c15ull));
+  const double   u1   = (static_cast<double>(bits >> 40) + 1.0) / 16777217.0; // (0, 1)
+  const double   u2   = static_cast<double>(bits & 0xffffff) / 16777216.0;    // [0, 1)
+  return std::sqrt(-2.0 * std::log(u1)) * sin_cycles(u2 + 0.25);
+}
+
+SignalEngine::SignalEngine() : sources{}, generation(0)
+{
+  for (auto &source : sources)
+  {
+    source.num_components = 0;
+  }
+}
+
+bool SignalEngine::set_source(uint8_t input, const SignalComponent *components, size_t num_components)
+{
+  if ((input >= NUM_INPUTS) || (num_components > MAX_COMPONENTS) || (num_components && !components))
+  {
+    return false;
+  }
+
+  Source &source = sources[input];
+  for (size_t n = 0; n < num_components; ++n)
+  {
+    source.components[n] = components[n];
+  }
+  source.num_components = num_components;
+  ++generation;
+  return true;
+}
+
+void SignalEngine::set_dc(uint8_t input, double level)
+{
+  const SignalComponent dc = SignalComponent::dc(level);
+  set_source(input, &dc, 1);
+}
+
+uint16_t SignalEngine::sample(uint8_t input, uint64_t t_nanos)
+{
+  uint16_t value;
+  generate(input, t_nanos, 0, &value, 1);
+  return value;
+}
+
+void SignalEngine::add_component(const SignalComponent &c, uint64_t t0_nanos, uint64_t step_nanos, double *acc,
+                                 size_t count)
+{
+  const double cycles_per_nano = c.frequency_hz * NANOS_TO_SECS;
+  const double cycle0          = c.phase + cycles_per_nano * static_cast<double>(t0_nanos);
+  const double cycle_step      = cycles_per_nano * static_cast<double>(step_nanos);
+
+  switch (c.kind)
+  {
+  case SignalKind::DC:
+    for (size_t n = 0; n < count; ++n)
+    {
+      acc[n] += c.amplitude;
+    }
+    break;
+
+  case SignalKind::SINE:
+    for (size_t n = 0; n < count; ++n)
+    {
+      acc[n] += c.amplitude * sin_cycles(cycle0 + cycle_step * n);
+    }
+    break;
+
+  case SignalKind::RAMP:
+    for (size_t n = 0; n < count; ++n)
+    {
+      const double x = cycle0 + cycle_step * n;
+      acc[n] += c.amplitude * (2.0 * (x - std::floor(x)) - 1.0);
+    }
+    break;
+
+  case SignalKind::SQUARE:
+    for (size_t n = 0; n < count; ++n)
+    {
+      const double x = cycle0 + cycle_step * n;
+      acc[n] += ((x - std::floor(x)) < 0.5) ? c.amplitude : -c.amplitude;
+    }
+    break;
+
+  case SignalKind::NOISE:
+    for (size_t n = 0; n < count; ++n)
+    {
+      acc[n] += c.amplitude * gaussian(c.seed, t0_nanos + step_nanos * n);
+    }
+    break;
+  }
+}
+
+void SignalEngine::generate(uint8_t input, uint64_t t0_nanos, uint64_t step_nanos, uint16_t *dest, size_t num_samples)
+{
+  if (input >= NUM_INPUTS)
+  {
+    for (size_t n = 0; n < num_samples; ++n)
+    {
+      dest[n] = 0;
+    }
+    return;
+  }
+
+  const Source &source = sources[input];
+  double        acc[CHUNK];
+
+  for (size_t done = 0; done < num_samples; done += CHUNK)
+  {
+    const size_t   count = ((num_samples - done) < CHUNK) ? (num_samples - done) : CHUNK;
+    const uint64_t t0    = t0_nanos + step_nanos * done;
+
+    for (size_t n = 0; n < count; ++n)
+    {
+      acc[n] = 0.0;
+    }
+    for (size_t c = 0; c < source.num_components; ++c)
+    {
+      add_component(source.components[c], t0, step_nanos, acc, count);
+    }
+
+    for (size_t n = 0; n < count; ++n)
+    {
+      const double v  = acc[n] + 0.5;
+      const double cl = (v < 0.0) ? 0.0 : ((v > 65535.0) ? 65535.0 : v);
+      dest[done + n]  = static_cast<uint16_t>(cl);
+    }
+  }
+}
@@ -0,0 +1,72 @@
+#include "spi_bus.h"
+#include "adc_constants.h"
+
+SpiBus::SpiBus(ISpiInterface &controller, IClock &clock)
+    : controller(controller), clock(clock), selected(ISpiInterface::NO_CHIP_SELECT), chip_select_switches(0)
+{
+  for (uint8_t cs = 0; cs < MAX_DEVICES; ++cs)
+  {
+    devices[cs].bus = this;
+    devices[cs].cs  = cs;
+  }
+  controller.set_chip_select(ISpiInterface::NO_CHIP_SELECT);
+}
+
+// Hand the bus to device cs. Nothing to do if it already has it.
+void SpiBus::acquire(uint8_t cs)
+{
+  if (cs == selected)
+  {
+    return;
+  }
+
+  release();
+  controller.set_chip_select(cs);
+  clock.delay_nanos(ADS114S08_TIMING::TD_CSSC);
+  selected = cs;
+  ++chip_select_switches;
+}
+
+void SpiBus::release(void)
+{
+  if (selected == ISpiInterface::NO_CHIP_SELECT)
+  {
+    return;
+  }
+
+  clock.delay_nanos(ADS114S08_TIMING::TD_SCCS);
+  controller.set_chip_select(ISpiInterface::NO_CHIP_SELECT);
+  selected = ISpiInterface::NO_CHIP_SELECT;
+}
+
+// Every device on a bus has to agree on the mode anyway (the ADS114S0x only does mode 1)
+void SpiBus::Device::init(uint8_t SPI_mode)
+{
+  CPHA = SPI_mode & 0x01;
+  CPOL = SPI_mode & 0x02;
+  bus->controller.init(SPI_mode);
+}
+
+uint8_t SpiBus::Device::transfer(uint8_t data)
+{
+  bus->acquire(cs);
+  return bus->controller.transfer(data);
+}
+
+void SpiBus::Device::write(uint8_t data)
+{
+  bus->acquire(cs);
+  bus->controller.write(data);
+}
+
+// Whatever was clocked in last; only meaningful straight after one of this device's transfers
+uint8_t SpiBus::Device::read(void)
+{
+  return bus->controller.read();
+}
+
+void SpiBus::Device::transfer(const uint8_t *tx, uint8_t *rx, size_t len)
+{
+  bus->acquire(cs);
+  bus->controller.transfer(tx, rx, len);
+}
@@ -1,22 +1,48 @@
+#include <cstring>
+
 #include "spi_emulator.h"
 #include "adc_constants.h"
 #include "device_driver.h"
 
-#include <algorithm>
-#include <iostream>
-#include <iterator>
+// One byte on the wire = 8 SCLK periods of simulated time
+static constexpr uint64_t BYTE_TIME_NANOS = 8 * ADS114S08_TIMING::T_SCLK;
 
-SpiEmulator::SpiEmulator() : adc(&fake_copi_buffer, &fake_cipo_buffer)
+SpiEmulator::SpiEmulator() : SpiEmulator(1, false)
 {
   ;
 }
 
-SpiEmulator::SpiEmulator(bool simulate_startup_delay)
-    : adc(&fake_copi_buffer, &fake_cipo_buffer, simulate_startup_delay)
+SpiEmulator::SpiEmulator(bool simulate_startup_delay) : SpiEmulator(1, simulate_startup_delay)
 {
   ;
 }
 
+SpiEmulator::SpiEmulator(uint8_t num_devices, bool simulate_startup_delay)
+{
+  adcs.reserve(num_devices ? num_devices : 1);
+  do
+  {
+    adcs.emplace_back(&fake_copi_buffer, &fake_cipo_buffer, simulate_startup_delay);
+  } while (adcs.size() < num_devices);
+
+  selected = &adcs[0];
+  clock.set_listener(on_clock_advance, this);
+}
+
+// The emulated ADCs live on the same simulated timeline as the bus, selected or not
+void SpiEmulator::on_clock_advance(void *spi, uint64_t elapsed_nanos)
+{
+  for (auto &adc : static_cast<SpiEmulator *>(spi)->adcs)
+  {
+    adc.advance_time(elapsed_nanos);
+  }
+}
+
+void SpiEmulator::set_chip_select(uint8_t cs)
+{
+  selected = (cs < adcs.size()) ? &adcs[cs] : nullptr;
+}
+
 // For simulation, just set the Clock Phase and Clock Polarity - see datasheet p. 88
 void SpiEmulator::init(uint8_t SPI_mode)
 {
@@ -29,8 +55,33 @@ void SpiEmulator::init(uint8_t SPI_mode)
 uint8_t SpiEmulator::transfer(uint8_t data)
 {
   fake_copi_buffer = data;
-  adc.simulate_op();
-  return read();
+  if (selected)
+  {
+    selected->simulate_op();
+  }
+  else
+  {
+    fake_cipo_buffer = 0xff;
+  }
+  const uint8_t received = read();
+  clock.advance(BYTE_TIME_NANOS);
+  return received;
+}
+
+// Simulate a whole frame, 8 clock cycles per byte, without bouncing back through the
+// interface for every byte
+void SpiEmulator::transfer(const uint8_t *tx, uint8_t *rx, size_t len)
+{
+  if (selected)
+  {
+    selected->simulate_frame(tx, rx, len);
+  }
+  else if (rx)
+  {
+    memset(rx, 0xff, len);
+  }
+  // Charged once the frame is done, so a DRDY that lands mid-frame is serviced after it
+  clock.advance(len * BYTE_TIME_NANOS);
 }
 
 // Simulate clocking out a byte of data and then tell the emulated ADC to simulate 8 clock cycles
@@ -0,0 +1,151 @@
+#include <cstring>
+
+#include "spi_recorder.h"
+#include "spi_recording.h"
+
+static inline void put_le(uint8_t *dest, uint64_t value, size_t size)
+{
+  for (size_t n = 0; n < size; ++n)
+  {
+    dest[n] = static_cast<uint8_t>(value >> (8 * n));
+  }
+}
+
+SpiRecorder::SpiRecorder(ISpiInterface &inner, IClock &clock, FILE *out)
+    : inner(inner), clock(clock), out(out), buffer(BUFFER_SIZE), buffered(0), bytes_written(0),
+      last_nanos(clock.now_nanos()), frames_recorded(0), dropped_records(0), depth(0)
+{
+  uint8_t header[SPI_RECORDING::HEADER_SIZE];
+  memcpy(header, SPI_RECORDING::MAGIC, sizeof(SPI_RECORDING::MAGIC));
+  put_le(header + 4, SPI_RECORDING::VERSION, 2);
+  put_le(header + 6, SPI_RECORDING::HEADER_SIZE, 2);
+  put_le(header + 8, last_nanos, 8);
+
+  memcpy(buffer.data(), header, sizeof(header));
+  buffered = sizeof(header);
+}
+
+SpiRecorder::~SpiRecorder()
+{
+  flush();
+}
+
+void SpiRecorder::flush(void)
+{
+  if (buffered && out)
+  {
+    fwrite(buffer.data(), 1, buffered, out);
+    fflush(out);
+  }
+  bytes_written += buffered;
+  buffered = 0;
+}
+
+// A DRDY handler can start a transaction of its own while another is in flight (in the emulator
+// it runs from inside the outer transfer). The outer record is already reserved by then, so the
+// buffer is only ever flushed at the top level, leaving NESTING_HEADROOM for anything nested.
+// A nested record that still doesn't fit is dropped and counted.
+uint8_t *SpiRecorder::begin_record(uint8_t kind, uint8_t arg, uint16_t len, bool continuation)
+{
+  const uint64_t now   = continuation ? last_nanos : clock.now_nanos();
+  uint64_t       delta = now - last_nanos;
+
+  // Worst case: a TIME record plus this one
+  const size_t needed = 2 * SPI_RECORDING::RECORD_HEADER_SIZE + 8 + 2 * static_cast<size_t>(len);
+  if (!depth && (buffered + needed + NESTING_HEADROOM > buffer.size()))
+  {
+    flush();
+  }
+  if (buffered + needed > buffer.size())
+  {
+    ++dropped_records;
+    return nullptr;
+  }
+  last_nanos = now;
+
+  if (delta > UINT32_MAX)
+  {
+    uint8_t *time = buffer.data() + buffered;
+    time[0]       = SPI_RECORDING::RECORD_TIME;
+    time[1]       = 0;
+    put_le(time + 2, 0, 2);
+    put_le(time + 4, 0, 4);
+    put_le(time + SPI_RECORDING::RECORD_HEADER_SIZE, now, 8);
+    buffered += SPI_RECORDING::RECORD_HEADER_SIZE + 8;
+    delta = 0;
+  }
+
+  uint8_t *record = buffer.data() + buffered;
+  record[0]       = kind;
+  record[1]       = arg;
+  put_le(record + 2, len, 2);
+  put_le(record + 4, delta, 4);
+  buffered += SPI_RECORDING::RECORD_HEADER_SIZE + 2 * static_cast<size_t>(len);
+  return record + SPI_RECORDING::RECORD_HEADER_SIZE;
+}
+
+void SpiRecorder::init(uint8_t SPI_mode)
+{
+  CPHA = SPI_mode & 0x01;
+  CPOL = SPI_mode & 0x02;
+  inner.init(SPI_mode);
+  (void)begin_record(SPI_RECORDING::RECORD_INIT, SPI_mode, 0);
+}
+
+void SpiRecorder::set_chip_select(uint8_t cs)
+{
+  inner.set_chip_select(cs);
+  (void)begin_record(SPI_RECORDING::RECORD_CHIP_SELECT, cs, 0);
+}
+
+uint8_t SpiRecorder::transfer(uint8_t data)
+{
+  uint8_t rx;
+  transfer(&data, &rx, 1);
+  return rx;
+}
+
+void SpiRecorder::write(uint8_t data)
+{
+  (void)transfer(data);
+}
+
+uint8_t SpiRecorder::read(void)
+{
+  return inner.read();
+}
+
+// The timestamp is taken before the transfer, so it marks when the frame started; every later
+// chunk of a long transfer is stamped with that same time. CIPO goes straight into the record
+// (the caller gets a copy), so it's captured even when rx is nullptr.
+void SpiRecorder::transfer(const uint8_t *tx, uint8_t *rx, size_t len)
+{
+  bool continuation = false;
+  while (len)
+  {
+    const uint16_t chunk   = (len > SPI_RECORDING::MAX_FRAME_BYTES) ? SPI_RECORDING::MAX_FRAME_BYTES : len;
+    uint8_t       *payload = begin_record(SPI_RECORDING::RECORD_FRAME, 0, chunk, continuation);
+    continuation           = true;
+
+    ++depth;
+    if (payload)
+    {
+      memcpy(payload, tx, chunk);
+      inner.transfer(tx, payload + chunk, chunk);
+      if (rx)
+      {
+        memcpy(rx, payload + chunk, chunk);
+      }
+      ++frames_recorded;
+    }
+    else
+    {
+      inner.transfer(tx, rx, chunk);
+    }
+    --depth;
+
+    tx += chunk;
+    rx = rx ? (rx + chunk) : nullptr;
+    len -= chunk;
+  }
+}
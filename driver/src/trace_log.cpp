@@ -0,0 +1,210 @@
+#include "trace_log.h"
+
+#include <chrono>
+
+static uint64_t trace_timestamp_nanos(void)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+TraceLog::TraceLog() : head(0), tail(0), dropped(0)
+{
+  for (size_t n = 0; n < CAPACITY; ++n)
+  {
+    slots[n].sequence.store(n, std::memory_order_relaxed);
+  }
+}
+
+// Each slot carries a sequence number: equal to the claim position when it's free for that
+// producer, and position + 1 once the record in it is complete (bounded MPMC ring, D. Vyukov)
+void TraceLog::record(uint8_t level, TraceEvent event, uint32_t arg0, uint32_t arg1)
+{
+  size_t pos = head.load(std::memory_order_relaxed);
+  Slot  *slot;
+  while (true)
+  {
+    slot                 = &slots[pos & MASK];
+    const size_t seq     = slot->sequence.load(std::memory_order_acquire);
+    const intptr_t delta = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (delta == 0)
+    {
+      if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (delta < 0)
+    {
+      // Full
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    else
+    {
+      pos = head.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->rec.timestamp_nanos = trace_timestamp_nanos();
+  slot->rec.event           = static_cast<uint16_t>(event);
+  slot->rec.level           = level;
+  slot->rec.reserved        = 0;
+  slot->rec.arg0            = arg0;
+  slot->rec.arg1            = arg1;
+  slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+size_t TraceLog::drain(TraceRecord *dest, size_t max_records)
+{
+  size_t count = 0;
+  while (count < max_records)
+  {
+    Slot &slot = slots[tail & MASK];
+    if (slot.sequence.load(std::memory_order_acquire) != tail + 1)
+    {
+      break;
+    }
+
+    dest[count++] = slot.rec;
+    slot.sequence.store(tail + CAPACITY, std::memory_order_release);
+    ++tail;
+  }
+  return count;
+}
+
+size_t TraceLog::drain_to(FILE *out)
+{
+  TraceRecord recs[64];
+  char        line[128];
+  size_t      total = 0;
+  size_t      count;
+  while ((count = drain(recs, 64)) > 0)
+  {
+    for (size_t n = 0; n < count; ++n)
+    {
+      if (format(recs[n], line, sizeof(line)) > 0)
+      {
+        fputs(line, out);
+        fputc('\n', out);
+      }
+    }
+    total += count;
+  }
+  fflush(out);
+  return total;
+}
+
+size_t TraceLog::dump_binary(FILE *out)
+{
+  TraceRecord recs[64];
+  size_t      total = 0;
+  size_t      count;
+  while ((count = drain(recs, 64)) > 0)
+  {
+    fwrite(recs, sizeof(TraceRecord), count, out);
+    total += count;
+  }
+  fflush(out);
+  return total;
+}
+
+const char *TraceLog::event_name(uint16_t event)
+{
+  static const char *const names[] = {"WAIT_FOR_READY", "STATUS_POLL",    "SAMPLE_DROPPED", "EMU_RDATA",
+                                      "CRC_ERROR",      "UNKNOWN_DEVICE", "CALIBRATION",    "READY_TIMEOUT",
+                                      "INITIALIZED",    "CONFIG_MISMATCH"};
+  static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(TraceEvent::NUM_EVENTS),
+                "Every TraceEvent needs a name");
+  return (event < static_cast<uint16_t>(TraceEvent::NUM_EVENTS)) ? names[event] : "UNKNOWN";
+}
+
+// Same naming the emulator used to print for mux inputs
+static const char *mux_input_name(uint8_t input, char *buf, size_t buf_size)
+{
+  if (input < 12)
+  {
+    snprintf(buf, buf_size, "%u", input);
+    return buf;
+  }
+  return (input == 12) ? "GND" : "RESERVED";
+}
+
+int TraceLog::format(const TraceRecord &rec, char *buf, size_t buf_size)
+{
+  static const char level_chars[] = {'-', 'E', 'I', 'D'};
+  const char        level         = (rec.level < sizeof(level_chars)) ? level_chars[rec.level] : '?';
+  const double      t_ms          = rec.timestamp_nanos / 1e6;
+
+  switch (static_cast<TraceEvent>(rec.event))
+  {
+  case TraceEvent::WAIT_FOR_READY:
+    return snprintf(buf, buf_size, "[%c %12.3f] Waiting for ADC RDY bit to go low", level, t_ms);
+
+  case TraceEvent::STATUS_POLL:
+    return snprintf(buf, buf_size, "[%c %12.3f] STATUS = 0x%02X", level, t_ms, rec.arg0);
+
+  case TraceEvent::SAMPLE_DROPPED:
+    return snprintf(buf, buf_size, "[%c %12.3f] Sample ring full, %u samples dropped", level, t_ms, rec.arg0);
+
+  case TraceEvent::CRC_ERROR:
+    return snprintf(buf, buf_size, "[%c %12.3f] CRC mismatch on 0x%04X, %u CRC errors", level, t_ms, rec.arg1,
+                    rec.arg0);
+
+  case TraceEvent::UNKNOWN_DEVICE:
+    return snprintf(buf, buf_size, "[%c %12.3f] Unexpected device ID 0x%02X (expected 0x%02X)", level, t_ms,
+                    rec.arg0, rec.arg1);
+
+  case TraceEvent::CALIBRATION:
+    return snprintf(buf, buf_size, "[%c %12.3f] Calibration 0x%02X: OFCAL = 0x%04X, FSCAL = 0x%04X", level, t_ms,
+                    rec.arg0, rec.arg1 >> 16, rec.arg1 & 0xffff);
+
+  case TraceEvent::READY_TIMEOUT:
+    return snprintf(buf, buf_size, "[%c %12.3f] ADC never got ready, STATUS = 0x%02X", level, t_ms, rec.arg0);
+
+  case TraceEvent::INITIALIZED:
+    return snprintf(buf, buf_size, "[%c %12.3f] Initialized (%s start) in %.3f mS", level, t_ms,
+                    rec.arg0 ? "warm" : "cold", rec.arg1 / 1e6);
+
+  case TraceEvent::CONFIG_MISMATCH:
+    return snprintf(buf, buf_size, "[%c %12.3f] Register 0x%02X reads back 0x%02X, not 0x%02X", level, t_ms,
+                    rec.arg0, rec.arg1 & 0xff, rec.arg1 >> 8);
+
+  case TraceEvent::EMU_RDATA:
+  {
+    char pos[4];
+    char neg[4];
+    return snprintf(buf, buf_size, "[%c %12.3f] IN+ = %s, IN- = %s -> 0x%04X", level, t_ms,
+                    mux_input_name(rec.arg0 >> 4, pos, sizeof(pos)), mux_input_name(rec.arg0 & 0x0f, neg, sizeof(neg)),
+                    rec.arg1);
+  }
+
+  default:
+    return snprintf(buf, buf_size, "[%c %12.3f] %s 0x%08X 0x%08X", level, t_ms, event_name(rec.event), rec.arg0,
+                    rec.arg1);
+  }
+}
+
+TraceLog &trace_log(void)
+{
+  static TraceLog log;
+  return log;
+}
+
+TraceDrainer::TraceDrainer(FILE *out) : out(out), running(true)
+{
+  worker = std::thread([this]() {
+    while (running.load(std::memory_order_relaxed))
+    {
+      trace_log().drain_to(this->out);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    trace_log().drain_to(this->out);
+  });
+}
+
+TraceDrainer::~TraceDrainer()
+{
+  running = false;
+  worker.join();
+}
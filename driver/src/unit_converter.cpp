@@ -0,0 +1,81 @@
+#include <cmath>
+
+#include "unit_converter.h"
+
+UnitConverter::UnitConverter(double refp0_refn0_volts, double refp1_refn1_volts)
+    : external_reference_volts{refp0_refn0_volts, refp1_refn1_volts}, pga_reg(0), ref_reg(0), valid(false), gain(1),
+      reference_volts(0), volts_per_code(0), microvolts_per_code(0)
+{
+  ;
+}
+
+void UnitConverter::set_external_reference(uint8_t refsel_input, double volts)
+{
+  if (refsel_input < 2)
+  {
+    external_reference_volts[refsel_input] = volts;
+    valid                                  = false;
+  }
+}
+
+bool UnitConverter::update(uint8_t pga, uint8_t ref)
+{
+  // Only the fields that scale the result; a new conversion delay or reference buffer setting
+  // doesn't need a new coefficient
+  pga &= (ADS114S08_PGA::PGA_EN_MASK | ADS114S08_PGA::GAIN_MASK);
+  ref &= ADS114S08_REF::REFSEL_MASK;
+  if (valid && (pga == pga_reg) && (ref == ref_reg))
+  {
+    return false;
+  }
+
+  pga_reg = pga;
+  ref_reg = ref;
+  valid   = true;
+  recalculate();
+  return true;
+}
+
+void UnitConverter::recalculate(void)
+{
+  gain = ADS114S08_PGA::gain(pga_reg);
+
+  switch (ref_reg & ADS114S08_REF::REFSEL_MASK)
+  {
+  case ADS114S08_REF::REFSEL_REF0:
+    reference_volts = external_reference_volts[0];
+    break;
+  case ADS114S08_REF::REFSEL_REF1:
+    reference_volts = external_reference_volts[1];
+    break;
+  case ADS114S08_REF::REFSEL_INT:
+    reference_volts = ADS114S08_REF::INTERNAL_REF_VOLTS;
+    break;
+  default:
+    reference_volts = std::nan("");
+    break;
+  }
+
+  // The only division, and only when the settings change
+  const double volts  = reference_volts / (gain * 32768.0);
+  volts_per_code      = static_cast<float>(volts);
+  microvolts_per_code = static_cast<float>(volts * 1e6);
+}
+
+void UnitConverter::scale_codes(const uint16_t *codes, float *dest, size_t num_samples, float scale)
+{
+  for (size_t n = 0; n < num_samples; ++n)
+  {
+    dest[n] = static_cast<int16_t>(codes[n]) * scale;
+  }
+}
+
+void UnitConverter::to_volts(const uint16_t *codes, float *dest, size_t num_samples)
+{
+  scale_codes(codes, dest, num_samples, volts_per_code);
+}
+
+void UnitConverter::to_microvolts(const uint16_t *codes, float *dest, size_t num_samples)
+{
+  scale_codes(codes, dest, num_samples, microvolts_per_code);
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include "adc_config.h"
+#include "adc_constants.h"
+#include "device_driver.h"
+#include "spi_emulator.h"
+
+static const uint64_t BYTE_NANOS = 8 * ADS114S08_TIMING::T_SCLK;
+
+static constexpr bool same_registers(const AdcConfig::Registers &a, const uint8_t *b)
+{
+  for (uint8_t n = 0; n < AdcConfig::NUM_REGISTERS; ++n)
+  {
+    if (a[n] != b[n])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// A bridge on AIN2 - AIN3 at gain 128, fast, on the internal reference, with both IDACs on
+static constexpr AdcConfig bridge_config(void)
+{
+  AdcConfig config;
+  config.ch_plus        = 2;
+  config.ch_minus       = 3;
+  config.delay          = 1;
+  config.pga_enabled    = true;
+  config.gain           = 7;
+  config.global_chop    = true;
+  config.data_rate      = 0x0c;
+  config.refn_buffer    = true;
+  config.ref_select     = 2;
+  config.ref_control    = 1;
+  config.idac_magnitude = 3;
+  config.idac1_mux      = 2;
+  config.idac2_mux      = 3;
+  config.vbias_inputs   = ADS114S08_VBIAS::VB_AINC;
+  config.cal_samples    = 0;
+  config.sendstat       = true;
+  return config;
+}
+
+// A default AdcConfig is the power-up state, every field lands in its own bits and decode() gives
+// back what encode() was given - all at compile time
+TEST(AdcConfigTests, test_encode_decode)
+{
+  static_assert(same_registers(AdcConfig::encode(AdcConfig{}), &ADS114S08_REGISTERS::RESET_VALUES[AdcConfig::FIRST_REGISTER]),
+                "Default configuration is the reset state");
+
+  constexpr AdcConfig::Registers regs = AdcConfig::encode(bridge_config());
+  static_assert(regs[0] == 0x23, "INPMUX");
+  ASSERT_EQ(0x23, regs[0]);
+  ASSERT_EQ(0x2f, regs[1]);
+  ASSERT_EQ(0x9c, regs[2]);
+  ASSERT_EQ(0x09, regs[3]);
+  ASSERT_EQ(0x03, regs[4]);
+  ASSERT_EQ(0x32, regs[5]);
+  ASSERT_EQ(0x40, regs[6]);
+  ASSERT_EQ(0x01, regs[7]);
+
+  constexpr AdcConfig decoded = AdcConfig::decode(regs);
+  static_assert(same_registers(AdcConfig::encode(decoded), regs.data()), "Round trip");
+  ASSERT_EQ(7, decoded.gain);
+  ASSERT_TRUE(decoded.refn_buffer);
+  ASSERT_TRUE(decoded.refp_buffer);
+
+  // Too wide for its field: cut down to it, not spilled into the next one
+  AdcConfig wide;
+  wide.gain      = 0x0f;
+  wide.data_rate = 0x1d;
+  wide.ch_plus   = 0x13;
+  ASSERT_EQ(0x07, AdcConfig::encode(wide)[1]);
+  ASSERT_EQ(ADS114S08_DATARATE::FILTER | 0x0d, AdcConfig::encode(wide)[2]);
+  ASSERT_EQ(0x31, AdcConfig::encode(wide)[0]);
+}
+
+// apply_config() is one WREG of just the registers that changed plus one RREG of all eight, and
+// the readback catches a device that doesn't hold what was written
+TEST(AdcConfigTests, test_apply_config)
+{
+  SpiEmulator   spi;
+  VirtualClock &clock = spi.get_clock();
+  DeviceDriver  driver(spi, clock);
+  ASSERT_TRUE(driver.initialize());
+
+  AdcConfig config = bridge_config();
+  uint64_t  start  = clock.now_nanos();
+  ASSERT_TRUE(driver.apply_config(config));
+  ASSERT_EQ((2 + 8 + 2 + 8) * BYTE_NANOS, clock.now_nanos() - start);
+  ASSERT_EQ(3, driver.get_data_frame_bytes());
+
+  uint8_t regs[AdcConfig::NUM_REGISTERS];
+  driver.read_registers(AdcConfig::FIRST_REGISTER, AdcConfig::NUM_REGISTERS, regs);
+  ASSERT_TRUE(same_registers(AdcConfig::encode(config), regs));
+  ASSERT_TRUE(same_registers(AdcConfig::encode(driver.get_config()), regs));
+
+  // Next scan phase: only the gain differs
+  config.gain = 4;
+  start       = clock.now_nanos();
+  ASSERT_TRUE(driver.apply_config(config));
+  ASSERT_EQ((2 + 1 + 2 + 8) * BYTE_NANOS, clock.now_nanos() - start);
+  ASSERT_EQ(4, driver.get_config().gain);
+
+  start = clock.now_nanos();
+  ASSERT_TRUE(driver.apply_config(config));
+  ASSERT_EQ((2 + 8) * BYTE_NANOS, clock.now_nanos() - start);
+  ASSERT_TRUE(driver.apply_config(config, false));
+  ASSERT_EQ((2 + 8) * BYTE_NANOS, clock.now_nanos() - start);
+
+  // Nobody's there: CIPO floats high and the readback says so
+  spi.set_chip_select(1);
+  config.data_rate = 0x04;
+  ASSERT_FALSE(driver.apply_config(config));
+}
+
+// initialize(AdcConfig) writes the configuration after a RESET and checks it, or finds it in
+// place and leaves everything else alone too - the calibration included
+TEST(AdcConfigTests, test_initialize_with_config)
+{
+  SpiEmulator spi;
+  spi.set_conversion_errors(100, 1.0);
+  const AdcConfig config = bridge_config();
+
+  {
+    DeviceDriver first(spi, spi.get_clock());
+    ASSERT_TRUE(first.initialize(config));
+    ASSERT_FALSE(first.was_warm_start());
+    ASSERT_TRUE(same_registers(AdcConfig::encode(first.get_config()), AdcConfig::encode(config).data()));
+    first.self_offset_calibration();
+    ASSERT_EQ(100, first.get_cached_register(ADS114S08_REGISTERS::OFCAL0));
+  }
+
+  DeviceDriver driver(spi, spi.get_clock());
+  ASSERT_TRUE(driver.initialize(config));
+  ASSERT_TRUE(driver.was_warm_start());
+  ASSERT_EQ(100, driver.get_cached_register(ADS114S08_REGISTERS::OFCAL0));
+  ASSERT_EQ(3, driver.get_data_frame_bytes());
+}
@@ -0,0 +1,350 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "adc_constants.h"
+#include "async_bus.h"
+#include "bus_scan_sequencer.h"
+#include "device_driver.h"
+#include "sample_filter.h"
+#include "scan_sequencer.h"
+#include "shared_device_driver.h"
+#include "signal_engine.h"
+#include "spi_bus.h"
+#include "spi_emulator.h"
+
+// Every heap allocation in this executable comes through here: global operator new in all its
+// forms and, on glibc, malloc / calloc / realloc themselves (which catches C library calls and
+// anything linked in that doesn't use new). While tracking is on, each one is counted, whatever
+// thread it's on - the DRDY handler and the AsyncBus consumer included.
+static std::atomic<bool>     tracking(false);
+static std::atomic<uint64_t> allocations(0);
+
+static void note_allocation(void)
+{
+  if (tracking.load(std::memory_order_relaxed))
+  {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+  note_allocation();
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+  note_allocation();
+  return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  note_allocation();
+  return __libc_realloc(ptr, size);
+}
+#endif
+
+static void *counted_new(size_t size)
+{
+  note_allocation();
+  void *ptr = std::malloc(size ? size : 1);
+  if (!ptr)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+static void *counted_aligned_new(size_t size, std::align_val_t alignment)
+{
+  note_allocation();
+  const size_t align = static_cast<size_t>(alignment);
+  void        *ptr   = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+  if (!ptr)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *operator new(size_t size)
+{
+  return counted_new(size);
+}
+void *operator new[](size_t size)
+{
+  return counted_new(size);
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+  note_allocation();
+  return std::malloc(size ? size : 1);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+  note_allocation();
+  return std::malloc(size ? size : 1);
+}
+void *operator new(size_t size, std::align_val_t alignment)
+{
+  return counted_aligned_new(size, alignment);
+}
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+  return counted_aligned_new(size, alignment);
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void *ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void *ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+// Counts the allocations between construction and stop(). Nothing that might allocate on its
+// own account - gtest assertions in particular - belongs in between.
+class AllocationCounter
+{
+  public:
+    AllocationCounter()
+    {
+      allocations.store(0, std::memory_order_relaxed);
+      tracking.store(true, std::memory_order_seq_cst);
+    }
+    ~AllocationCounter() { tracking.store(false, std::memory_order_seq_cst); }
+
+    uint64_t stop(void)
+    {
+      tracking.store(false, std::memory_order_seq_cst);
+      return allocations.load(std::memory_order_relaxed);
+    }
+};
+
+static const uint8_t FAST_DATARATE = ADS114S08_DATARATE::FILTER | 0x0d;
+
+// The harness itself: it sees new, new[], containers and malloc, and only while counting
+TEST(AllocationTests, test_harness_counts)
+{
+  AllocationCounter counter;
+  int              *one  = new int(1);
+  int              *many = new int[16];
+  void             *raw  = std::malloc(32);
+  std::vector<int>  grown;
+  grown.push_back(1);
+  const uint64_t counted = counter.stop();
+  delete one;
+  delete[] many;
+  std::free(raw);
+#if defined(__GLIBC__)
+  // new goes through malloc, so each of those is seen twice
+  ASSERT_GE(counted, 4u);
+#else
+  ASSERT_EQ(3u, counted);
+#endif
+
+  AllocationCounter idle;
+  ASSERT_EQ(0u, idle.stop());
+  delete new int(2);
+  ASSERT_EQ(0u, idle.stop());
+}
+
+// Channel reads and register access, once everything's set up, never touch the heap - including
+// with the emulated inputs generating signals rather than flat levels
+TEST(AllocationTests, test_driver_steady_state)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  ASSERT_TRUE(driver.initialize());
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+  const SignalComponent sine[] = {SignalComponent::sine(1000.0, 50.0), SignalComponent::noise(20.0, 7)};
+  ASSERT_TRUE(spi.get_signals().set_source(2, sine, 2));
+
+  uint8_t  burst[ADS114S08_REGISTERS::NUM_REGISTERS];
+  uint32_t checksum = 0;
+
+  AllocationCounter counter;
+  for (uint32_t pass = 0; pass < 200; ++pass)
+  {
+    const uint8_t ch = static_cast<uint8_t>(pass % driver.get_num_channels());
+    driver.set_channel(ch);
+    checksum += driver.read_adc_by_rdata_cmd();
+    checksum += driver.switch_channel_and_read((ch + 1) % driver.get_num_channels());
+    checksum += driver.read_register(ADS114S08_REGISTERS::STATUS);
+    driver.write_register(ADS114S08_REGISTERS::GPIODAT, static_cast<uint8_t>(pass & 0x0f));
+    driver.read_registers(ADS114S08_REGISTERS::ID, ADS114S08_REGISTERS::NUM_REGISTERS, burst);
+    checksum += burst[ADS114S08_REGISTERS::DATARATE];
+    driver.stage_register(ADS114S08_REGISTERS::PGA, static_cast<uint8_t>(pass & 0x07));
+    driver.sync();
+    checksum += static_cast<uint32_t>(driver.get_stats().bytes);
+  }
+  const uint64_t counted = counter.stop();
+  ASSERT_EQ(0u, counted);
+  ASSERT_NE(0u, checksum);
+}
+
+// Continuous conversion: the DRDY handler reads each sample as it lands and the consumer drains
+// them, on the plain driver and through SharedDeviceDriver's fan-out
+TEST(AllocationTests, test_continuous_conversion)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  ASSERT_TRUE(driver.initialize());
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+  driver.set_channel(5);
+  spi.attach_drdy_isr(DeviceDriver::adc_ready_isr, &driver);
+  driver.start_conversions();
+  spi.advance_time(driver.get_settling_nanos());
+
+  uint16_t samples[16];
+  size_t   received = 0;
+  uint32_t checksum = 0;
+
+  AllocationCounter counter;
+  for (uint32_t block = 0; block < 100; ++block)
+  {
+    spi.advance_time(8 * 250000);
+    received += driver.read_samples(samples, 16);
+  }
+  uint64_t counted = counter.stop();
+  driver.stop_conversions();
+  ASSERT_EQ(0u, counted);
+  ASSERT_GE(received, 790u);
+
+  SharedDeviceDriver shared(driver);
+  auto               logger  = shared.subscribe();
+  auto               control = shared.subscribe();
+  spi.attach_drdy_isr(SharedDeviceDriver::adc_ready_isr, &shared);
+  shared.start_conversions();
+  spi.advance_time(driver.get_settling_nanos());
+  received = 0;
+
+  AllocationCounter shared_counter;
+  for (uint32_t block = 0; block < 100; ++block)
+  {
+    spi.advance_time(8 * 250000);
+    received += shared.read_samples(logger, samples, 16);
+    (void)shared.read_samples(control, samples, 16);
+    checksum += shared.read_register(ADS114S08_REGISTERS::DATARATE);
+  }
+  counted = shared_counter.stop();
+  shared.stop_conversions();
+  ASSERT_EQ(0u, counted);
+  ASSERT_GE(received, 790u);
+  ASSERT_NE(0u, checksum);
+}
+
+// Scans on one device and across a bus, synchronous and through AsyncBus, then filtered
+TEST(AllocationTests, test_scans)
+{
+  MuxPair list[12];
+  for (uint8_t ch = 0; ch < 12; ++ch)
+  {
+    list[ch] = {ch, ADS114S08_INPMUX::AINCOM};
+  }
+
+  SpiEmulator  spi(3, false);
+  SpiBus       bus(spi, spi.get_clock());
+  DeviceDriver adc0(bus.device(0), spi.get_clock());
+  DeviceDriver adc1(bus.device(1), spi.get_clock());
+  DeviceDriver adc2(bus.device(2), spi.get_clock());
+  for (DeviceDriver *adc : {&adc0, &adc1, &adc2})
+  {
+    ASSERT_TRUE(adc->initialize());
+    adc->write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+  }
+
+  ScanSequencer    sequencer(adc0);
+  BusScanSequencer bus_sequencer(bus);
+  AsyncBus         async(bus);
+  ASSERT_TRUE(sequencer.set_scan_list(list, 12));
+  ASSERT_TRUE(bus_sequencer.add_device(adc1, list, 12));
+  ASSERT_TRUE(bus_sequencer.add_device(adc2, list, 6));
+  ASSERT_EQ(0u, async.add_device(adc0));
+  ASSERT_EQ(1u, async.add_device(adc1));
+
+  MedianFilter   median;
+  CicDecimator   cic;
+  FilterPipeline pipeline;
+  ASSERT_TRUE(median.configure(12, 3));
+  ASSERT_TRUE(cic.configure(12, 4, 2));
+  ASSERT_TRUE(pipeline.add_stage(median));
+  ASSERT_TRUE(pipeline.add_stage(cic));
+
+  uint16_t        codes[8 * 12];
+  int16_t         signed_codes[12];
+  uint16_t        bus_codes[8 * 18];
+  float           filtered[8 * 12];
+  uint8_t         regs[4];
+  AsyncCompletion completions[8];
+  size_t          readings  = 0;
+  size_t          completed = 0;
+
+  AllocationCounter counter;
+  for (uint32_t pass = 0; pass < 20; ++pass)
+  {
+    sequencer.scan(codes);
+    sequencer.scan(signed_codes);
+    readings += sequencer.run(codes, 8);
+    readings += pipeline.process(codes, 8, filtered);
+    bus_sequencer.scan(bus_codes);
+    readings += bus_sequencer.run(bus_codes, 8);
+
+    (void)async.submit_scan(0, list, 12, codes);
+    (void)async.submit_read_input(1, 3);
+    (void)async.submit_read_registers(1, ADS114S08_REGISTERS::INPMUX, 4, regs);
+    while (async.get_pending())
+    {
+      (void)async.wait();
+    }
+    completed += async.get_completions(completions, 8);
+  }
+  const uint64_t counted = counter.stop();
+  ASSERT_EQ(0u, counted);
+  ASSERT_EQ(20u * 3, completed);
+  ASSERT_GT(readings, 0u);
+}
+
+// Copying an emulator would leave the copy pointing at the original's bus buffers and clock
+// listener, and passing one by value was how the app once ended up copying it on every read
+TEST(AllocationTests, test_emulator_not_copyable)
+{
+  ASSERT_FALSE(std::is_copy_constructible<SpiEmulator>::value);
+  ASSERT_FALSE(std::is_copy_assignable<SpiEmulator>::value);
+}
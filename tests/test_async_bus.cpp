@@ -0,0 +1,374 @@
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "adc_constants.h"
+#include "async_bus.h"
+#include "device_driver.h"
+#include "spi_bus.h"
+#include "spi_emulator.h"
+
+static const uint8_t  FAST_DATARATE = ADS114S08_DATARATE::FILTER | 0x0d;
+static const uint64_t BYTE_NANOS    = 8 * ADS114S08_TIMING::T_SCLK;
+
+// A full bus: eight emulated ADCs, a driver for each, all of them on one AsyncBus
+struct BusRig
+{
+    SpiEmulator                   spi;
+    SpiBus                        bus;
+    AsyncBus                      async;
+    std::unique_ptr<DeviceDriver> adcs[SpiBus::MAX_DEVICES];
+
+    BusRig() : spi(SpiBus::MAX_DEVICES, false), bus(spi, spi.get_clock()), async(bus)
+    {
+      for (uint8_t cs = 0; cs < SpiBus::MAX_DEVICES; ++cs)
+      {
+        adcs[cs] = std::make_unique<DeviceDriver>(bus.device(cs), spi.get_clock());
+        adcs[cs]->initialize();
+        adcs[cs]->write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+        async.add_device(*adcs[cs]);
+      }
+    }
+};
+
+static void count_completion(const AsyncCompletion &completion)
+{
+  AsyncCompletion *last = static_cast<AsyncCompletion *>(completion.context);
+  *last                 = completion;
+}
+
+// Submitting costs no bus time; poll() then does the work, in submission order per device, and
+// each request comes back with the right result - through its callback or the completion queue
+TEST(AsyncBusTests, test_submit_and_complete)
+{
+  SpiEmulator   spi(2, false);
+  VirtualClock &clock = spi.get_clock();
+  SpiBus        bus(spi, clock);
+  DeviceDriver  adc0(bus.device(0), clock);
+  DeviceDriver  adc1(bus.device(1), clock);
+  ASSERT_TRUE(adc0.initialize());
+  ASSERT_TRUE(adc1.initialize());
+
+  AsyncBus      async(bus);
+  const uint8_t d0 = async.add_device(adc0);
+  const uint8_t d1 = async.add_device(adc1);
+  ASSERT_EQ(0, d0);
+  ASSERT_EQ(1, d1);
+
+  const uint8_t   pga[]        = {0x0a, FAST_DATARATE};
+  uint8_t         readback[2]  = {0};
+  AsyncCompletion via_callback = {};
+
+  uint64_t       start = clock.now_nanos();
+  const uint32_t write = async.submit_write_registers(d0, ADS114S08_REGISTERS::PGA, pga, 2);
+  const uint32_t read  = async.submit_read_registers(d0, ADS114S08_REGISTERS::PGA, 2, readback);
+  const uint32_t input = async.submit_read_input(d1, 6, ADS114S08_INPMUX::AINCOM, count_completion, &via_callback);
+  ASSERT_NE(0u, write);
+  ASSERT_NE(0u, read);
+  ASSERT_NE(0u, input);
+  ASSERT_EQ(start, clock.now_nanos());
+  ASSERT_EQ(3u, async.get_pending());
+  ASSERT_EQ(start, async.get_next_deadline());
+
+  // The register transfers go straight out. Device 1 is in standby, so its input read STARTs a
+  // conversion and comes back for it a settling time later.
+  ASSERT_EQ(2u, async.poll());
+  ASSERT_EQ(1u, async.get_pending());
+  ASSERT_GT(async.get_next_deadline(), clock.now_nanos());
+  ASSERT_LE(async.get_next_deadline(), clock.now_nanos() + adc1.get_settling_nanos());
+  ASSERT_EQ(1u, async.wait());
+  ASSERT_EQ(0u, async.get_pending());
+  ASSERT_EQ(AsyncBus::NO_DEADLINE, async.get_next_deadline());
+  ASSERT_FALSE(adc1.is_converting());
+
+  // Device 0's write went out before its read
+  ASSERT_EQ(0x0a, readback[0]);
+  ASSERT_EQ(FAST_DATARATE, readback[1]);
+
+  // The input read went to its callback, the register transfers onto the queue
+  ASSERT_EQ(input, via_callback.id);
+  ASSERT_EQ(AsyncOp::READ_INPUT, via_callback.op);
+  ASSERT_EQ(d1, via_callback.device);
+  ASSERT_TRUE(via_callback.ok);
+  ASSERT_EQ(spi.get_raw_adc_test_val(6, 1), via_callback.value);
+
+  AsyncCompletion done[4];
+  ASSERT_EQ(2u, async.get_completions(done, 4));
+  ASSERT_EQ(write, done[0].id);
+  ASSERT_EQ(AsyncOp::WRITE_REGISTERS, done[0].op);
+  ASSERT_EQ(read, done[1].id);
+  ASSERT_LE(done[0].completed_nanos, done[1].completed_nanos);
+  ASSERT_FALSE(async.get_completion(done[0]));
+
+  // A scan on device 1 while device 0 reads one input
+  const MuxPair scan_list[] = {{0, 0x0c}, {3, 0x0c}, {9, 0x0c}};
+  uint16_t      results[3]  = {0};
+  adc1.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+  start = clock.now_nanos();
+  ASSERT_NE(0u, async.submit_scan(d1, scan_list, 3, results));
+  ASSERT_NE(0u, async.submit_read_input(d0, 11));
+  size_t completed = 0;
+  while (async.get_pending())
+  {
+    completed += async.wait();
+  }
+  ASSERT_EQ(2u, completed);
+  ASSERT_EQ(2u, async.get_completions(done, 4));
+  ASSERT_EQ(AsyncOp::READ_INPUT, done[0].op);
+  ASSERT_EQ(spi.get_raw_adc_test_val(11, 0), done[0].value);
+  ASSERT_EQ(AsyncOp::SCAN, done[1].op);
+  ASSERT_TRUE(done[1].ok);
+  ASSERT_EQ(3, done[1].value);
+  for (size_t n = 0; n < 3; ++n)
+  {
+    ASSERT_EQ(spi.get_raw_adc_test_val(scan_list[n].ch_plus, 1), results[n]);
+  }
+  ASSERT_GE(clock.now_nanos() - start, 3 * adc1.get_settling_nanos());
+  ASSERT_EQ(0u, async.wait());
+}
+
+// Eight converting devices, each moved to a new input and read: synchronously that's eight
+// settling times back to back, through AsyncBus they settle together
+TEST(AsyncBusTests, test_settling_overlaps)
+{
+  BusRig        rig;
+  VirtualClock &clock = rig.spi.get_clock();
+  ASSERT_EQ(SpiBus::MAX_DEVICES, rig.async.get_num_devices());
+  for (auto &adc : rig.adcs)
+  {
+    adc->start_conversions();
+  }
+  const uint64_t settling = rig.adcs[0]->get_settling_nanos();
+
+  uint64_t start = clock.now_nanos();
+  for (uint8_t cs = 0; cs < SpiBus::MAX_DEVICES; ++cs)
+  {
+    rig.adcs[cs]->set_channel(cs + 1);
+    clock.delay_nanos(settling);
+    ASSERT_EQ(rig.spi.get_raw_adc_test_val(cs + 1, cs), rig.adcs[cs]->read_adc_by_rdata_cmd());
+  }
+  ASSERT_GE(clock.now_nanos() - start, SpiBus::MAX_DEVICES * settling);
+
+  start = clock.now_nanos();
+  for (uint8_t cs = 0; cs < SpiBus::MAX_DEVICES; ++cs)
+  {
+    ASSERT_NE(0u, rig.async.submit_read_input(cs, cs + 3));
+  }
+  while (rig.async.get_pending())
+  {
+    rig.async.wait();
+  }
+  const uint64_t elapsed = clock.now_nanos() - start;
+  ASSERT_GE(elapsed, settling);
+  ASSERT_LT(elapsed, 2 * settling);
+
+  AsyncCompletion done;
+  for (uint8_t n = 0; n < SpiBus::MAX_DEVICES; ++n)
+  {
+    ASSERT_TRUE(rig.async.get_completion(done));
+    ASSERT_EQ(rig.spi.get_raw_adc_test_val(done.device + 3, done.device), done.value);
+  }
+
+  // Already on the input: no settling to wait for, straight to RDATA
+  start = clock.now_nanos();
+  ASSERT_NE(0u, rig.async.submit_read_input(0, 3));
+  ASSERT_EQ(1u, rig.async.wait());
+  ASSERT_LT(clock.now_nanos() - start, 8 * BYTE_NANOS);
+}
+
+// With the emulator timing-accurate, RDATA in standby gives the last completed conversion, not
+// the input the mux points at now. A read of a new input from standby STARTs a conversion on it
+// and waits for it, in continuous and single-shot mode alike, and leaves the device in standby.
+// A scan on the single-shot device puts it in continuous mode.
+TEST(AsyncBusTests, test_standby_read_input)
+{
+  SpiEmulator   spi(2, false);
+  VirtualClock &clock = spi.get_clock();
+  SpiBus        bus(spi, clock);
+  DeviceDriver  continuous(bus.device(0), clock);
+  DeviceDriver  single_shot(bus.device(1), clock);
+  ASSERT_TRUE(continuous.initialize());
+  ASSERT_TRUE(single_shot.initialize());
+  continuous.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+  single_shot.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE | ADS114S08_DATARATE::MODE);
+  spi.set_timing_accurate(true);
+
+  AsyncBus async(bus);
+  ASSERT_EQ(0u, async.add_device(continuous));
+  ASSERT_EQ(1u, async.add_device(single_shot));
+
+  const uint8_t inputs[] = {2, 7, 7, 11};
+  for (uint8_t ch : inputs)
+  {
+    const uint64_t start = clock.now_nanos();
+    ASSERT_NE(0u, async.submit_read_input(0, ch));
+    ASSERT_NE(0u, async.submit_read_input(1, ch));
+    while (async.get_pending())
+    {
+      async.wait();
+    }
+    ASSERT_GE(clock.now_nanos() - start, continuous.get_settling_nanos());
+
+    AsyncCompletion done[2];
+    ASSERT_EQ(2u, async.get_completions(done, 2));
+    for (const AsyncCompletion &completion : done)
+    {
+      ASSERT_TRUE(completion.ok);
+      ASSERT_EQ(spi.get_raw_adc_test_val(ch, completion.device), completion.value) << "device " << int(completion.device);
+    }
+    ASSERT_FALSE(continuous.is_converting());
+    ASSERT_FALSE(single_shot.is_converting());
+  }
+
+  // Nothing left converting in the background
+  const uint32_t conversions[] = {spi.get_conversions(0), spi.get_conversions(1)};
+  spi.advance_time(10 * continuous.get_settling_nanos());
+  ASSERT_EQ(conversions[0], spi.get_conversions(0));
+  ASSERT_EQ(conversions[1], spi.get_conversions(1));
+
+  // A scan needs every mux change to start a conversion, so it switches the single-shot device to
+  // continuous mode rather than reading the first entry's result over and over
+  const MuxPair scan_list[] = {{1, 0x0c}, {4, 0x0c}, {9, 0x0c}};
+  uint16_t      results[3];
+  ASSERT_NE(0u, async.submit_scan(1, scan_list, 3, results));
+  while (async.get_pending())
+  {
+    async.wait();
+  }
+  AsyncCompletion scanned;
+  ASSERT_EQ(1u, async.get_completions(&scanned, 1));
+  ASSERT_TRUE(scanned.ok);
+  for (size_t n = 0; n < 3; ++n)
+  {
+    ASSERT_EQ(spi.get_raw_adc_test_val(scan_list[n].ch_plus, 1), results[n]);
+  }
+  ASSERT_EQ(FAST_DATARATE, single_shot.read_register(ADS114S08_REGISTERS::DATARATE));
+}
+
+// Four buses of eight devices - 32 drivers - served from one thread: poll each bus, sleep until
+// the earliest deadline among them
+TEST(AsyncBusTests, test_many_buses_one_thread)
+{
+  const size_t  NUM_BUSES   = 4;
+  const MuxPair scan_list[]                                 = {{1, 0x0c}, {2, 0x0c}, {4, 0x0c}, {8, 0x0c}};
+  auto          rigs                                        = std::make_unique<BusRig[]>(NUM_BUSES);
+  uint16_t      results[NUM_BUSES][SpiBus::MAX_DEVICES][4] = {};
+
+  for (size_t b = 0; b < NUM_BUSES; ++b)
+  {
+    for (uint8_t cs = 0; cs < SpiBus::MAX_DEVICES; ++cs)
+    {
+      ASSERT_NE(0u, rigs[b].async.submit_scan(cs, scan_list, 4, results[b][cs]));
+    }
+    ASSERT_EQ(AsyncBus::NO_DEVICE, rigs[b].async.add_device(*rigs[b].adcs[0]));
+  }
+
+  // Each emulator keeps its own virtual time, so sleeping means moving every clock on by the
+  // time to the nearest deadline on any of them
+  size_t pending = NUM_BUSES * SpiBus::MAX_DEVICES;
+  while (pending)
+  {
+    uint64_t sleep = AsyncBus::NO_DEADLINE;
+    pending        = 0;
+    for (size_t b = 0; b < NUM_BUSES; ++b)
+    {
+      rigs[b].async.poll();
+      pending += rigs[b].async.get_pending();
+      const uint64_t deadline = rigs[b].async.get_next_deadline();
+      const uint64_t now      = rigs[b].spi.get_clock().now_nanos();
+      if (deadline != AsyncBus::NO_DEADLINE)
+      {
+        sleep = std::min(sleep, (deadline > now) ? deadline - now : 0);
+      }
+    }
+    if (pending)
+    {
+      ASSERT_NE(AsyncBus::NO_DEADLINE, sleep);
+      for (size_t b = 0; b < NUM_BUSES; ++b)
+      {
+        rigs[b].spi.get_clock().delay_nanos(sleep);
+      }
+    }
+  }
+
+  for (size_t b = 0; b < NUM_BUSES; ++b)
+  {
+    AsyncCompletion done;
+    size_t          completions = 0;
+    while (rigs[b].async.get_completion(done))
+    {
+      ASSERT_TRUE(done.ok);
+      ++completions;
+    }
+    ASSERT_EQ(SpiBus::MAX_DEVICES, completions);
+    for (uint8_t cs = 0; cs < SpiBus::MAX_DEVICES; ++cs)
+    {
+      for (size_t n = 0; n < 4; ++n)
+      {
+        ASSERT_EQ(rigs[b].spi.get_raw_adc_test_val(scan_list[n].ch_plus, cs), results[b][cs][n]);
+      }
+    }
+  }
+}
+
+// Bad requests and a full pool give 0; a full completion queue holds back requests that would
+// complete onto it until the consumer makes room, but not ones with a callback
+TEST(AsyncBusTests, test_limits_and_back_pressure)
+{
+  SpiEmulator  spi(2, false);
+  SpiBus       bus(spi, spi.get_clock());
+  DeviceDriver adc(bus.device(0), spi.get_clock());
+  DeviceDriver s06(bus.device(1), spi.get_clock());
+  spi.set_device_id(ADS114S06_Traits::DEVICE_ID, 1);
+  ASSERT_TRUE(adc.initialize());
+  ASSERT_TRUE(s06.initialize());
+
+  AsyncBus      async(bus);
+  const uint8_t d   = async.add_device(adc);
+  const uint8_t d06 = async.add_device(s06);
+  uint8_t       regs[DeviceDriver::MAX_BURST_REGISTERS + 1];
+  uint16_t      results[1];
+  const MuxPair bad_list[] = {{0x0f, 0x0c}};
+  const MuxPair ain7[]     = {{7, 0x0c}};
+
+  ASSERT_EQ(0u, async.submit_read_input(2, 0));
+  ASSERT_EQ(0u, async.submit_read_input(d, 0x0d));
+  ASSERT_EQ(0u, async.submit_read_input(d06, 7));
+  ASSERT_EQ(0u, async.submit_read_input(d06, 0, 6));
+  ASSERT_EQ(0u, async.submit_scan(d06, ain7, 1, results));
+  ASSERT_EQ(0u, async.submit_scan(2, ain7, 1, results));
+  ASSERT_EQ(0u, async.submit_read_registers(d, 0, 0, regs));
+  ASSERT_EQ(0u, async.submit_read_registers(d, 0, DeviceDriver::MAX_BURST_REGISTERS + 1, regs));
+  ASSERT_EQ(0u, async.submit_read_registers(d, 0, 1, nullptr));
+  ASSERT_EQ(0u, async.submit_scan(d, bad_list, 1, results));
+  ASSERT_EQ(0u, async.submit_scan(d, bad_list, 0, results));
+  ASSERT_EQ(0u, async.get_pending());
+
+  for (size_t n = 0; n < AsyncBus::MAX_REQUESTS; ++n)
+  {
+    ASSERT_NE(0u, async.submit_read_registers(d, static_cast<uint8_t>(n % 12), 1, regs));
+  }
+  ASSERT_EQ(0u, async.submit_read_input(d, 0));
+
+  // Room for exactly COMPLETION_QUEUE_CAPACITY of them
+  ASSERT_EQ(AsyncBus::COMPLETION_QUEUE_CAPACITY, AsyncBus::MAX_REQUESTS);
+  ASSERT_EQ(AsyncBus::MAX_REQUESTS, async.poll());
+  ASSERT_EQ(0u, async.get_pending());
+
+  AsyncCompletion last = {};
+  ASSERT_NE(0u, async.submit_read_input(d, 5));
+  const uint32_t with_callback = async.submit_read_input(d, 6, ADS114S08_INPMUX::AINCOM, count_completion, &last);
+  ASSERT_NE(0u, with_callback);
+  ASSERT_EQ(0u, async.poll());
+  ASSERT_EQ(0u, async.wait());
+  ASSERT_EQ(2u, async.get_pending());
+  ASSERT_EQ(AsyncBus::NO_DEADLINE, async.get_next_deadline());
+
+  // One slot frees the first; the second goes to its callback, so it isn't held up at all
+  AsyncCompletion done;
+  ASSERT_TRUE(async.get_completion(done));
+  ASSERT_EQ(1u, async.wait());
+  ASSERT_EQ(1u, async.wait());
+  ASSERT_EQ(0u, async.get_pending());
+  ASSERT_EQ(with_callback, last.id);
+  ASSERT_EQ(spi.get_raw_adc_test_val(6, 0), last.value);
+}
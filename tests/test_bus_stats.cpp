@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+
+#include "adc_constants.h"
+#include "bus_stats.h"
+#include "device_driver.h"
+#include "spi_emulator.h"
+
+static const uint64_t BYTE_NANOS = 8 * ADS114S08_TIMING::T_SCLK;
+
+// Every value lands in a bucket that holds it and is no wider than an eighth of the values in
+// it; buckets come in order; anything past the top goes in the last one
+TEST(BusStatsTests, test_buckets)
+{
+  size_t last = 0;
+  for (uint64_t v = 0; v < (1u << 20); v += 1 + v / 64)
+  {
+    const size_t bucket = LATENCY_BUCKETS::index_of(v);
+    ASSERT_LT(bucket, LATENCY_BUCKETS::NUM_BUCKETS);
+    ASSERT_LE(LATENCY_BUCKETS::lowest_in(bucket), v);
+    ASSERT_GE(LATENCY_BUCKETS::highest_in(bucket), v);
+    ASSERT_LE(LATENCY_BUCKETS::highest_in(bucket) - LATENCY_BUCKETS::lowest_in(bucket),
+              LATENCY_BUCKETS::lowest_in(bucket) / LATENCY_BUCKETS::SUB_BUCKETS);
+    ASSERT_GE(bucket, last);
+    last = bucket;
+  }
+  for (size_t bucket = 1; bucket < LATENCY_BUCKETS::NUM_BUCKETS; ++bucket)
+  {
+    ASSERT_EQ(LATENCY_BUCKETS::highest_in(bucket - 1) + 1, LATENCY_BUCKETS::lowest_in(bucket));
+  }
+
+  const uint64_t top = static_cast<uint64_t>(1) << LATENCY_BUCKETS::MAX_BITS;
+  ASSERT_EQ(LATENCY_BUCKETS::NUM_BUCKETS - 1, LATENCY_BUCKETS::index_of(top - 1));
+  ASSERT_EQ(LATENCY_BUCKETS::NUM_BUCKETS - 1, LATENCY_BUCKETS::index_of(top));
+  ASSERT_EQ(LATENCY_BUCKETS::NUM_BUCKETS - 1, LATENCY_BUCKETS::index_of(UINT64_MAX));
+}
+
+// 90 fast, 9 slow and one very slow transaction: the median is a fast one, p99 a slow one and
+// p100 the very slow one, each to within its bucket
+TEST(BusStatsTests, test_percentiles)
+{
+  LatencySnapshot latency{};
+  ASSERT_EQ(0u, latency.value_at_percentile(50.0));
+  ASSERT_EQ(0u, latency.mean_nanos());
+
+  latency.buckets[LATENCY_BUCKETS::index_of(1000)]    = 90;
+  latency.buckets[LATENCY_BUCKETS::index_of(50000)]   = 9;
+  latency.buckets[LATENCY_BUCKETS::index_of(2000000)] = 1;
+  latency.count                                        = 100;
+  latency.total_nanos                                  = 90 * 1000 + 9 * 50000 + 2000000;
+  latency.max_nanos                                    = 2000000;
+
+  ASSERT_EQ(25400u, latency.mean_nanos());
+  ASSERT_GE(latency.value_at_percentile(0.0), 1000u);
+  ASSERT_LE(latency.value_at_percentile(0.0), 1000u + 1000u / 8);
+  ASSERT_EQ(latency.value_at_percentile(0.0), latency.value_at_percentile(90.0));
+  ASSERT_GE(latency.value_at_percentile(90.5), 50000u);
+  ASSERT_LE(latency.value_at_percentile(99.0), 50000u + 50000u / 8);
+  ASSERT_EQ(2000000u, latency.value_at_percentile(99.5));
+  ASSERT_EQ(2000000u, latency.value_at_percentile(100.0));
+}
+
+// Each kind of transaction the driver does is counted once, with its bytes and its exact
+// simulated bus time. Writes the shadow catches and STATUS polls on a device still powering up
+// are counted too.
+TEST(BusStatsTests, test_driver_transactions)
+{
+  SpiEmulator  spi(true);
+  DeviceDriver driver(spi, spi.get_clock());
+  ASSERT_TRUE(driver.initialize());
+  BusStatsSnapshot stats = driver.get_stats();
+  if (!BusStats::ENABLED)
+  {
+    ASSERT_EQ(0u, stats.bytes);
+    ASSERT_EQ(0u, stats.get_transactions(BusOp::RREG));
+    GTEST_SKIP() << "Built with ADS_STATS=0";
+  }
+  ASSERT_GT(stats.status_polls, 0u);
+  ASSERT_EQ(1u, stats.get_transactions(BusOp::RESET));
+  ASSERT_GT(stats.get_transactions(BusOp::RREG), stats.status_polls);
+
+  driver.reset_stats();
+  stats = driver.get_stats();
+  ASSERT_EQ(0u, stats.bytes);
+  ASSERT_EQ(0u, stats.status_polls);
+  ASSERT_EQ(0u, stats.get_latency(BusOp::RREG).count);
+
+  // One register: two command bytes and one back
+  (void)driver.read_register(ADS114S08_REGISTERS::DATARATE);
+  stats = driver.get_stats();
+  ASSERT_EQ(3u, stats.bytes);
+  ASSERT_EQ(1u, stats.get_transactions(BusOp::RREG));
+  ASSERT_EQ(1u, stats.get_latency(BusOp::RREG).count);
+  ASSERT_EQ(3 * BYTE_NANOS, stats.get_latency(BusOp::RREG).max_nanos);
+  ASSERT_EQ(3 * BYTE_NANOS, stats.get_latency(BusOp::RREG).value_at_percentile(50.0));
+
+  // Already holds 0x14: the shadow keeps it off the bus
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, 0x14);
+  driver.set_channel(0);
+  stats = driver.get_stats();
+  ASSERT_EQ(0u, stats.get_transactions(BusOp::WREG));
+  ASSERT_EQ(2u, stats.redundant_writes);
+
+  driver.set_channel(3);
+  (void)driver.read_adc_by_rdata_cmd();
+  (void)driver.switch_channel_and_read(4);
+  driver.self_offset_calibration();
+  stats = driver.get_stats();
+  ASSERT_EQ(1u, stats.get_transactions(BusOp::WREG));
+  ASSERT_EQ(1u, stats.get_transactions(BusOp::RDATA));
+  ASSERT_EQ(1u, stats.get_transactions(BusOp::MUX_AND_RDATA));
+  ASSERT_EQ(1u, stats.get_transactions(BusOp::CALIBRATION));
+  ASSERT_EQ(2u, stats.get_transactions(BusOp::RREG)); // DATARATE, then OFCAL0 .. FSCAL1 after calibrating
+  ASSERT_EQ(3 * BYTE_NANOS, stats.get_latency(BusOp::RDATA).max_nanos);
+  ASSERT_EQ(6 * BYTE_NANOS, stats.get_latency(BusOp::MUX_AND_RDATA).max_nanos);
+
+  // Samples picked up by the DRDY handler are direct reads
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::FILTER | 0x0d);
+  spi.attach_drdy_isr(DeviceDriver::adc_ready_isr, &driver);
+  driver.start_conversions();
+  spi.advance_time(driver.get_settling_nanos() + 9 * 250000);
+  driver.stop_conversions();
+  stats = driver.get_stats();
+  ASSERT_EQ(1u, stats.get_transactions(BusOp::START));
+  ASSERT_EQ(1u, stats.get_transactions(BusOp::STOP));
+  ASSERT_EQ(10u, stats.get_transactions(BusOp::DIRECT_READ));
+  ASSERT_EQ(2 * BYTE_NANOS, stats.get_latency(BusOp::DIRECT_READ).value_at_percentile(99.0));
+
+  // Every byte counted took one byte time, and nothing else did
+  uint64_t bytes = 0;
+  for (size_t op = 0; op < NUM_BUS_OPS; ++op)
+  {
+    ASSERT_EQ(stats.transactions[op], stats.latency[op].count) << bus_op_name(static_cast<BusOp>(op));
+    bytes += stats.latency[op].total_nanos / BYTE_NANOS;
+  }
+  ASSERT_EQ(bytes, stats.bytes);
+}
+
+// The DRDY handler's direct reads land in the middle of foreground register reads and get
+// counted along with them, so every byte and every transaction adds up. (The emulator only
+// raises DRDY inside a transfer; on hardware it can also land between a counter's load and
+// store, which is why counting is a fetch_add.)
+TEST(BusStatsTests, test_counts_with_drdy_handler)
+{
+  if (!BusStats::ENABLED)
+  {
+    GTEST_SKIP() << "Built with ADS_STATS=0";
+  }
+
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  ASSERT_TRUE(driver.initialize());
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::FILTER | 0x0d);
+  spi.attach_drdy_isr(DeviceDriver::adc_ready_isr, &driver);
+  driver.start_conversions();
+  driver.reset_stats();
+
+  // Each RREG takes 3 byte times; a conversion lands every 250 uS
+  const uint64_t NUM_READS = 20000;
+  for (uint64_t n = 0; n < NUM_READS; ++n)
+  {
+    (void)driver.read_register(ADS114S08_REGISTERS::GPIODAT);
+  }
+  spi.attach_drdy_isr(nullptr, nullptr);
+  driver.stop_conversions();
+
+  const BusStatsSnapshot stats        = driver.get_stats();
+  const uint64_t         direct_reads = stats.get_transactions(BusOp::DIRECT_READ);
+  ASSERT_GT(direct_reads, 10u);
+  ASSERT_EQ(NUM_READS, stats.get_transactions(BusOp::RREG));
+  ASSERT_EQ(NUM_READS, stats.get_latency(BusOp::RREG).count);
+  ASSERT_EQ(direct_reads, stats.get_latency(BusOp::DIRECT_READ).count);
+  ASSERT_EQ(3 * NUM_READS + 2 * direct_reads + 1, stats.bytes); // + the STOP
+  ASSERT_EQ(2 * BYTE_NANOS, stats.get_latency(BusOp::DIRECT_READ).max_nanos);
+}
+
+// A monitoring thread takes snapshots while the driver works: counts only ever go up, and
+// the last snapshot has every transaction
+TEST(BusStatsTests, test_snapshot_from_another_thread)
+{
+  if (!BusStats::ENABLED)
+  {
+    GTEST_SKIP() << "Built with ADS_STATS=0";
+  }
+
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.reset_stats();
+
+  const uint64_t        NUM_READS = 20000;
+  std::atomic<bool>     done(false);
+  std::atomic<uint64_t> snapshots(0);
+  bool                  went_backwards = false;
+  std::thread           monitor([&]() {
+    uint64_t last_count = 0;
+    uint64_t last_bytes = 0;
+    while (!done)
+    {
+      const BusStatsSnapshot stats = driver.get_stats();
+      went_backwards |= (stats.get_transactions(BusOp::RREG) < last_count) || (stats.bytes < last_bytes);
+      last_count = stats.get_transactions(BusOp::RREG);
+      last_bytes = stats.bytes;
+      ++snapshots;
+    }
+  });
+
+  while (!snapshots)
+  {
+    std::this_thread::yield();
+  }
+  for (uint64_t n = 0; n < NUM_READS; ++n)
+  {
+    (void)driver.read_register(ADS114S08_REGISTERS::STATUS);
+  }
+  done = true;
+  monitor.join();
+
+  ASSERT_FALSE(went_backwards);
+  ASSERT_GT(snapshots.load(), 0u);
+  const BusStatsSnapshot stats = driver.get_stats();
+  ASSERT_EQ(NUM_READS, stats.get_transactions(BusOp::RREG));
+  ASSERT_EQ(NUM_READS, stats.get_latency(BusOp::RREG).count);
+  ASSERT_EQ(3 * NUM_READS, stats.bytes);
+}
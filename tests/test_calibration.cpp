@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string>
+
+#include "adc_constants.h"
+#include "calibration_store.h"
+#include "device_driver.h"
+#include "spi_emulator.h"
+
+// Fastest data rate with the low-latency filter: one conversion period to settle
+static const uint8_t  FAST_DATARATE = ADS114S08_DATARATE::FILTER | 0x0d;
+static const uint64_t FAST_PERIOD   = ADS114S08_DATARATE::PERIOD_NANOS[0x0d];
+
+static const int16_t OFFSET_ERROR = 137;
+static const double  GAIN_ERROR   = 1.02;
+
+static int16_t read_input(DeviceDriver &driver, uint8_t ch)
+{
+  driver.set_channel(ch);
+  return static_cast<int16_t>(driver.read_adc_by_rdata_cmd());
+}
+
+static int16_t ofcal(DeviceDriver &driver)
+{
+  return static_cast<int16_t>(driver.get_cached_register(ADS114S08_REGISTERS::OFCAL1) << 8 |
+                              driver.get_cached_register(ADS114S08_REGISTERS::OFCAL0));
+}
+
+static uint16_t fscal(DeviceDriver &driver)
+{
+  return static_cast<uint16_t>(driver.get_cached_register(ADS114S08_REGISTERS::FSCAL1) << 8 |
+                               driver.get_cached_register(ADS114S08_REGISTERS::FSCAL0));
+}
+
+// SFOCAL takes out the converter's own offset, SYOCAL the offset at the system's zero point and
+// SYGCAL scales the system's full-scale point to 7FFFh. Each takes the filter's settling time plus
+// a period per extra averaged conversion, and leaves OFCAL / FSCAL in the driver's shadow.
+TEST(CalibrationTests, test_calibration_commands)
+{
+  SpiEmulator spi;
+  spi.set_conversion_errors(OFFSET_ERROR, GAIN_ERROR);
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+  // read_input() converts on the spot, so each calibration shows up in the very next reading
+  spi.set_timing_accurate(false);
+
+  spi.get_signals().set_dc(3, 10000);
+  ASSERT_EQ(10200 + OFFSET_ERROR, read_input(driver, 3));
+
+  // Eight conversions averaged by default; one with CAL_SAMP = 00
+  ASSERT_EQ(8 * FAST_PERIOD, driver.get_calibration_nanos());
+  uint64_t t0 = spi.get_clock().now_nanos();
+  driver.self_offset_calibration();
+  ASSERT_GE(spi.get_clock().now_nanos() - t0, 8 * FAST_PERIOD);
+  ASSERT_LT(spi.get_clock().now_nanos() - t0, 9 * FAST_PERIOD);
+  ASSERT_EQ(OFFSET_ERROR, ofcal(driver));
+  ASSERT_EQ(ADS114S08_CAL::FSCAL_UNITY, fscal(driver));
+  ASSERT_EQ(10200, read_input(driver, 3));
+
+  driver.write_register(ADS114S08_REGISTERS::SYS, driver.get_cached_register(ADS114S08_REGISTERS::SYS) &
+                                                      ~ADS114S08_SYS::CAL_SAMP_MASK);
+  ASSERT_EQ(FAST_PERIOD, driver.get_calibration_nanos());
+
+  // The system holds AIN3 at its zero point, then at its full-scale point
+  spi.get_signals().set_dc(3, 500);
+  driver.system_offset_calibration();
+  ASSERT_EQ(510 + OFFSET_ERROR, ofcal(driver));
+  ASSERT_EQ(0, read_input(driver, 3));
+
+  spi.get_signals().set_dc(3, 20000);
+  driver.system_gain_calibration();
+  ASSERT_NEAR(ADS114S08_CAL::FSCAL_UNITY * 32767.0 / (20400 - 510), fscal(driver), 1);
+  ASSERT_NEAR(INT16_MAX, read_input(driver, 3), 1);
+  ASSERT_EQ(static_cast<int16_t>(spi.get_differential_test_val(3, ADS114S08_INPMUX::AINCOM)), read_input(driver, 3));
+
+  // Halfway up reads halfway, and the calibration applies while converting too
+  spi.get_signals().set_dc(3, 10250);
+  ASSERT_NEAR(16384, read_input(driver, 3), 2);
+  driver.start_conversions();
+  spi.advance_time(driver.get_settling_nanos());
+  ASSERT_NEAR(16384, static_cast<int16_t>(driver.read_adc_by_rdata_cmd()), 2);
+}
+
+// Profiles are kept per (INPMUX, PGA, DATARATE), replace each other for the same configuration,
+// survive a save / load round trip and are only fresh for max_age
+TEST(CalibrationTests, test_profile_store)
+{
+  CalibrationStore store;
+  ASSERT_EQ(nullptr, store.find(0x01, 0x00, 0x14));
+
+  ASSERT_TRUE(store.store({0x01, 0x00, 0x14, 0x0089, 0x4000, 1000}));
+  ASSERT_TRUE(store.store({0x23, 0x0b, 0x1d, 0xfff0, 0x3ff0, 1005}));
+  ASSERT_TRUE(store.store({0x01, 0x00, 0x14, 0x008a, 0x4001, 1010}));
+  ASSERT_EQ(2u, store.get_num_profiles());
+
+  const CalibrationProfile *profile = store.find(0x01, 0x00, 0x14);
+  ASSERT_NE(nullptr, profile);
+  ASSERT_EQ(0x008a, profile->ofcal);
+  ASSERT_EQ(0x4001, profile->fscal);
+  ASSERT_TRUE(CalibrationStore::is_fresh(*profile, 1010, 0));
+  ASSERT_TRUE(CalibrationStore::is_fresh(*profile, 1110, 100));
+  ASSERT_FALSE(CalibrationStore::is_fresh(*profile, 1111, 100));
+  ASSERT_FALSE(CalibrationStore::is_fresh(*profile, 1009, 100));
+
+  const std::string path = ::testing::TempDir() + "test_profile_store.acal";
+  FILE             *out  = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(store.save(out));
+  fclose(out);
+
+  CalibrationStore loaded;
+  FILE            *in = fopen(path.c_str(), "rb");
+  ASSERT_TRUE(loaded.load(in));
+  fclose(in);
+  ASSERT_EQ(2u, loaded.get_num_profiles());
+  profile = loaded.find(0x23, 0x0b, 0x1d);
+  ASSERT_NE(nullptr, profile);
+  ASSERT_EQ(0xfff0, profile->ofcal);
+  ASSERT_EQ(0x3ff0, profile->fscal);
+  ASSERT_EQ(1005u, profile->timestamp);
+
+  // Anything that isn't a whole calibration file leaves the store empty
+  out = fopen(path.c_str(), "wb");
+  fwrite("ACAL\x01\x00\x02\x00\x01\x00", 1, 10, out);
+  fclose(out);
+  in = fopen(path.c_str(), "rb");
+  ASSERT_FALSE(loaded.load(in));
+  fclose(in);
+  ASSERT_EQ(0u, loaded.get_num_profiles());
+  ASSERT_FALSE(loaded.load(nullptr));
+
+  for (size_t n = store.get_num_profiles(); n < CalibrationStore::MAX_PROFILES; ++n)
+  {
+    ASSERT_TRUE(store.store({static_cast<uint8_t>(n), 0x08, 0x14, 0, 0x4000, 0}));
+  }
+  ASSERT_FALSE(store.store({0xff, 0x08, 0x14, 0, 0x4000, 0}));
+}
+
+// Same inputs and data rate on every emulated part, and readings converted on the spot
+static void set_up(SpiEmulator &spi, DeviceDriver &driver)
+{
+  spi.set_timing_accurate(false);
+  for (uint8_t ch = 0; ch < 3; ++ch)
+  {
+    spi.get_signals().set_dc(ch, 4000 + 1000 * ch);
+  }
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+}
+
+// Stage a configuration: an input against AINCOM, and a gain
+static void select(DeviceDriver &driver, uint8_t ch, uint8_t pga)
+{
+  driver.set_channel(ch);
+  driver.stage_register(ADS114S08_REGISTERS::PGA, pga);
+}
+
+// Cold start calibrates every configuration and saves the profiles. A warm start with the same
+// part restores them in a fraction of the time and reads exactly the same; once they're stale,
+// it calibrates again.
+TEST(CalibrationTests, test_warm_start)
+{
+  const std::string path    = ::testing::TempDir() + "test_warm_start.acal";
+  const uint8_t     pgas[]  = {0x00, ADS114S08_PGA::PGA_EN | 2, ADS114S08_PGA::PGA_EN | 5};
+  const uint32_t    MAX_AGE = 3600;
+  uint64_t          cold_nanos;
+
+  {
+    SpiEmulator spi;
+    spi.set_conversion_errors(OFFSET_ERROR, GAIN_ERROR);
+    DeviceDriver driver(spi, spi.get_clock());
+    set_up(spi, driver);
+
+    CalibrationStore store;
+    const uint64_t   t0 = spi.get_clock().now_nanos();
+    for (uint8_t ch = 0; ch < 3; ++ch)
+    {
+      select(driver, ch, pgas[ch]);
+      ASSERT_TRUE(store.restore_or_calibrate(driver, 1000, MAX_AGE));
+      ASSERT_EQ(OFFSET_ERROR, ofcal(driver));
+    }
+    cold_nanos = spi.get_clock().now_nanos() - t0;
+    ASSERT_EQ(3u, store.get_num_profiles());
+
+    FILE *out = fopen(path.c_str(), "wb");
+    ASSERT_TRUE(store.save(out));
+    fclose(out);
+  }
+
+  SpiEmulator spi;
+  spi.set_conversion_errors(OFFSET_ERROR, GAIN_ERROR);
+  DeviceDriver driver(spi, spi.get_clock());
+  set_up(spi, driver);
+
+  CalibrationStore store;
+  FILE            *in = fopen(path.c_str(), "rb");
+  ASSERT_TRUE(store.load(in));
+  fclose(in);
+
+  const uint64_t t0 = spi.get_clock().now_nanos();
+  for (uint8_t ch = 0; ch < 3; ++ch)
+  {
+    select(driver, ch, pgas[ch]);
+    ASSERT_FALSE(store.restore_or_calibrate(driver, 1000 + MAX_AGE, MAX_AGE));
+    ASSERT_EQ(OFFSET_ERROR, ofcal(driver));
+    ASSERT_EQ(static_cast<int16_t>((4000 + 1000 * ch) * GAIN_ERROR), static_cast<int16_t>(driver.read_adc_by_rdata_cmd()));
+  }
+  ASSERT_LT(10 * (spi.get_clock().now_nanos() - t0), cold_nanos);
+
+  // A minute too late: calibrate again, and the new profile takes over
+  select(driver, 0, pgas[0]);
+  ASSERT_TRUE(store.restore_or_calibrate(driver, 1060 + MAX_AGE, MAX_AGE));
+  ASSERT_EQ(1060 + MAX_AGE, store.find(0x0c, pgas[0], FAST_DATARATE)->timestamp);
+  ASSERT_EQ(3u, store.get_num_profiles());
+}
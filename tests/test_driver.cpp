@@ -1,8 +1,17 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <ctime>
 #include <gtest/gtest.h>
+#include <thread>
 
+#include "adc_constants.h"
+#include "crc8.h"
 #include "device_driver.h"
 #include "spi_emulator.h"
+#include "unit_converter.h"
 
 // Instantiates device driver, verifies device_id and number of channels are both 0.
 // Initializes driver and verifies device_id is as expected in accordance with the
@@ -34,6 +43,8 @@ TEST(DeviceDriverTests, test_set_channel_and_read)
   SpiEmulator  spi;
   DeviceDriver driver(spi);
   driver.initialize();
+  // Each read converts the input there and then, with no START and wait in between
+  spi.set_timing_accurate(false);
 
   uint8_t  non_consecutives0[] = {0, 1, 2, 4, 11, 6, 8, 5, 10, 9, 3, 7};
   uint8_t  non_consecutives1[] = {2, 1, 0, 4, 5, 10, 9, 3, 7, 11, 6, 8};
@@ -78,3 +89,809 @@ TEST(DeviceDriverTests, test_read_and_write_reg)
     }
   }
 }
+
+// Forwards every byte to a SpiEmulator and counts how many bytes went out on the wire
+class ByteCountingSpi : public ISpiInterface
+{
+    SpiEmulator &bus;
+
+  public:
+    uint32_t bytes_on_wire = 0;
+
+    ByteCountingSpi(SpiEmulator &spi) : bus(spi) {}
+
+    void init(uint8_t SPI_mode) override { bus.init(SPI_mode); }
+
+    uint8_t transfer(uint8_t data) override
+    {
+      ++bytes_on_wire;
+      return bus.transfer(data);
+    }
+
+    void write(uint8_t data) override
+    {
+      ++bytes_on_wire;
+      bus.write(data);
+    }
+
+    uint8_t read(void) override { return bus.read(); }
+
+    void transfer(const uint8_t *tx, uint8_t *rx, size_t len) override
+    {
+      bytes_on_wire += len;
+      bus.transfer(tx, rx, len);
+    }
+};
+
+// Reads back the whole register map one register at a time and then again with a single
+// RREG burst. Both passes must agree, and the burst must only cost the two command bytes
+// plus one byte per register on the wire. Then writes a block with a single WREG burst
+// and verifies it register-by-register.
+TEST(DeviceDriverTests, test_burst_read_and_write_regs)
+{
+  SpiEmulator     spi;
+  ByteCountingSpi counter(spi);
+  DeviceDriver    driver(counter);
+  driver.initialize();
+
+  uint8_t singles[DeviceDriver::NUM_REGISTERS] = {0};
+  counter.bytes_on_wire                        = 0;
+  for (uint8_t reg_addr = 0; reg_addr < DeviceDriver::NUM_REGISTERS; ++reg_addr)
+  {
+    singles[reg_addr] = driver.read_register(reg_addr);
+  }
+  const uint32_t single_bytes = counter.bytes_on_wire;
+  ASSERT_EQ(3u * DeviceDriver::NUM_REGISTERS, single_bytes);
+
+  uint8_t burst[DeviceDriver::NUM_REGISTERS] = {0};
+  counter.bytes_on_wire                      = 0;
+  driver.read_registers(0, DeviceDriver::NUM_REGISTERS, burst);
+  const uint32_t burst_bytes = counter.bytes_on_wire;
+  ASSERT_EQ(2u + DeviceDriver::NUM_REGISTERS, burst_bytes);
+  ASSERT_LT(burst_bytes, single_bytes);
+
+  for (uint8_t reg_addr = 0; reg_addr < DeviceDriver::NUM_REGISTERS; ++reg_addr)
+  {
+    ASSERT_EQ(singles[reg_addr], burst[reg_addr]);
+  }
+
+  // Write INPMUX through SYS in one go
+  const uint8_t block[] = {0x23, 0x0a, 0x1e, 0x0a, 0x05, 0x44, 0x81, 0x13};
+  driver.write_registers(ADS114S08_REGISTERS::INPMUX, block, sizeof(block));
+  for (uint8_t n = 0; n < sizeof(block); ++n)
+  {
+    ASSERT_EQ(block[n], driver.read_register(ADS114S08_REGISTERS::INPMUX + n));
+  }
+
+  // Registers on either side of the block are untouched
+  ASSERT_EQ(singles[ADS114S08_REGISTERS::STATUS], driver.read_register(ADS114S08_REGISTERS::STATUS));
+  ASSERT_EQ(singles[ADS114S08_REGISTERS::RESERVED0], driver.read_register(ADS114S08_REGISTERS::RESERVED0));
+}
+
+// Exercises the shadow register map: redundant writes never reach the bus, staged writes go out
+// in one burst per contiguous dirty range on sync(), and RESET puts the shadow back to the
+// datasheet defaults while the ID survives.
+TEST(DeviceDriverTests, test_shadow_registers)
+{
+  SpiEmulator     spi;
+  ByteCountingSpi counter(spi);
+  DeviceDriver    driver(counter);
+  driver.initialize();
+
+  counter.bytes_on_wire = 0;
+  driver.set_channel(3);
+  ASSERT_EQ(3u, counter.bytes_on_wire);
+  ASSERT_EQ(3, driver.get_active_channel());
+
+  // Same mux setting again: nothing on the wire
+  driver.set_channel(3);
+  driver.write_register(ADS114S08_REGISTERS::INPMUX, driver.get_cached_register(ADS114S08_REGISTERS::INPMUX));
+  ASSERT_EQ(3u, counter.bytes_on_wire);
+
+  // PGA through DATARATE are contiguous, SYS stands alone: two bursts
+  counter.bytes_on_wire = 0;
+  driver.stage_register(ADS114S08_REGISTERS::INPMUX, 0x45);
+  driver.stage_register(ADS114S08_REGISTERS::PGA, 0x0a);
+  driver.stage_register(ADS114S08_REGISTERS::DATARATE, 0x1c);
+  driver.stage_register(ADS114S08_REGISTERS::SYS, 0x13);
+  ASSERT_EQ(0u, counter.bytes_on_wire);
+  ASSERT_TRUE(driver.is_dirty());
+
+  driver.sync();
+  ASSERT_FALSE(driver.is_dirty());
+  ASSERT_EQ((2u + 3u) + (2u + 1u), counter.bytes_on_wire);
+
+  ASSERT_EQ(0x45, driver.read_register(ADS114S08_REGISTERS::INPMUX));
+  ASSERT_EQ(0x0a, driver.read_register(ADS114S08_REGISTERS::PGA));
+  ASSERT_EQ(0x1c, driver.read_register(ADS114S08_REGISTERS::DATARATE));
+  ASSERT_EQ(0x13, driver.read_register(ADS114S08_REGISTERS::SYS));
+
+  // Nothing left to do
+  counter.bytes_on_wire = 0;
+  driver.sync();
+  ASSERT_EQ(0u, counter.bytes_on_wire);
+
+  driver.reset();
+  for (uint8_t reg_addr = 1; reg_addr < DeviceDriver::NUM_REGISTERS; ++reg_addr)
+  {
+    ASSERT_EQ(ADS114S08_REGISTERS::RESET_VALUES[reg_addr], driver.get_cached_register(reg_addr));
+  }
+  ASSERT_EQ(0x04, driver.get_device_id());
+
+  // ...and the emulated device agrees with the shadow
+  uint8_t device_regs[DeviceDriver::NUM_REGISTERS];
+  driver.read_registers(0, DeviceDriver::NUM_REGISTERS, device_regs);
+  for (uint8_t reg_addr = 0; reg_addr < DeviceDriver::NUM_REGISTERS; ++reg_addr)
+  {
+    ASSERT_EQ(device_regs[reg_addr], driver.get_cached_register(reg_addr));
+  }
+}
+
+// Starts continuous conversions with the DRDY handler attached and lets simulated time pass. The
+// first sample comes after the start delay and one period, then one per conversion period at the
+// rate set in DATARATE, each one read straight out of the output shift register, and nothing more
+// once STOP has been sent.
+TEST(DeviceDriverTests, test_continuous_conversion)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi);
+  driver.initialize();
+
+  const uint8_t channel = 5;
+  driver.set_channel(channel);
+
+  // Reset default DATARATE = 0x14 -> 20 SPS
+  const uint32_t period = ADS114S08_DATARATE::PERIOD_NANOS[0x14 & ADS114S08_DATARATE::DR_MASK];
+  ASSERT_EQ(50000000u, period);
+
+  const uint64_t first = driver.get_settling_nanos();
+  ASSERT_EQ(period + ADS114S08_PGA::delay_nanos(0x00), first);
+
+  spi.attach_drdy_isr(DeviceDriver::adc_ready_isr, &driver);
+  driver.start_conversions();
+
+  spi.advance_time(period);
+  ASSERT_EQ(0u, driver.get_queued_samples());
+
+  spi.advance_time(first - period);
+  ASSERT_EQ(1u, driver.get_queued_samples());
+
+  spi.advance_time(9 * period);
+  ASSERT_EQ(10u, driver.get_queued_samples());
+
+  uint16_t samples[16] = {0};
+  ASSERT_EQ(10u, driver.read_samples(samples, 16));
+  for (uint8_t n = 0; n < 10; ++n)
+  {
+    ASSERT_EQ(spi.get_raw_adc_test_val(channel), samples[n]);
+  }
+
+  driver.stop_conversions();
+  spi.advance_time(10 * period);
+  ASSERT_EQ(0u, driver.get_queued_samples());
+  ASSERT_EQ(0u, driver.get_dropped_samples());
+}
+
+// Load test of the DRDY -> direct read -> ring -> consumer pipeline. A producer thread stands in
+// for the hardware (and its ISR) at the fastest data rate while a consumer thread drains the ring.
+// Every conversion has to show up exactly once, either as a correct sample or as a counted drop.
+TEST(DeviceDriverTests, test_continuous_conversion_threaded)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi);
+  driver.initialize();
+
+  const uint8_t channel = 9;
+  driver.set_channel(channel);
+
+  // Low-latency filter, 4000 SPS
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, 0x1d);
+  const uint32_t period = ADS114S08_DATARATE::PERIOD_NANOS[0x0d];
+
+  const uint32_t NUM_PERIODS = 200000;
+  const uint16_t expected    = spi.get_raw_adc_test_val(channel);
+
+  // Count DRDY edges on the way through, since the ISR's own reads take a little simulated
+  // time too and so squeeze in a few more conversions than NUM_PERIODS
+  struct CountingIsr
+  {
+    DeviceDriver         *driver;
+    std::atomic<uint32_t> edges;
+
+    static void isr(void *context)
+    {
+      auto *self = static_cast<CountingIsr *>(context);
+      self->edges.fetch_add(1, std::memory_order_relaxed);
+      DeviceDriver::adc_ready_isr(self->driver);
+    }
+  } drdy{&driver, {0}};
+
+  spi.attach_drdy_isr(CountingIsr::isr, &drdy);
+  driver.start_conversions();
+
+  std::atomic<bool> producer_done(false);
+  std::atomic<bool> bad_sample(false);
+  uint32_t          received = 0;
+
+  std::thread consumer([&]() {
+    uint16_t block[64];
+    while (!producer_done || ((received + driver.get_dropped_samples()) < drdy.edges))
+    {
+      const size_t count = driver.read_samples(block, 64);
+      for (size_t n = 0; n < count; ++n)
+      {
+        if (block[n] != expected)
+        {
+          bad_sample = true;
+        }
+      }
+      received += count;
+    }
+  });
+
+  std::thread producer([&]() {
+    for (uint32_t n = 0; n < NUM_PERIODS; ++n)
+    {
+      spi.advance_time(period);
+    }
+    producer_done = true;
+  });
+
+  producer.join();
+  consumer.join();
+  driver.stop_conversions();
+
+  ASSERT_FALSE(bad_sample);
+  ASSERT_GE(drdy.edges, NUM_PERIODS);
+  ASSERT_EQ(drdy.edges, received + driver.get_dropped_samples());
+}
+
+// Same as test_init, but with the emulator holding the RDY bit high while it powers up and the
+// driver running on the emulator's virtual clock. The driver has to notice it's ready within one
+// (longest) poll interval of it coming up, and take no real time to do it.
+TEST(DeviceDriverTests, test_init_startup_delay_virtual_time)
+{
+  const uint8_t ADS114S08_DEVICE_ID = 0x04;
+
+  SpiEmulator  spi(true);
+  DeviceDriver driver(spi, spi.get_clock());
+  ASSERT_EQ(0u, spi.get_clock().now_nanos());
+
+  const auto wall_start = std::chrono::steady_clock::now();
+  ASSERT_TRUE(driver.initialize());
+  const auto wall_elapsed = std::chrono::steady_clock::now() - wall_start;
+
+  ASSERT_EQ(ADS114S08_DEVICE_ID, driver.get_device_id());
+  ASSERT_FALSE(driver.was_warm_start());
+  ASSERT_GE(spi.get_clock().now_nanos(), static_cast<uint64_t>(ADS114S08_TIMING::POWERUP_SETTLING_NANOS));
+  ASSERT_LT(spi.get_clock().now_nanos(), ADS114S08_TIMING::POWERUP_SETTLING_NANOS + ADS114S08_TIMING::READY_POLL_MAX_NANOS +
+                                             ADS114S08_TIMING::RESET_DELAY_NANOS + 100000);
+  ASSERT_LT(wall_elapsed, std::chrono::milliseconds(500));
+
+  // Nothing there at all: CIPO floats high, so RDY never clears and initialize() gives up
+  SpiEmulator  absent(true);
+  DeviceDriver missing(absent, absent.get_clock());
+  absent.set_chip_select(1);
+  ASSERT_FALSE(missing.initialize());
+  ASSERT_EQ(0, missing.get_num_channels());
+  ASSERT_GE(absent.get_clock().now_nanos(), static_cast<uint64_t>(ADS114S08_TIMING::READY_TIMEOUT_NANOS));
+  ASSERT_LT(absent.get_clock().now_nanos(), ADS114S08_TIMING::READY_TIMEOUT_NANOS + 2 * ADS114S08_TIMING::READY_POLL_MAX_NANOS);
+}
+
+// With virtual time, what each transaction costs is exact: 8 SCLK periods per byte on the
+// wire, plus whatever delays the driver asks for
+TEST(DeviceDriverTests, test_virtual_time_latency)
+{
+  SpiEmulator  spi;
+  VirtualClock &clock = spi.get_clock();
+  DeviceDriver driver(spi, clock);
+  ASSERT_EQ(0u, clock.now_nanos());
+
+  driver.initialize();
+
+  const uint64_t byte_nanos = 8 * ADS114S08_TIMING::T_SCLK;
+
+  uint64_t start = clock.now_nanos();
+  (void)driver.read_register(ADS114S08_REGISTERS::DATARATE);
+  ASSERT_EQ(3 * byte_nanos, clock.now_nanos() - start);
+
+  uint8_t regs[DeviceDriver::NUM_REGISTERS];
+  start = clock.now_nanos();
+  driver.read_registers(0, DeviceDriver::NUM_REGISTERS, regs);
+  ASSERT_EQ((2 + DeviceDriver::NUM_REGISTERS) * byte_nanos, clock.now_nanos() - start);
+
+  start = clock.now_nanos();
+  (void)driver.read_adc_by_rdata_cmd();
+  ASSERT_EQ(3 * byte_nanos, clock.now_nanos() - start);
+
+  start = clock.now_nanos();
+  driver.reset();
+  ASSERT_EQ(byte_nanos + ADS114S08_TIMING::RESET_DELAY_NANOS, clock.now_nanos() - start);
+
+  // Long waits aren't cut short at 32 bits of nanoseconds
+  start = clock.now_nanos();
+  spi.advance_time(5000000000ull);
+  ASSERT_EQ(5000000000ull, clock.now_nanos() - start);
+}
+
+// Results come out when DATARATE and the PGA's conversion delay say they should: the delay plus
+// the filter's settling time after START, then one period apart, or one delay plus settling apart
+// with global chop, where the first result takes two of them. DRDY goes low with each result and
+// back high when it's read.
+TEST(DeviceDriverTests, test_conversion_timing)
+{
+  struct Case
+  {
+    uint8_t  datarate;
+    uint8_t  pga;
+    uint64_t first_nanos;
+    uint64_t period_nanos;
+  };
+  const Case cases[] = {
+      {0x14, 0x00, 50054687, 50000000}, // Low-latency, 20 SPS, 14 tMOD delay
+      {0x0d, 0x00, 804687, 250000},     // sinc3 settles in three periods
+      {0x1b, 0x60, 2000000, 1000000},   // 256 tMOD delay, a whole millisecond
+      {0x9b, 0x00, 2109374, 1054687},   // Global chop: every result pays for a restart
+  };
+
+  for (const Case &c : cases)
+  {
+    SpiEmulator  spi;
+    DeviceDriver driver(spi, spi.get_clock());
+    driver.initialize();
+    driver.write_register(ADS114S08_REGISTERS::DATARATE, c.datarate);
+    driver.write_register(ADS114S08_REGISTERS::PGA, c.pga);
+    ASSERT_EQ(c.first_nanos, driver.get_settling_nanos());
+
+    // START takes effect partway through start_conversions(), a little before it returns
+    driver.start_conversions();
+    spi.advance_time(c.first_nanos - 1000);
+    ASSERT_EQ(0u, spi.get_conversions());
+    ASSERT_FALSE(spi.is_drdy_low());
+    spi.advance_time(1000);
+    ASSERT_EQ(1u, spi.get_conversions());
+    ASSERT_TRUE(spi.is_drdy_low());
+
+    spi.advance_time(c.period_nanos - 2000);
+    ASSERT_EQ(1u, spi.get_conversions());
+    spi.advance_time(2000);
+    ASSERT_EQ(2u, spi.get_conversions());
+
+    (void)driver.read_adc_by_rdata_cmd();
+    ASSERT_FALSE(spi.is_drdy_low());
+    driver.stop_conversions();
+  }
+}
+
+// Single-shot: START converts once and the device goes back to standby. RDATA in standby gets
+// that conversion, not a fresh one, so a new input only shows up after another START and the
+// wait for it.
+TEST(DeviceDriverTests, test_single_shot_conversion)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::MODE | ADS114S08_DATARATE::FILTER | 0x0b);
+  driver.set_channel(3);
+
+  driver.start_conversions();
+  ASSERT_FALSE(driver.is_converting());
+  spi.advance_time(driver.get_settling_nanos());
+  ASSERT_EQ(1u, spi.get_conversions());
+  ASSERT_TRUE(spi.is_drdy_low());
+  spi.advance_time(10 * driver.get_settling_nanos());
+  ASSERT_EQ(1u, spi.get_conversions());
+  ASSERT_EQ(spi.get_raw_adc_test_val(3), driver.read_adc_by_rdata_cmd());
+  ASSERT_FALSE(spi.is_drdy_low());
+
+  driver.set_channel(7);
+  ASSERT_EQ(spi.get_raw_adc_test_val(3), driver.read_adc_by_rdata_cmd());
+  driver.start_conversions();
+  spi.advance_time(driver.get_settling_nanos());
+  ASSERT_EQ(2u, spi.get_conversions());
+  ASSERT_EQ(spi.get_raw_adc_test_val(7), driver.read_adc_by_rdata_cmd());
+
+  // The shortcut for tests converts on the spot
+  spi.set_timing_accurate(false);
+  driver.set_channel(9);
+  ASSERT_EQ(spi.get_raw_adc_test_val(9), driver.read_adc_by_rdata_cmd());
+  ASSERT_EQ(2u, spi.get_conversions());
+}
+
+// The app restarts but the ADC doesn't: a new driver finds the configuration the last one left,
+// and initialize() is one burst read plus a STOP, with no RESET and nothing written. Anything
+// different and it's a cold start that ends up holding the configuration all the same.
+TEST(DeviceDriverTests, test_warm_start_initialize)
+{
+  SpiEmulator   spi;
+  VirtualClock &clock = spi.get_clock();
+
+  std::array<uint8_t, DeviceDriver::NUM_REGISTERS> config;
+  std::copy(std::begin(ADS114S08_REGISTERS::RESET_VALUES), std::end(ADS114S08_REGISTERS::RESET_VALUES), config.begin());
+  config[ADS114S08_REGISTERS::INPMUX]   = 0x3c;
+  config[ADS114S08_REGISTERS::PGA]      = ADS114S08_PGA::PGA_EN | 2;
+  config[ADS114S08_REGISTERS::DATARATE] = ADS114S08_DATARATE::FILTER | 0x0d;
+  config[ADS114S08_REGISTERS::OFCAL0]   = 0x89;
+
+  {
+    DeviceDriver first(spi, clock);
+    ASSERT_TRUE(first.initialize(config));
+    ASSERT_FALSE(first.was_warm_start());
+    first.start_conversions();
+    clock.advance(10 * first.get_settling_nanos());
+  }
+
+  DeviceDriver   driver(spi, clock);
+  const uint64_t byte_nanos = 8 * ADS114S08_TIMING::T_SCLK;
+  uint64_t       start      = clock.now_nanos();
+  ASSERT_TRUE(driver.initialize(config));
+  ASSERT_TRUE(driver.was_warm_start());
+  ASSERT_EQ((2 + DeviceDriver::NUM_REGISTERS) * byte_nanos + byte_nanos, clock.now_nanos() - start);
+  ASSERT_FALSE(driver.is_converting());
+  uint32_t drdy_edges = 0;
+  spi.attach_drdy_isr([](void *edges) { ++*static_cast<uint32_t *>(edges); }, &drdy_edges);
+  clock.advance(10 * driver.get_settling_nanos());
+  ASSERT_EQ(0u, drdy_edges);
+  ASSERT_EQ(3, driver.get_active_channel());
+  ASSERT_EQ(0x89, driver.read_register(ADS114S08_REGISTERS::OFCAL0));
+  ASSERT_EQ(0, driver.read_register(ADS114S08_REGISTERS::STATUS) & ADS114S08_STATUS::FL_POR);
+
+  // Someone changed the gain in the meantime
+  driver.write_register(ADS114S08_REGISTERS::PGA, 0x00);
+  DeviceDriver changed(spi, clock);
+  start = clock.now_nanos();
+  ASSERT_TRUE(changed.initialize(config));
+  ASSERT_FALSE(changed.was_warm_start());
+  ASSERT_GT(clock.now_nanos() - start, static_cast<uint64_t>(ADS114S08_TIMING::RESET_DELAY_NANOS));
+  uint8_t regs[DeviceDriver::NUM_REGISTERS];
+  changed.read_registers(0, DeviceDriver::NUM_REGISTERS, regs);
+  for (uint8_t reg = ADS114S08_REGISTERS::INPMUX; reg < ADS114S08_REGISTERS::GPIODAT; ++reg)
+  {
+    ASSERT_EQ(config[reg], regs[reg]);
+  }
+  ASSERT_EQ(0, regs[ADS114S08_REGISTERS::STATUS] & ADS114S08_STATUS::FL_POR);
+}
+
+// Bit-at-a-time CRC-8-ATM straight from the polynomial, to check the table against
+static uint8_t crc8_reference(const uint8_t *data, size_t len)
+{
+  uint8_t crc = 0xff;
+  for (size_t n = 0; n < len; ++n)
+  {
+    crc ^= data[n];
+    for (uint8_t bit = 0; bit < 8; ++bit)
+    {
+      crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// The table-driven CRC matches the bitwise one for every frame shape the device sends, a frame
+// with its CRC appended checks out, and a block check finds exactly the frames that were damaged
+TEST(DeviceDriverTests, test_crc8)
+{
+  uint8_t frame[4];
+  for (uint32_t n = 0; n < 0x10000; n += 7)
+  {
+    frame[0] = static_cast<uint8_t>(n * 13);
+    frame[1] = n >> 8;
+    frame[2] = n & 0xff;
+    ASSERT_EQ(crc8_reference(frame + 1, 2), ADS114S08_CRC::crc8(frame + 1, 2));
+    ASSERT_EQ(crc8_reference(frame, 3), ADS114S08_CRC::crc8(frame, 3));
+
+    frame[3] = ADS114S08_CRC::crc8(frame, 3);
+    ASSERT_TRUE(ADS114S08_CRC::check_frame(frame, 4));
+    frame[n % 4] ^= 0x01 << (n % 8);
+    ASSERT_FALSE(ADS114S08_CRC::check_frame(frame, 4));
+  }
+
+  // 103 three-byte frames (not a multiple of four, so the tail gets checked too)
+  static const size_t NUM_FRAMES = 103;
+  uint8_t             frames[NUM_FRAMES * 3];
+  for (size_t n = 0; n < NUM_FRAMES; ++n)
+  {
+    frames[3 * n]     = static_cast<uint8_t>(n * 37);
+    frames[3 * n + 1] = static_cast<uint8_t>(n);
+    frames[3 * n + 2] = ADS114S08_CRC::crc8(frames + 3 * n, 2);
+  }
+  bool failed[NUM_FRAMES];
+  ASSERT_EQ(0u, ADS114S08_CRC::check_frames(frames, 3, NUM_FRAMES, failed));
+
+  const size_t damaged[] = {0, 5, 50, 101, 102};
+  for (size_t n : damaged)
+  {
+    frames[3 * n + 1] ^= 0x40;
+  }
+  ASSERT_EQ(sizeof(damaged) / sizeof(damaged[0]), ADS114S08_CRC::check_frames(frames, 3, NUM_FRAMES, failed));
+  size_t next = 0;
+  for (size_t n = 0; n < NUM_FRAMES; ++n)
+  {
+    const bool expected = (next < sizeof(damaged) / sizeof(damaged[0])) && (damaged[next] == n);
+    ASSERT_EQ(expected, failed[n]);
+    next += expected;
+  }
+}
+
+// Passes everything through to the emulator, but can flip a bit in what comes back
+class CorruptingSpi : public ISpiInterface
+{
+  public:
+    CorruptingSpi(ISpiInterface &inner) : inner(inner), corrupt_next(false) {}
+
+    virtual void    init(uint8_t SPI_mode) override { inner.init(SPI_mode); }
+    virtual uint8_t transfer(uint8_t data) override { return inner.transfer(data); }
+    virtual void    write(uint8_t data) override { inner.write(data); }
+    virtual uint8_t read(void) override { return inner.read(); }
+    virtual void    transfer(const uint8_t *tx, uint8_t *rx, size_t len) override
+    {
+      inner.transfer(tx, rx, len);
+      if (corrupt_next && rx)
+      {
+        rx[len - 2] ^= 0x10;
+        corrupt_next = false;
+      }
+    }
+
+    ISpiInterface &inner;
+    bool           corrupt_next;
+};
+
+// Every combination of SENDSTAT and CRC in SYS: RDATA, direct reads on DRDY and the pipelined
+// switch-and-read all come back with the right frame length, value and STATUS byte, and a frame
+// damaged on the way is counted and kept out of the sample ring
+TEST(DeviceDriverTests, test_status_and_crc)
+{
+  SpiEmulator   spi;
+  CorruptingSpi bus(spi);
+  VirtualClock &clock = spi.get_clock();
+  DeviceDriver  driver(bus, clock);
+  driver.initialize();
+  // Standby reads convert on the spot, so each frame shape can be checked against the input
+  spi.set_timing_accurate(false);
+
+  const uint8_t  channel    = 3;
+  const uint64_t byte_nanos = 8 * ADS114S08_TIMING::T_SCLK;
+  const uint32_t period     = ADS114S08_DATARATE::PERIOD_NANOS[0x14 & ADS114S08_DATARATE::DR_MASK];
+  spi.attach_drdy_isr(DeviceDriver::adc_ready_isr, &driver);
+
+  for (uint8_t flags = 0; flags < 4; ++flags)
+  {
+    const uint8_t sys = ADS114S08_REGISTERS::RESET_VALUES[ADS114S08_REGISTERS::SYS] | flags;
+    driver.write_register(ADS114S08_REGISTERS::SYS, sys);
+    driver.write_register(ADS114S08_REGISTERS::STATUS, 0x00);
+    driver.set_channel(channel);
+
+    const uint8_t frame_bytes = 2 + ((flags & ADS114S08_SYS::SENDSTAT) ? 1 : 0) + ((flags & ADS114S08_SYS::CRC) ? 1 : 0);
+    ASSERT_EQ(frame_bytes, driver.get_data_frame_bytes());
+
+    uint16_t       value = 0;
+    const uint64_t start = clock.now_nanos();
+    ASSERT_TRUE(driver.read_adc_by_rdata_cmd(value));
+    ASSERT_EQ((1 + frame_bytes) * byte_nanos, clock.now_nanos() - start);
+    ASSERT_EQ(spi.get_raw_adc_test_val(channel), value);
+    ASSERT_EQ(spi.get_raw_adc_test_val(channel), driver.switch_channel_and_read(channel));
+    if (flags & ADS114S08_SYS::SENDSTAT)
+    {
+      // RDY and FL_POR are both clear once the device is up and the flag has been acknowledged
+      ASSERT_EQ(0x00, driver.get_last_status());
+    }
+
+    driver.start_conversions();
+    spi.advance_time(driver.get_settling_nanos() + 3 * period);
+    driver.stop_conversions();
+
+    uint16_t samples[8];
+    ASSERT_EQ(4u, driver.read_samples(samples, 8));
+    for (uint8_t n = 0; n < 4; ++n)
+    {
+      ASSERT_EQ(spi.get_raw_adc_test_val(channel), samples[n]);
+    }
+  }
+  ASSERT_EQ(0u, driver.get_crc_errors());
+
+  // SYS still has both bits set
+  bus.corrupt_next = true;
+  uint16_t value   = 0;
+  ASSERT_FALSE(driver.read_adc_by_rdata_cmd(value));
+  ASSERT_EQ(1u, driver.get_crc_errors());
+  ASSERT_TRUE(driver.switch_channel_and_read(channel, value));
+  ASSERT_EQ(spi.get_raw_adc_test_val(channel), value);
+  bus.corrupt_next = true;
+  ASSERT_FALSE(driver.switch_channel_and_read(channel, ADS114S08_INPMUX::AINCOM, value));
+  ASSERT_EQ(2u, driver.get_crc_errors());
+
+  driver.start_conversions();
+  spi.advance_time(driver.get_settling_nanos());
+  ASSERT_EQ(1u, driver.get_queued_samples());
+  bus.corrupt_next = true;
+  spi.advance_time(period);
+  ASSERT_EQ(1u, driver.get_queued_samples());
+  ASSERT_EQ(3u, driver.get_crc_errors());
+  spi.advance_time(period);
+  ASSERT_EQ(2u, driver.get_queued_samples());
+  driver.stop_conversions();
+
+  // Without CRC there's nothing to catch it
+  driver.write_register(ADS114S08_REGISTERS::SYS, ADS114S08_REGISTERS::RESET_VALUES[ADS114S08_REGISTERS::SYS]);
+  bus.corrupt_next = true;
+  ASSERT_TRUE(driver.read_adc_by_rdata_cmd(value));
+  ASSERT_NE(spi.get_raw_adc_test_val(channel), value);
+  ASSERT_EQ(3u, driver.get_crc_errors());
+}
+
+// A bus policy that isn't an ISpiInterface at all: BasicDeviceDriver only needs these three
+struct DirectBus
+{
+    SpiEmulator &spi;
+
+    void init(uint8_t SPI_mode) { spi.init(SPI_mode); }
+    void write(uint8_t data) { spi.write(data); }
+    void transfer(const uint8_t *tx, uint8_t *rx, size_t len) { spi.transfer(tx, rx, len); }
+};
+
+static_assert(BasicDeviceDriver<ADS114S08_Traits, DirectBus>::is_valid_input(11), "AIN11 exists on an ADS114S08");
+static_assert(!BasicDeviceDriver<ADS114S06_Traits, DirectBus>::is_valid_input(6), "AIN6 doesn't on an ADS114S06");
+static_assert(BasicDeviceDriver<ADS114S06_Traits, DirectBus>::is_valid_input(0x0c), "AINCOM is on both");
+static_assert(!DeviceDriver::is_valid_input(0x0d), "Reserved mux code");
+
+// Drivers specialized at compile time behave exactly like DeviceDriver: correct readings, and the
+// same register traffic in the same simulated time. Built for the wrong device, initialize() says so.
+TEST(DeviceDriverTests, test_static_specialization)
+{
+  SpiEmulator  erased_spi;
+  DeviceDriver erased(erased_spi, erased_spi.get_clock());
+  ASSERT_TRUE(erased.initialize());
+  ASSERT_EQ(12, erased.get_num_channels());
+
+  SpiEmulator                                     spi;
+  BasicDeviceDriver<ADS114S08_Traits, SpiEmulator> driver(spi, spi.get_clock());
+  ASSERT_TRUE(driver.initialize());
+  // Both read inputs in standby, converted on the spot
+  erased_spi.set_timing_accurate(false);
+  spi.set_timing_accurate(false);
+  ASSERT_EQ(12, driver.get_num_channels());
+  ASSERT_EQ(ADS114S08_Traits::DEVICE_ID, driver.get_device_id());
+  ASSERT_EQ(erased_spi.get_clock().now_nanos(), spi.get_clock().now_nanos());
+
+  for (uint8_t ch = 0; ch < 12; ++ch)
+  {
+    erased.set_channel(ch);
+    driver.set_channel(ch);
+    ASSERT_EQ(spi.get_raw_adc_test_val(ch), driver.read_adc_by_rdata_cmd());
+    ASSERT_EQ(erased_spi.get_raw_adc_test_val(ch), erased.read_adc_by_rdata_cmd());
+  }
+  ASSERT_EQ(erased_spi.get_clock().now_nanos(), spi.get_clock().now_nanos());
+  driver.set_channel<7>();
+  ASSERT_EQ(0x7c, driver.get_cached_register(ADS114S08_REGISTERS::INPMUX));
+  ASSERT_EQ(spi.get_raw_adc_test_val(7), driver.read_adc_by_rdata_cmd());
+
+  driver.write_register(ADS114S08_REGISTERS::PGA, 0x0a);
+  ASSERT_EQ(0x0a, driver.read_register(ADS114S08_REGISTERS::PGA));
+
+  // Through a bus policy with no virtual functions
+  SpiEmulator                                    direct_spi;
+  DirectBus                                      bus{direct_spi};
+  BasicDeviceDriver<ADS114S08_Traits, DirectBus> direct(bus, direct_spi.get_clock());
+  ASSERT_TRUE(direct.initialize());
+  direct_spi.set_timing_accurate(false);
+  direct.set_channel<3, 0x0c>();
+  ASSERT_EQ(direct_spi.get_raw_adc_test_val(3), direct.read_adc_by_rdata_cmd());
+
+  // A driver built for the ADS114S06 turns away inputs only the ADS114S08 has, at run time too,
+  // and leaves the mux where it was
+  SpiEmulator s06_spi;
+  s06_spi.set_device_id(ADS114S06_Traits::DEVICE_ID);
+  BasicDeviceDriver<ADS114S06_Traits, SpiEmulator> s06(s06_spi, s06_spi.get_clock());
+  ASSERT_FALSE(s06.set_channel(0));
+  ASSERT_TRUE(s06.initialize());
+  ASSERT_TRUE(s06.set_channel(5, 0x0c));
+  ASSERT_FALSE(s06.set_channel(6));
+  ASSERT_FALSE(s06.set_channel(0, 11));
+  ASSERT_EQ(0x5c, s06.get_cached_register(ADS114S08_REGISTERS::INPMUX));
+  ASSERT_EQ(0, s06.switch_channel_and_read(9));
+  ASSERT_EQ(0x5c, s06.read_register(ADS114S08_REGISTERS::INPMUX));
+  ASSERT_FALSE(erased.set_channel(0x0d));
+  ASSERT_FALSE(erased.set_channel(0, 0x0f));
+
+  // DeviceDriver covers both, and goes by the part initialize() found
+  SpiEmulator  erased_s06_spi;
+  DeviceDriver erased_s06(erased_s06_spi, erased_s06_spi.get_clock());
+  erased_s06_spi.set_device_id(ADS114S06_Traits::DEVICE_ID);
+  ASSERT_FALSE(erased_s06.has_input(0));
+  ASSERT_TRUE(erased_s06.has_input(ADS114S08_INPMUX::AINCOM));
+  ASSERT_TRUE(erased_s06.initialize());
+  ASSERT_EQ(6, erased_s06.get_num_channels());
+  ASSERT_TRUE(DeviceDriver::is_valid_input(6));
+  ASSERT_TRUE(erased_s06.has_input(5));
+  ASSERT_FALSE(erased_s06.has_input(6));
+  ASSERT_FALSE(erased_s06.has_input(11));
+  ASSERT_TRUE(erased_s06.set_channel(5, 4));
+  ASSERT_FALSE(erased_s06.set_channel(6));
+  ASSERT_FALSE(erased_s06.set_channel(0, 11));
+  ASSERT_EQ(0, erased_s06.switch_channel_and_read(9));
+  ASSERT_EQ(0x54, erased_s06.read_register(ADS114S08_REGISTERS::INPMUX));
+  ASSERT_TRUE(erased.has_input(11));
+
+  // The emulator is an ADS114S08, so a driver built for the ADS114S06 refuses it, and leaves
+  // its configuration alone rather than resetting a part it doesn't know
+  SpiEmulator                                      wrong_spi;
+  DeviceDriver                                     right(wrong_spi, wrong_spi.get_clock());
+  BasicDeviceDriver<ADS114S06_Traits, SpiEmulator> wrong(wrong_spi, wrong_spi.get_clock());
+  ASSERT_TRUE(right.initialize());
+  right.write_register(ADS114S08_REGISTERS::PGA, 0x0a);
+  ASSERT_FALSE(wrong.initialize());
+  ASSERT_EQ(0, wrong.get_num_channels());
+  ASSERT_EQ(ADS114S08_Traits::DEVICE_ID, wrong.get_device_id());
+  ASSERT_EQ(0x0a, right.read_register(ADS114S08_REGISTERS::PGA));
+}
+
+// Checks volts per code for each reference and gain, that the coefficient is only recomputed when
+// PGA or REF change, and that block conversion matches converting one sample at a time
+TEST(DeviceDriverTests, test_unit_conversion)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+
+  // Reset: PGA bypassed, REFP0 - REFN0
+  UnitConverter converter(3.3, 1.25);
+  ASSERT_TRUE(converter.update(driver));
+  ASSERT_FALSE(converter.update(driver));
+  ASSERT_EQ(1, converter.get_gain());
+  ASSERT_DOUBLE_EQ(3.3, converter.get_reference_volts());
+  ASSERT_FLOAT_EQ(3.3f, converter.to_volts(0x7fff) * 32768.0f / 32767.0f);
+  ASSERT_FLOAT_EQ(-3.3f, converter.to_volts(0x8000));
+  ASSERT_FLOAT_EQ(0.0f, converter.to_volts(0x0000));
+  ASSERT_FLOAT_EQ(-3.3e6f / 32768.0f, converter.to_microvolts(0xffff));
+
+  // GAIN only counts with the PGA enabled
+  driver.write_register(ADS114S08_REGISTERS::PGA, 0x05);
+  ASSERT_TRUE(converter.update(driver));
+  ASSERT_EQ(1, converter.get_gain());
+
+  const uint8_t refsel[] = {ADS114S08_REF::REFSEL_REF0, ADS114S08_REF::REFSEL_REF1, ADS114S08_REF::REFSEL_INT};
+  const double  vref[]   = {3.3, 1.25, 2.5};
+  for (uint8_t r = 0; r < 3; ++r)
+  {
+    for (uint8_t g = 0; g < 8; ++g)
+    {
+      driver.write_register(ADS114S08_REGISTERS::PGA, ADS114S08_PGA::PGA_EN | g);
+      driver.write_register(ADS114S08_REGISTERS::REF, 0x10 | refsel[r]);
+      ASSERT_TRUE(converter.update(driver));
+      ASSERT_EQ(1 << g, converter.get_gain());
+      ASSERT_FLOAT_EQ(static_cast<float>(vref[r] / (32768.0 * (1 << g))), converter.get_volts_per_code());
+    }
+  }
+
+  // Fields that don't scale the result don't count as a change, but the board's reference
+  // voltage does
+  ASSERT_FALSE(converter.update(driver));
+  driver.write_register(ADS114S08_REGISTERS::PGA, 0xe0 | ADS114S08_PGA::PGA_EN | 7);
+  driver.write_register(ADS114S08_REGISTERS::REF, 0x30 | ADS114S08_REF::REFSEL_INT);
+  ASSERT_FALSE(converter.update(driver));
+  converter.set_external_reference(1, 1.2);
+  driver.write_register(ADS114S08_REGISTERS::REF, 0x10 | ADS114S08_REF::REFSEL_REF1);
+  ASSERT_TRUE(converter.update(driver));
+  ASSERT_DOUBLE_EQ(1.2, converter.get_reference_volts());
+
+  uint16_t codes[37];
+  float    volts[37];
+  float    microvolts[37];
+  for (uint16_t n = 0; n < 37; ++n)
+  {
+    codes[n] = static_cast<uint16_t>(n * 1789);
+  }
+  converter.to_volts(codes, volts, 37);
+  converter.to_microvolts(codes, microvolts, 37);
+  for (uint16_t n = 0; n < 37; ++n)
+  {
+    ASSERT_FLOAT_EQ(converter.to_volts(codes[n]), volts[n]);
+    ASSERT_FLOAT_EQ(converter.to_microvolts(codes[n]), microvolts[n]);
+    ASSERT_NEAR(static_cast<int16_t>(codes[n]) * 1.2e6 / (32768.0 * 128), microvolts[n], 1e-3);
+  }
+
+  // Reserved REFSEL: no reference to speak of
+  converter.update(0x00, ADS114S08_REF::REFSEL_MASK);
+  ASSERT_TRUE(std::isnan(converter.to_volts(0x1234)));
+}
@@ -0,0 +1,266 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "adc_constants.h"
+#include "device_driver.h"
+#include "sample_filter.h"
+#include "scan_sequencer.h"
+#include "spi_emulator.h"
+
+// Frame f, channel ch of a test stream: a different ramp per channel
+static float ramp(size_t f, size_t ch)
+{
+  return static_cast<float>(ch * 1000) + static_cast<float>(f) * static_cast<float>(ch + 1);
+}
+
+static std::vector<float> ramps(size_t num_frames, size_t num_channels)
+{
+  std::vector<float> block(num_frames * num_channels);
+  for (size_t f = 0; f < num_frames; ++f)
+  {
+    for (size_t ch = 0; ch < num_channels; ++ch)
+    {
+      block[f * num_channels + ch] = ramp(f, ch);
+    }
+  }
+  return block;
+}
+
+// Boxcar and moving averages of ramps, checked against the sums worked out directly. A decimator
+// split across blocks that aren't a multiple of its factor gives the same frames as one block.
+TEST(SampleFilterTests, test_averages)
+{
+  const size_t             CHANNELS = 5;
+  const std::vector<float> in       = ramps(40, CHANNELS);
+
+  BoxcarDecimator boxcar;
+  ASSERT_EQ(0u, boxcar.get_num_channels());
+  ASSERT_FALSE(boxcar.configure(0, 4));
+  ASSERT_FALSE(boxcar.configure(ISampleFilter::MAX_CHANNELS + 1, 4));
+  ASSERT_FALSE(boxcar.configure(CHANNELS, 0));
+  ASSERT_TRUE(boxcar.configure(CHANNELS, 4));
+  ASSERT_EQ(4u, boxcar.get_decimation());
+
+  std::vector<float> out(in.size());
+  ASSERT_EQ(10u, boxcar.process(in.data(), 40, out.data()));
+  for (size_t f = 0; f < 10; ++f)
+  {
+    for (size_t ch = 0; ch < CHANNELS; ++ch)
+    {
+      const float mean = (ramp(4 * f, ch) + ramp(4 * f + 1, ch) + ramp(4 * f + 2, ch) + ramp(4 * f + 3, ch)) / 4;
+      ASSERT_FLOAT_EQ(mean, out[f * CHANNELS + ch]);
+    }
+  }
+
+  std::vector<float> split(in.size());
+  boxcar.reset();
+  size_t produced = boxcar.process(in.data(), 7, split.data());
+  produced += boxcar.process(in.data() + 7 * CHANNELS, 22, split.data() + produced * CHANNELS);
+  produced += boxcar.process(in.data() + 29 * CHANNELS, 11, split.data() + produced * CHANNELS);
+  ASSERT_EQ(10u, produced);
+  for (size_t n = 0; n < 10 * CHANNELS; ++n)
+  {
+    ASSERT_FLOAT_EQ(out[n], split[n]);
+  }
+
+  // In place, and primed with the first frame so the output starts where the input does
+  MovingAverage average;
+  ASSERT_FALSE(average.configure(CHANNELS, MovingAverage::MAX_WINDOW + 1));
+  ASSERT_TRUE(average.configure(CHANNELS, 3));
+  std::vector<float> samples = in;
+  ASSERT_EQ(40u, average.process(samples.data(), 40, samples.data()));
+  for (size_t ch = 0; ch < CHANNELS; ++ch)
+  {
+    ASSERT_FLOAT_EQ(ramp(0, ch), samples[ch]);
+    ASSERT_FLOAT_EQ((2 * ramp(0, ch) + ramp(1, ch)) / 3, samples[CHANNELS + ch]);
+  }
+  for (size_t f = 2; f < 40; ++f)
+  {
+    for (size_t ch = 0; ch < CHANNELS; ++ch)
+    {
+      ASSERT_FLOAT_EQ(ramp(f - 1, ch), samples[f * CHANNELS + ch]);
+    }
+  }
+}
+
+// A CIC passes a steady level once it has settled and matches a boxcar at order 1. Its
+// integrators wrap on a long full-scale run at the biggest gain allowed, and the output doesn't
+// notice.
+TEST(SampleFilterTests, test_cic_decimator)
+{
+  const size_t CHANNELS = 3;
+  CicDecimator cic;
+  ASSERT_FALSE(cic.configure(CHANNELS, 1, 3));
+  ASSERT_FALSE(cic.configure(CHANNELS, 16, CicDecimator::MAX_ORDER + 1));
+  ASSERT_FALSE(cic.configure(CHANNELS, 512, 5));
+  ASSERT_TRUE(cic.configure(CHANNELS, 256, 5));
+  ASSERT_EQ(256u, cic.get_decimation());
+  ASSERT_EQ(5u, cic.get_order());
+
+  const float        levels[CHANNELS] = {32767.0f, -32768.0f, 1234.5f};
+  std::vector<float> block(1024 * CHANNELS);
+  for (size_t f = 0; f < 1024; ++f)
+  {
+    for (size_t ch = 0; ch < CHANNELS; ++ch)
+    {
+      block[f * CHANNELS + ch] = levels[ch];
+    }
+  }
+  std::vector<float> out(block.size());
+  for (size_t pass = 0; pass < 64; ++pass)
+  {
+    ASSERT_EQ(4u, cic.process(block.data(), 1024, out.data()));
+    if (pass >= 2)
+    {
+      for (size_t f = 0; f < 4; ++f)
+      {
+        for (size_t ch = 0; ch < CHANNELS; ++ch)
+        {
+          ASSERT_FLOAT_EQ(levels[ch], out[f * CHANNELS + ch]);
+        }
+      }
+    }
+  }
+
+  const std::vector<float> in = ramps(64, CHANNELS);
+  BoxcarDecimator          boxcar;
+  std::vector<float>       expected(in.size());
+  ASSERT_TRUE(boxcar.configure(CHANNELS, 8));
+  ASSERT_TRUE(cic.configure(CHANNELS, 8, 1));
+  ASSERT_EQ(8u, boxcar.process(in.data(), 64, expected.data()));
+  ASSERT_EQ(8u, cic.process(in.data(), 64, out.data()));
+  for (size_t n = 0; n < 8 * CHANNELS; ++n)
+  {
+    ASSERT_FLOAT_EQ(expected[n], out[n]);
+  }
+}
+
+// An impulse brings the taps back out on every channel; with decimation only every nth output is
+// kept. The taps are the filter's own copy.
+TEST(SampleFilterTests, test_fir_filter)
+{
+  const size_t CHANNELS = 4;
+  float        taps[]   = {0.5f, 0.25f, -0.125f, 2.0f};
+  FirFilter    fir;
+  ASSERT_FALSE(fir.configure(CHANNELS, taps, 0));
+  ASSERT_FALSE(fir.configure(CHANNELS, taps, FirFilter::MAX_TAPS + 1));
+  ASSERT_FALSE(fir.configure(CHANNELS, nullptr, 4));
+  ASSERT_TRUE(fir.configure(CHANNELS, taps, 4));
+  taps[0] = 100.0f;
+
+  std::vector<float> block(8 * CHANNELS, 0.0f);
+  for (size_t ch = 0; ch < CHANNELS; ++ch)
+  {
+    block[ch] = static_cast<float>(ch + 1);
+  }
+  ASSERT_EQ(8u, fir.process(block.data(), 8, block.data()));
+  const float response[] = {0.5f, 0.25f, -0.125f, 2.0f, 0, 0, 0, 0};
+  for (size_t f = 0; f < 8; ++f)
+  {
+    for (size_t ch = 0; ch < CHANNELS; ++ch)
+    {
+      ASSERT_FLOAT_EQ(response[f] * static_cast<float>(ch + 1), block[f * CHANNELS + ch]);
+    }
+  }
+
+  // Two-tap difference, every third output
+  const float              diff[] = {1.0f, -1.0f};
+  const std::vector<float> in     = ramps(12, CHANNELS);
+  std::vector<float>       out(in.size());
+  ASSERT_TRUE(fir.configure(CHANNELS, diff, 2, 3));
+  ASSERT_EQ(3u, fir.get_decimation());
+  ASSERT_EQ(4u, fir.process(in.data(), 12, out.data()));
+  for (size_t f = 0; f < 4; ++f)
+  {
+    for (size_t ch = 0; ch < CHANNELS; ++ch)
+    {
+      ASSERT_FLOAT_EQ(ramp(3 * f + 2, ch) - ramp(3 * f + 1, ch), out[f * CHANNELS + ch]);
+    }
+  }
+}
+
+// Spikes up to two in a window vanish; a step gets through once it outlasts half the window.
+// Channels don't see each other's samples.
+TEST(SampleFilterTests, test_median_filter)
+{
+  const size_t CHANNELS = 9;
+  MedianFilter median;
+  ASSERT_FALSE(median.configure(CHANNELS, 4));
+  ASSERT_FALSE(median.configure(CHANNELS, MedianFilter::MAX_WINDOW + 2));
+  ASSERT_TRUE(median.configure(CHANNELS, 5));
+
+  std::vector<float> block(20 * CHANNELS);
+  for (size_t f = 0; f < 20; ++f)
+  {
+    for (size_t ch = 0; ch < CHANNELS; ++ch)
+    {
+      float value = static_cast<float>(ch) + ((f >= 10) ? 100.0f : 0.0f);
+      if (((f % 4) == ch % 4) && (f > 0) && ((f < 6) || (f > 15)))
+      {
+        value += (ch & 1) ? 30000.0f : -30000.0f;
+      }
+      block[f * CHANNELS + ch] = value;
+    }
+  }
+  ASSERT_EQ(20u, median.process(block.data(), 20, block.data()));
+  for (size_t f = 0; f < 20; ++f)
+  {
+    for (size_t ch = 0; ch < CHANNELS; ++ch)
+    {
+      const float expected = static_cast<float>(ch) + ((f >= 12) ? 100.0f : 0.0f);
+      ASSERT_FLOAT_EQ(expected, block[f * CHANNELS + ch]) << "frame " << f << " channel " << ch;
+    }
+  }
+}
+
+// Twelve channels scanned off the emulated ADC straight into a median and a CIC: every filtered
+// frame is each channel's input. Stages with a different channel count are turned away.
+TEST(SampleFilterTests, test_pipeline_on_scans)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::FILTER | 0x0d);
+
+  MuxPair list[12];
+  for (uint8_t ch = 0; ch < 12; ++ch)
+  {
+    list[ch] = {ch, ADS114S08_INPMUX::AINCOM};
+  }
+  ScanSequencer sequencer(driver);
+  ASSERT_TRUE(sequencer.set_scan_list(list, 12));
+
+  MedianFilter   median;
+  CicDecimator   cic;
+  MovingAverage  other;
+  MovingAverage  unconfigured;
+  FilterPipeline pipeline;
+  ASSERT_TRUE(median.configure(12, 3));
+  ASSERT_TRUE(cic.configure(12, 4, 2));
+  ASSERT_TRUE(other.configure(6, 2));
+  ASSERT_FALSE(pipeline.add_stage(unconfigured));
+  ASSERT_TRUE(pipeline.add_stage(median));
+  ASSERT_TRUE(pipeline.add_stage(cic));
+  ASSERT_FALSE(pipeline.add_stage(other));
+  ASSERT_EQ(2u, pipeline.get_num_stages());
+  ASSERT_EQ(12u, pipeline.get_num_channels());
+  ASSERT_EQ(4u, pipeline.get_decimation());
+
+  const size_t NUM_SCANS = 32;
+  uint16_t     codes[NUM_SCANS * 12];
+  float        filtered[NUM_SCANS * 12];
+  ASSERT_EQ(NUM_SCANS * 12, sequencer.run(codes, NUM_SCANS));
+  ASSERT_EQ(NUM_SCANS / 4, pipeline.process(codes, NUM_SCANS, filtered));
+
+  // The CIC's first output is still filling its combs
+  for (size_t f = 1; f < NUM_SCANS / 4; ++f)
+  {
+    for (uint8_t ch = 0; ch < 12; ++ch)
+    {
+      ASSERT_FLOAT_EQ(static_cast<int16_t>(spi.get_raw_adc_test_val(ch)), filtered[f * 12 + ch]);
+    }
+  }
+
+  FilterPipeline empty;
+  ASSERT_EQ(0u, empty.process(codes, NUM_SCANS, filtered));
+}
@@ -0,0 +1,333 @@
+#include <gtest/gtest.h>
+
+#include "adc_constants.h"
+#include "bus_scan_sequencer.h"
+#include "device_driver.h"
+#include "scan_sequencer.h"
+#include "spi_bus.h"
+#include "spi_emulator.h"
+
+// Fastest data rate with the low-latency filter: one conversion period to settle
+static const uint8_t  FAST_DATARATE = ADS114S08_DATARATE::FILTER | 0x0d;
+static const uint64_t FAST_PERIOD   = ADS114S08_DATARATE::PERIOD_NANOS[0x0d];
+
+// Mux changes while converting don't show up in RDATA until the restarted conversion has
+// settled: right after the switch, RDATA still returns the result from the old input.
+TEST(ScanSequencerTests, test_mux_change_latency)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+
+  driver.set_channel(2);
+  driver.start_conversions();
+  spi.advance_time(driver.get_settling_nanos());
+  ASSERT_EQ(spi.get_raw_adc_test_val(2), driver.read_adc_by_rdata_cmd());
+
+  driver.set_channel(9);
+  ASSERT_EQ(spi.get_raw_adc_test_val(2), driver.read_adc_by_rdata_cmd());
+
+  spi.advance_time(driver.get_settling_nanos());
+  ASSERT_EQ(spi.get_raw_adc_test_val(9), driver.read_adc_by_rdata_cmd());
+}
+
+// Every scan list entry gets its own input's reading, in scan list order, and the scan costs
+// one settling time per entry - not one settling time plus a separate mux write per entry.
+TEST(ScanSequencerTests, test_scan_results)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+
+  ScanSequencer sequencer(driver);
+  const MuxPair list[] = {{4, 0x0c}, {0, 0x0c}, {11, 0x0c}, {7, 0x0c}, {4, 0x0c}};
+  ASSERT_TRUE(sequencer.set_scan_list(list, 5));
+  ASSERT_EQ(5u, sequencer.get_scan_length());
+
+  uint16_t       results[5] = {0};
+  const uint64_t t0         = spi.get_clock().now_nanos();
+  sequencer.scan(results);
+  const uint64_t elapsed = spi.get_clock().now_nanos() - t0;
+
+  for (size_t n = 0; n < 5; ++n)
+  {
+    ASSERT_EQ(spi.get_raw_adc_test_val(list[n].ch_plus), results[n]);
+  }
+  ASSERT_GE(elapsed, 5 * driver.get_settling_nanos());
+  ASSERT_LT(elapsed, 6 * driver.get_settling_nanos());
+  ASSERT_TRUE(driver.is_converting());
+
+  // Rejects empty and oversized lists, and reserved mux codes, without touching the current one
+  MuxPair too_long[ScanSequencer::MAX_SCAN_LENGTH + 1] = {};
+  ASSERT_FALSE(sequencer.set_scan_list(too_long, ScanSequencer::MAX_SCAN_LENGTH + 1));
+  ASSERT_FALSE(sequencer.set_scan_list(list, 0));
+  const MuxPair reserved[] = {{0, 0x0c}, {0x0d, 0x0c}};
+  ASSERT_FALSE(sequencer.set_scan_list(reserved, 2));
+  ASSERT_EQ(5u, sequencer.get_scan_length());
+}
+
+// With the sinc3 filter a restarted conversion takes three periods (plus the start delay) to
+// settle. Readings must still come from the right inputs, they just take longer.
+TEST(ScanSequencerTests, test_scan_sinc3)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, 0x0d);
+  ASSERT_EQ(3 * FAST_PERIOD + ADS114S08_PGA::delay_nanos(0x00), driver.get_settling_nanos());
+
+  ScanSequencer sequencer(driver);
+  const MuxPair list[] = {{1, 0x0c}, {10, 0x0c}, {3, 0x0c}};
+  ASSERT_TRUE(sequencer.set_scan_list(list, 3));
+
+  uint16_t       results[3] = {0};
+  const uint64_t t0         = spi.get_clock().now_nanos();
+  sequencer.scan(results);
+  ASSERT_GE(spi.get_clock().now_nanos() - t0, 9 * FAST_PERIOD);
+
+  for (size_t n = 0; n < 3; ++n)
+  {
+    ASSERT_EQ(spi.get_raw_adc_test_val(list[n].ch_plus), results[n]);
+  }
+}
+
+// Repeated scans land contiguously in the results buffer and start on the scan period. A
+// period shorter than a pass can't be kept up with, and every late pass counts as an overrun.
+TEST(ScanSequencerTests, test_run_pacing)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+
+  ScanSequencer sequencer(driver);
+  const MuxPair list[] = {{0, 0x0c}, {5, 0x0c}, {8, 0x0c}, {2, 0x0c}};
+  ASSERT_TRUE(sequencer.set_scan_list(list, 4));
+
+  const size_t   NUM_SCANS   = 6;
+  const uint64_t scan_period = 10 * FAST_PERIOD;
+  uint16_t       results[NUM_SCANS * 4] = {0};
+
+  const uint64_t t0 = spi.get_clock().now_nanos();
+  ASSERT_EQ(NUM_SCANS * 4, sequencer.run(results, NUM_SCANS, scan_period));
+  const uint64_t elapsed = spi.get_clock().now_nanos() - t0;
+
+  ASSERT_GE(elapsed, (NUM_SCANS - 1) * scan_period);
+  ASSERT_LT(elapsed, NUM_SCANS * scan_period);
+  ASSERT_EQ(0u, sequencer.get_overruns());
+
+  for (size_t k = 0; k < NUM_SCANS * 4; ++k)
+  {
+    ASSERT_EQ(spi.get_raw_adc_test_val(list[k % 4].ch_plus), results[k]);
+  }
+
+  ASSERT_EQ(NUM_SCANS * 4, sequencer.run(results, NUM_SCANS, FAST_PERIOD));
+  ASSERT_EQ(NUM_SCANS - 1, sequencer.get_overruns());
+}
+
+// Differential pairs read as positive minus negative input in two's complement, clipping at full
+// scale; AINCOM reads zero and a reserved mux code gives zero. A scan of pairs packs the signed
+// readings one per entry.
+TEST(ScanSequencerTests, test_differential_scan)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+
+  // Levels are codes, so negative ones go in as their two's complement bit patterns
+  const int16_t levels[] = {1000, 3000, -20000, 30000};
+  for (uint8_t ch = 0; ch < 4; ++ch)
+  {
+    spi.get_signals().set_dc(ch, static_cast<uint16_t>(levels[ch]));
+  }
+
+  // One conversion at a time in standby, converted on the spot, including the mux codes a scan
+  // list won't take
+  spi.set_timing_accurate(false);
+  struct
+  {
+    uint8_t ch_plus;
+    uint8_t ch_minus;
+    int16_t expected;
+  } const reads[] = {
+      {0, 1, -2000},   {1, 0, 2000},   {3, 2, INT16_MAX},  {2, 3, INT16_MIN}, {0x0c, 1, -3000},
+      {1, 1, 0},       {1, 0x0c, 3000}, {2, 0x0c, -20000}, {0x0d, 1, 0},      {1, 0x0f, 0},
+  };
+  for (const auto &r : reads)
+  {
+    // set_channel() won't take a reserved code either, so those go straight into INPMUX
+    const bool valid = DeviceDriver::is_valid_input(r.ch_plus) && DeviceDriver::is_valid_input(r.ch_minus);
+    ASSERT_EQ(valid, driver.set_channel(r.ch_plus, r.ch_minus));
+    driver.write_register(ADS114S08_REGISTERS::INPMUX, static_cast<uint8_t>((r.ch_plus << 4) | r.ch_minus));
+    ASSERT_EQ(r.expected, static_cast<int16_t>(driver.read_adc_by_rdata_cmd()));
+    ASSERT_EQ(r.expected, static_cast<int16_t>(spi.get_differential_test_val(r.ch_plus, r.ch_minus)));
+  }
+
+  ScanSequencer sequencer(driver);
+  const MuxPair list[]     = {{0, 1}, {3, 2}, {2, 3}, {1, 0x0c}, {0x0c, 2}};
+  const int16_t expected[] = {-2000, INT16_MAX, INT16_MIN, 3000, 20000};
+  ASSERT_TRUE(sequencer.set_scan_list(list, 5));
+
+  int16_t results[3 * 5] = {0};
+  ASSERT_EQ(3u * 5, sequencer.run(results, 3));
+  for (size_t k = 0; k < 3 * 5; ++k)
+  {
+    ASSERT_EQ(expected[k % 5], results[k]);
+  }
+
+  // Moving signals show up on every pass, differential or not
+  spi.get_signals().set_dc(1, 3500);
+  sequencer.scan(results);
+  ASSERT_EQ(-2500, results[0]);
+  ASSERT_EQ(3500, results[3]);
+}
+
+// Flips a data bit in the nth pipelined switch-and-read frame from now (WREG INPMUX + RDATA)
+class CorruptingSpi : public ISpiInterface
+{
+  public:
+    CorruptingSpi(ISpiInterface &inner) : inner(inner), corrupt_in(0) {}
+
+    virtual void    init(uint8_t SPI_mode) override { inner.init(SPI_mode); }
+    virtual uint8_t transfer(uint8_t data) override { return inner.transfer(data); }
+    virtual void    write(uint8_t data) override { inner.write(data); }
+    virtual uint8_t read(void) override { return inner.read(); }
+    virtual void    set_chip_select(uint8_t cs) override { inner.set_chip_select(cs); }
+    virtual void    transfer(const uint8_t *tx, uint8_t *rx, size_t len) override
+    {
+      inner.transfer(tx, rx, len);
+      if (rx && (len > 4) && (tx[3] == ADS114S08_CMD::RDATA) && corrupt_in && !--corrupt_in)
+      {
+        rx[len - 2] ^= 0x10;
+      }
+    }
+
+    ISpiInterface &inner;
+    size_t         corrupt_in;
+};
+
+// With CRC on, a reading damaged on the bus is still stored as received, but the scan says so:
+// scan() returns false and get_bad_readings() counts it, on one device and across a bus. The
+// next clean pass starts the count again.
+TEST(ScanSequencerTests, test_crc_failures)
+{
+  SpiEmulator   spi(2, false);
+  CorruptingSpi controller(spi);
+  SpiBus        bus(controller, spi.get_clock());
+  DeviceDriver  adc0(bus.device(0), spi.get_clock());
+  DeviceDriver  adc1(bus.device(1), spi.get_clock());
+  for (DeviceDriver *adc : {&adc0, &adc1})
+  {
+    ASSERT_TRUE(adc->initialize());
+    adc->write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+    adc->write_register(ADS114S08_REGISTERS::SYS,
+                        ADS114S08_REGISTERS::RESET_VALUES[ADS114S08_REGISTERS::SYS] | ADS114S08_SYS::CRC);
+  }
+
+  const MuxPair list[] = {{1, 0x0c}, {2, 0x0c}, {3, 0x0c}, {4, 0x0c}};
+  ScanSequencer sequencer(adc0);
+  ASSERT_TRUE(sequencer.set_scan_list(list, 4));
+
+  uint16_t results[3 * 8];
+  ASSERT_TRUE(sequencer.scan(results));
+  ASSERT_EQ(0u, sequencer.get_bad_readings());
+
+  controller.corrupt_in = 2;
+  ASSERT_FALSE(sequencer.scan(results));
+  ASSERT_EQ(1u, sequencer.get_bad_readings());
+  ASSERT_EQ(spi.get_raw_adc_test_val(1), results[0]);
+  ASSERT_NE(spi.get_raw_adc_test_val(2), results[1]);
+  ASSERT_EQ(spi.get_raw_adc_test_val(3), results[2]);
+
+  ASSERT_EQ(12u, sequencer.run(results, 3));
+  ASSERT_EQ(0u, sequencer.get_bad_readings());
+  controller.corrupt_in = 7;
+  ASSERT_EQ(12u, sequencer.run(results, 3));
+  ASSERT_EQ(1u, sequencer.get_bad_readings());
+  ASSERT_NE(spi.get_raw_adc_test_val(3), results[6]);
+
+  BusScanSequencer bus_sequencer(bus);
+  ASSERT_TRUE(bus_sequencer.add_device(adc0, list, 4));
+  ASSERT_TRUE(bus_sequencer.add_device(adc1, list, 4));
+  ASSERT_TRUE(bus_sequencer.scan(results));
+  ASSERT_EQ(0u, bus_sequencer.get_bad_readings());
+  controller.corrupt_in = 5;
+  ASSERT_FALSE(bus_sequencer.scan(results));
+  ASSERT_EQ(1u, bus_sequencer.get_bad_readings());
+  ASSERT_EQ(24u, bus_sequencer.run(results, 3));
+  ASSERT_EQ(0u, bus_sequencer.get_bad_readings());
+  ASSERT_EQ(2u + 1u, adc0.get_crc_errors() + adc1.get_crc_errors());
+}
+
+// A device left in single-shot mode would convert the first entry and nothing after it, since
+// only START restarts a single-shot conversion. The sequencers switch it to continuous mode, so
+// every entry still reads its own input, on one device and across a bus.
+TEST(ScanSequencerTests, test_single_shot_device)
+{
+  const uint8_t SINGLE_SHOT = ADS114S08_DATARATE::MODE | FAST_DATARATE;
+  const MuxPair list[]      = {{0, 0x0c}, {5, 0x0c}, {8, 0x0c}, {2, 0x0c}};
+
+  SpiEmulator  spi(2, false);
+  SpiBus       bus(spi, spi.get_clock());
+  DeviceDriver adc0(bus.device(0), spi.get_clock());
+  DeviceDriver adc1(bus.device(1), spi.get_clock());
+  for (DeviceDriver *adc : {&adc0, &adc1})
+  {
+    ASSERT_TRUE(adc->initialize());
+    adc->write_register(ADS114S08_REGISTERS::DATARATE, SINGLE_SHOT);
+  }
+
+  ScanSequencer sequencer(adc0);
+  ASSERT_TRUE(sequencer.set_scan_list(list, 4));
+  uint16_t results[2 * 8];
+  ASSERT_EQ(2u * 4, sequencer.run(results, 2));
+  for (size_t k = 0; k < 2 * 4; ++k)
+  {
+    ASSERT_EQ(spi.get_raw_adc_test_val(list[k % 4].ch_plus, 0), results[k]);
+  }
+  ASSERT_EQ(FAST_DATARATE, adc0.read_register(ADS114S08_REGISTERS::DATARATE));
+  adc0.stop_conversions();
+
+  adc0.write_register(ADS114S08_REGISTERS::DATARATE, SINGLE_SHOT);
+  BusScanSequencer bus_sequencer(bus);
+  ASSERT_TRUE(bus_sequencer.add_device(adc0, list, 4));
+  ASSERT_TRUE(bus_sequencer.add_device(adc1, list, 4));
+  ASSERT_EQ(2u * 8, bus_sequencer.run(results, 2));
+  for (size_t k = 0; k < 2 * 8; ++k)
+  {
+    ASSERT_EQ(spi.get_raw_adc_test_val(list[k % 4].ch_plus, (k % 8) / 4), results[k]);
+  }
+  ASSERT_EQ(FAST_DATARATE, adc1.read_register(ADS114S08_REGISTERS::DATARATE));
+}
+
+// Scan lists are checked against the part the driver found, not just the family: AIN6 - AIN11
+// are turned away on an ADS114S06, and the list already in place is kept
+TEST(ScanSequencerTests, test_inputs_of_part)
+{
+  SpiEmulator  spi(2, false);
+  SpiBus       bus(spi, spi.get_clock());
+  DeviceDriver adc08(bus.device(0), spi.get_clock());
+  DeviceDriver adc06(bus.device(1), spi.get_clock());
+  spi.set_device_id(ADS114S06_Traits::DEVICE_ID, 1);
+  ASSERT_TRUE(adc08.initialize());
+  ASSERT_TRUE(adc06.initialize());
+
+  const MuxPair low[]  = {{0, 0x0c}, {5, 4}};
+  const MuxPair high[] = {{0, 0x0c}, {7, 0x0c}};
+  const MuxPair diff[] = {{1, 9}};
+
+  ScanSequencer sequencer(adc06);
+  ASSERT_TRUE(sequencer.set_scan_list(low, 2));
+  ASSERT_FALSE(sequencer.set_scan_list(high, 2));
+  ASSERT_FALSE(sequencer.set_scan_list(diff, 1));
+  ASSERT_EQ(2u, sequencer.get_scan_length());
+
+  BusScanSequencer bus_sequencer(bus);
+  ASSERT_TRUE(bus_sequencer.add_device(adc08, high, 2));
+  ASSERT_FALSE(bus_sequencer.add_device(adc06, high, 2));
+  ASSERT_TRUE(bus_sequencer.add_device(adc06, low, 2));
+  ASSERT_EQ(4u, bus_sequencer.get_scan_length());
+}
@@ -0,0 +1,212 @@
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "adc_constants.h"
+#include "broadcast_ring.h"
+#include "shared_device_driver.h"
+#include "spi_emulator.h"
+
+// Low-latency filter, 4000 SPS
+static const uint8_t  FAST_DATARATE = ADS114S08_DATARATE::FILTER | 0x0d;
+static const uint32_t FAST_PERIOD   = ADS114S08_DATARATE::PERIOD_NANOS[0x0d];
+
+// Every subscriber sees every item in order, and one that falls more than the capacity behind
+// skips ahead and counts what it missed without ever blocking the producer.
+TEST(SharedDeviceDriverTests, test_broadcast_ring)
+{
+  BroadcastRing<uint16_t, 16> ring;
+  auto                        fast = ring.subscribe();
+  auto                        slow = ring.subscribe();
+
+  uint16_t out[32];
+  for (uint16_t n = 0; n < 10; ++n)
+  {
+    ring.publish(n);
+  }
+  ASSERT_EQ(10u, ring.read(fast, out, 32));
+  for (uint16_t n = 0; n < 10; ++n)
+  {
+    ASSERT_EQ(n, out[n]);
+  }
+
+  // A late subscriber only sees what comes next
+  auto late = ring.subscribe();
+  for (uint16_t n = 10; n < 50; ++n)
+  {
+    ring.publish(n);
+  }
+  ASSERT_EQ(40u, ring.pending(late));
+
+  ASSERT_EQ(16u, ring.read(slow, out, 32));
+  ASSERT_EQ(34u, slow.missed);
+  for (uint16_t n = 0; n < 16; ++n)
+  {
+    ASSERT_EQ(34 + n, out[n]);
+  }
+  ASSERT_EQ(0u, ring.pending(slow));
+
+  ASSERT_EQ(16u, ring.read(late, out, 32));
+  ASSERT_EQ(24u, late.missed);
+  ASSERT_EQ(50u, ring.published());
+}
+
+// DRDY with the bus free reads the sample directly; DRDY during a transaction is picked up with
+// RDATA when the transaction lets go. Either way every subscriber gets the right sample.
+TEST(SharedDeviceDriverTests, test_sample_fan_out)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+
+  SharedDeviceDriver shared(driver);
+  shared.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+  shared.set_channel(7);
+  const uint16_t expected = spi.get_raw_adc_test_val(7);
+
+  auto logger  = shared.subscribe();
+  auto control = shared.subscribe();
+  auto ui      = shared.subscribe();
+
+  spi.attach_drdy_isr(SharedDeviceDriver::adc_ready_isr, &shared);
+  shared.start_conversions();
+
+  spi.advance_time(driver.get_settling_nanos());
+  for (uint8_t n = 1; n < 10; ++n)
+  {
+    spi.advance_time(FAST_PERIOD);
+  }
+  ASSERT_EQ(10u, shared.get_published_samples());
+  ASSERT_EQ(0u, shared.get_deferred_samples());
+
+  // Conversions that complete while someone holds the bus
+  shared.transaction([&](DeviceDriver &) { spi.advance_time(FAST_PERIOD); });
+  ASSERT_EQ(11u, shared.get_published_samples());
+  ASSERT_EQ(1u, shared.get_deferred_samples());
+
+  uint16_t samples[16];
+  for (auto *subscriber : {&logger, &control, &ui})
+  {
+    ASSERT_EQ(11u, shared.read_samples(*subscriber, samples, 16));
+    for (uint8_t n = 0; n < 11; ++n)
+    {
+      ASSERT_EQ(expected, samples[n]);
+    }
+  }
+
+  // The UI stops reading for a while; nobody else notices
+  const size_t target = 11 + SharedDeviceDriver::SAMPLE_HISTORY + 100;
+  while (shared.get_published_samples() < target)
+  {
+    spi.advance_time(FAST_PERIOD);
+    ASSERT_GE(shared.read_samples(logger, samples, 16), 1u);
+    ASSERT_GE(shared.read_samples(control, samples, 16), 1u);
+  }
+  ASSERT_EQ(0u, logger.missed);
+  ASSERT_EQ(0u, shared.read_samples(logger, samples, 16));
+
+  const size_t behind   = shared.get_published_samples() - 11;
+  size_t       received = 0;
+  size_t       count;
+  while ((count = shared.read_samples(ui, samples, 16)) > 0)
+  {
+    received += count;
+  }
+  ASSERT_EQ(SharedDeviceDriver::SAMPLE_HISTORY, received);
+  ASSERT_EQ(behind - SharedDeviceDriver::SAMPLE_HISTORY, ui.missed);
+
+  shared.stop_conversions();
+}
+
+// A "hardware" thread produces conversions at 4000 SPS while a diagnostic thread pokes a register
+// that doesn't touch the result (GPIODAT; OFCAL would offset it) and three subscribers consume,
+// one of them slowly. Register traffic has to stay intact, every sample has to be right, and each
+// subscriber must account for every sample published.
+TEST(SharedDeviceDriverTests, test_concurrent_access)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+
+  SharedDeviceDriver shared(driver);
+  shared.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+  shared.set_channel(2);
+  const uint16_t expected = spi.get_raw_adc_test_val(2);
+
+  spi.attach_drdy_isr(SharedDeviceDriver::adc_ready_isr, &shared);
+  shared.start_conversions();
+
+  struct Consumer
+  {
+    SharedDeviceDriver::Subscriber cursor;
+    size_t                         received;
+    bool                           bad_sample;
+    bool                           slow;
+  };
+  Consumer consumers[3] = {{shared.subscribe(), 0, false, false},
+                           {shared.subscribe(), 0, false, false},
+                           {shared.subscribe(), 0, false, true}};
+
+  const uint32_t    NUM_PERIODS = 50000;
+  std::atomic<bool> producer_done(false);
+  std::atomic<bool> bad_register(false);
+
+  // The emulator isn't thread-safe, so time only moves while its stand-in holds the bus
+  std::thread hardware([&]() {
+    for (uint32_t n = 0; n < NUM_PERIODS; ++n)
+    {
+      shared.transaction([&](DeviceDriver &) { spi.advance_time(FAST_PERIOD); });
+    }
+    producer_done = true;
+  });
+
+  std::thread diagnostics([&]() {
+    uint8_t value = 0;
+    while (!producer_done)
+    {
+      shared.write_register(ADS114S08_REGISTERS::GPIODAT, value);
+      if (shared.read_register(ADS114S08_REGISTERS::GPIODAT) != value)
+      {
+        bad_register = true;
+      }
+      ++value;
+    }
+  });
+
+  auto consume = [&](Consumer &c) {
+    uint16_t block[64];
+    while (!producer_done || (c.cursor.position != shared.get_published_samples()))
+    {
+      const size_t count = shared.read_samples(c.cursor, block, 64);
+      for (size_t n = 0; n < count; ++n)
+      {
+        c.bad_sample |= (block[n] != expected);
+      }
+      c.received += count;
+      if (c.slow)
+      {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }
+  };
+
+  std::thread logger(consume, std::ref(consumers[0]));
+  std::thread control(consume, std::ref(consumers[1]));
+  std::thread ui(consume, std::ref(consumers[2]));
+
+  hardware.join();
+  diagnostics.join();
+  logger.join();
+  control.join();
+  ui.join();
+  shared.stop_conversions();
+
+  ASSERT_FALSE(bad_register);
+  ASSERT_GE(shared.get_published_samples(), NUM_PERIODS);
+  for (auto &c : consumers)
+  {
+    ASSERT_FALSE(c.bad_sample);
+    ASSERT_EQ(shared.get_published_samples(), c.received + c.cursor.missed);
+  }
+}
@@ -0,0 +1,161 @@
+#include <cmath>
+#include <gtest/gtest.h>
+
+#include "adc_constants.h"
+#include "device_driver.h"
+#include "signal_engine.h"
+#include "spi_emulator.h"
+
+static const uint64_t NANOS_PER_SEC = 1000000000ull;
+
+// Each kind of component, alone and summed, at points in the cycle where the answer is obvious.
+// The fast sine has to agree with std::sin to well under an LSB everywhere.
+TEST(SignalEngineTests, test_waveforms)
+{
+  SignalEngine engine;
+  ASSERT_EQ(0, engine.sample(0, 12345));
+
+  engine.set_dc(0, 1234.4);
+  ASSERT_EQ(1234, engine.sample(0, 0));
+  ASSERT_EQ(1234, engine.sample(0, 987654321));
+
+  // 1 kHz: one cycle per millisecond
+  const uint64_t cycle = NANOS_PER_SEC / 1000;
+
+  const SignalComponent sine[] = {SignalComponent::dc(0x8000), SignalComponent::sine(10000, 1000)};
+  ASSERT_TRUE(engine.set_source(1, sine, 2));
+  ASSERT_EQ(0x8000, engine.sample(1, 0));
+  ASSERT_EQ(0x8000 + 10000, engine.sample(1, cycle / 4));
+  ASSERT_EQ(0x8000 - 10000, engine.sample(1, 3 * cycle / 4));
+  for (uint64_t t = 0; t < 2 * cycle; t += 997)
+  {
+    const double exact = 0x8000 + 10000 * std::sin(6.283185307179586 * t / cycle);
+    ASSERT_NEAR(exact, engine.sample(1, t), 0.51);
+  }
+
+  const SignalComponent ramp[] = {SignalComponent::dc(1000), SignalComponent::ramp(500, 1000)};
+  ASSERT_TRUE(engine.set_source(2, ramp, 2));
+  ASSERT_EQ(500, engine.sample(2, 0));
+  ASSERT_EQ(1000, engine.sample(2, cycle / 2));
+  ASSERT_EQ(1250, engine.sample(2, 3 * cycle / 4));
+  ASSERT_EQ(500, engine.sample(2, cycle));
+
+  const SignalComponent square[] = {SignalComponent::dc(1000), SignalComponent::square(300, 1000, 0.5)};
+  ASSERT_TRUE(engine.set_source(3, square, 2));
+  ASSERT_EQ(700, engine.sample(3, cycle / 4));
+  ASSERT_EQ(1300, engine.sample(3, 3 * cycle / 4));
+
+  // Clamped to the code range
+  const SignalComponent too_big[] = {SignalComponent::dc(60000), SignalComponent::sine(10000, 1000)};
+  ASSERT_TRUE(engine.set_source(4, too_big, 2));
+  ASSERT_EQ(0xffff, engine.sample(4, cycle / 4));
+
+  // Bad inputs and too many components are rejected without touching anything
+  const uint32_t        generation = engine.get_generation();
+  const SignalComponent five[5]    = {};
+  ASSERT_FALSE(engine.set_source(SignalEngine::NUM_INPUTS, sine, 2));
+  ASSERT_FALSE(engine.set_source(1, five, 5));
+  ASSERT_EQ(generation, engine.get_generation());
+  ASSERT_EQ(0x8000 + 10000, engine.sample(1, cycle / 4));
+}
+
+// Noise has the requested statistics, is reproducible from its seed and time, and different
+// seeds give different noise
+TEST(SignalEngineTests, test_noise)
+{
+  SignalEngine          engine;
+  const SignalComponent noisy[] = {SignalComponent::dc(20000), SignalComponent::noise(50, 42)};
+  const SignalComponent other[] = {SignalComponent::dc(20000), SignalComponent::noise(50, 43)};
+  ASSERT_TRUE(engine.set_source(0, noisy, 2));
+  ASSERT_TRUE(engine.set_source(1, noisy, 2));
+  ASSERT_TRUE(engine.set_source(2, other, 2));
+
+  const size_t N = 20000;
+  double       sum    = 0;
+  double       sum_sq = 0;
+  size_t       same_as_other = 0;
+  for (size_t n = 0; n < N; ++n)
+  {
+    const uint64_t t = n * 250000;
+    const double   v = engine.sample(0, t);
+    sum += v;
+    sum_sq += v * v;
+    ASSERT_EQ(engine.sample(0, t), engine.sample(1, t));
+    same_as_other += (engine.sample(0, t) == engine.sample(2, t));
+  }
+
+  const double mean  = sum / N;
+  const double sigma = std::sqrt(sum_sq / N - mean * mean);
+  ASSERT_NEAR(20000, mean, 2);
+  ASSERT_NEAR(50, sigma, 2);
+  ASSERT_LT(same_as_other, N / 50);
+}
+
+// A block generated in one call matches evaluating each sample on its own, across chunk
+// boundaries and for every kind of component at once
+TEST(SignalEngineTests, test_block_matches_samples)
+{
+  SignalEngine          engine;
+  const SignalComponent mix[] = {SignalComponent::dc(30000), SignalComponent::sine(8000, 50, 0.1),
+                                 SignalComponent::square(1000, 7), SignalComponent::noise(20, 99)};
+  ASSERT_TRUE(engine.set_source(5, mix, 4));
+
+  const uint64_t t0   = 123456789;
+  const uint64_t step = ADS114S08_DATARATE::PERIOD_NANOS[0x0d];
+  uint16_t       block[1000];
+  engine.generate(5, t0, step, block, 1000);
+  for (size_t n = 0; n < 1000; ++n)
+  {
+    ASSERT_EQ(engine.sample(5, t0 + n * step), block[n]);
+  }
+}
+
+// Continuous conversions on a sine input: every sample the driver streams in is the signal's
+// value at the moment its conversion completed, and the samples actually follow the sine
+TEST(SignalEngineTests, test_emulated_acquisition)
+{
+  SpiEmulator  spi;
+  DeviceDriver driver(spi, spi.get_clock());
+  driver.initialize();
+
+  const uint8_t channel = 4;
+  driver.set_channel(channel);
+  driver.write_register(ADS114S08_REGISTERS::DATARATE, ADS114S08_DATARATE::FILTER | 0x0d);
+
+  const SignalComponent wave[] = {SignalComponent::dc(0x8000), SignalComponent::sine(0x4000, 100),
+                                  SignalComponent::noise(4, 7)};
+  ASSERT_TRUE(spi.get_signals().set_source(channel, wave, 3));
+
+  spi.attach_drdy_isr(DeviceDriver::adc_ready_isr, &driver);
+  const uint64_t start = spi.get_clock().now_nanos();
+  driver.start_conversions();
+
+  // START goes out straight away, and the first result follows one settling time later
+  const uint64_t period   = ADS114S08_DATARATE::PERIOD_NANOS[0x0d];
+  const uint64_t first_at = start + driver.get_settling_nanos();
+
+  const size_t NUM_SAMPLES = 400; // 10 cycles of 100 Hz at 4000 SPS
+  while (driver.get_queued_samples() < NUM_SAMPLES)
+  {
+    spi.advance_time(period);
+  }
+
+  uint16_t samples[NUM_SAMPLES];
+  ASSERT_EQ(NUM_SAMPLES, driver.read_samples(samples, NUM_SAMPLES));
+
+  uint16_t expected[NUM_SAMPLES];
+  spi.get_signals().generate(channel, first_at, period, expected, NUM_SAMPLES);
+
+  uint16_t lo = 0xffff;
+  uint16_t hi = 0;
+  for (size_t n = 0; n < NUM_SAMPLES; ++n)
+  {
+    ASSERT_EQ(expected[n], samples[n]);
+    lo = (samples[n] < lo) ? samples[n] : lo;
+    hi = (samples[n] > hi) ? samples[n] : hi;
+  }
+  ASSERT_LT(lo, 0x8000 - 0x3f00);
+  ASSERT_GT(hi, 0x8000 + 0x3f00);
+
+  driver.stop_conversions();
+}
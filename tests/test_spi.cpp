@@ -92,3 +92,21 @@ TEST(SPITests, LoopBack)
       break;
   }
 }
+
+// Clocks an RREG frame through one emulator a byte at a time and through another as a single
+// vectored transfer. Both must see the same bytes come back on CIPO
+TEST(SPITests, TransferFrame)
+{
+  SpiEmulator byte_spi;
+  SpiEmulator frame_spi;
+
+  // RREG starting at ID, 4 registers, followed by 4 NOPs to clock them out
+  const uint8_t tx[] = {0x20, 0x03, 0x00, 0x00, 0x00, 0x00};
+  uint8_t       rx[sizeof(tx)];
+
+  frame_spi.transfer(tx, rx, sizeof(tx));
+  for (size_t n = 0; n < sizeof(tx); ++n)
+  {
+    ASSERT_EQ(byte_spi.transfer(tx[n]), rx[n]);
+  }
+}
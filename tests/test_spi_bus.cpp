@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "adc_constants.h"
+#include "bus_scan_sequencer.h"
+#include "device_driver.h"
+#include "spi_bus.h"
+#include "spi_emulator.h"
+
+static const uint8_t  FAST_DATARATE = ADS114S08_DATARATE::FILTER | 0x0d;
+static const uint64_t FAST_PERIOD   = ADS114S08_DATARATE::PERIOD_NANOS[0x0d];
+
+// Three emulated ADCs on one bus, one driver each. Register writes and RDATA only ever reach the
+// device whose CS is low, and back-to-back transactions to one device keep CS asserted.
+TEST(SpiBusTests, test_chip_select_routing)
+{
+  SpiEmulator  spi(3, false);
+  SpiBus       bus(spi, spi.get_clock());
+  DeviceDriver adc0(bus.device(0), spi.get_clock());
+  DeviceDriver adc1(bus.device(1), spi.get_clock());
+  DeviceDriver adc2(bus.device(2), spi.get_clock());
+  DeviceDriver *adcs[] = {&adc0, &adc1, &adc2};
+
+  for (uint8_t cs = 0; cs < 3; ++cs)
+  {
+    adcs[cs]->initialize();
+    ASSERT_EQ(0x04, adcs[cs]->get_device_id());
+    ASSERT_EQ(cs, bus.get_selected());
+  }
+
+  for (uint8_t cs = 0; cs < 3; ++cs)
+  {
+    adcs[cs]->write_register(ADS114S08_REGISTERS::PGA, 0x10 + cs);
+  }
+  for (uint8_t cs = 0; cs < 3; ++cs)
+  {
+    uint8_t pga = 0;
+    adcs[cs]->read_registers(ADS114S08_REGISTERS::PGA, 1, &pga);
+    ASSERT_EQ(0x10 + cs, pga);
+  }
+
+  // The emulated inputs differ from device to device, and each driver reads its own (converted
+  // on the spot, in standby)
+  spi.set_timing_accurate(false);
+  for (uint8_t cs = 0; cs < 3; ++cs)
+  {
+    adcs[cs]->set_channel(6);
+    ASSERT_EQ(spi.get_raw_adc_test_val(6, cs), adcs[cs]->read_adc_by_rdata_cmd());
+  }
+  ASSERT_NE(spi.get_raw_adc_test_val(6, 0), spi.get_raw_adc_test_val(6, 1));
+
+  const uint32_t switches = bus.get_chip_select_switches();
+  for (uint8_t n = 0; n < 10; ++n)
+  {
+    (void)adc2.read_adc_by_rdata_cmd();
+  }
+  ASSERT_EQ(switches, bus.get_chip_select_switches());
+
+  (void)adc0.read_adc_by_rdata_cmd();
+  ASSERT_EQ(switches + 1, bus.get_chip_select_switches());
+
+  // With nothing selected, CIPO floats high
+  bus.release();
+  ASSERT_EQ(ISpiInterface::NO_CHIP_SELECT, bus.get_selected());
+  ASSERT_EQ(0xff, spi.transfer(ADS114S08_CMD::NOP));
+}
+
+// Scans on three devices at once: every reading comes from the right device and input, and
+// because the devices convert in parallel the pass costs about one device's worth of settling
+// time rather than three.
+TEST(SpiBusTests, test_interleaved_scan)
+{
+  SpiEmulator  spi(3, false);
+  SpiBus       bus(spi, spi.get_clock());
+  DeviceDriver adc0(bus.device(0), spi.get_clock());
+  DeviceDriver adc1(bus.device(1), spi.get_clock());
+  DeviceDriver adc2(bus.device(2), spi.get_clock());
+  DeviceDriver *adcs[] = {&adc0, &adc1, &adc2};
+
+  const MuxPair lists[3][4] = {{{0, 0x0c}, {1, 0x0c}, {2, 0x0c}, {3, 0x0c}},
+                               {{11, 0x0c}, {7, 0x0c}, {5, 0x0c}, {0, 0x0c}},
+                               {{4, 0x0c}, {4, 0x0c}, {9, 0x0c}, {10, 0x0c}}};
+
+  BusScanSequencer sequencer(bus);
+  for (uint8_t cs = 0; cs < 3; ++cs)
+  {
+    adcs[cs]->initialize();
+    adcs[cs]->write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+    ASSERT_TRUE(sequencer.add_device(*adcs[cs], lists[cs], 4));
+  }
+  ASSERT_EQ(12u, sequencer.get_scan_length());
+
+  const size_t NUM_SCANS = 5;
+  uint16_t     results[NUM_SCANS * 12] = {0};
+
+  const uint64_t t0 = spi.get_clock().now_nanos();
+  sequencer.scan(results);
+  const uint64_t elapsed = spi.get_clock().now_nanos() - t0;
+
+  for (uint8_t cs = 0; cs < 3; ++cs)
+  {
+    for (size_t n = 0; n < 4; ++n)
+    {
+      ASSERT_EQ(spi.get_raw_adc_test_val(lists[cs][n].ch_plus, cs), results[cs * 4 + n]);
+    }
+  }
+  ASSERT_GE(elapsed, 4 * FAST_PERIOD);
+  ASSERT_LT(elapsed, 6 * FAST_PERIOD);
+
+  const uint64_t scan_period = 8 * FAST_PERIOD;
+  ASSERT_EQ(NUM_SCANS * 12, sequencer.run(results, NUM_SCANS, scan_period));
+  ASSERT_EQ(0u, sequencer.get_overruns());
+  for (size_t s = 0; s < NUM_SCANS; ++s)
+  {
+    for (uint8_t cs = 0; cs < 3; ++cs)
+    {
+      for (size_t n = 0; n < 4; ++n)
+      {
+        ASSERT_EQ(spi.get_raw_adc_test_val(lists[cs][n].ch_plus, cs), results[s * 12 + cs * 4 + n]);
+      }
+    }
+  }
+
+  ASSERT_EQ(NUM_SCANS * 12, sequencer.run(results, NUM_SCANS, FAST_PERIOD));
+  ASSERT_GT(sequencer.get_overruns(), 0u);
+
+  // Bad lists are rejected, and so is a ninth device
+  ASSERT_FALSE(sequencer.add_device(adc0, lists[0], 0));
+  MuxPair too_long[ScanSequencer::MAX_SCAN_LENGTH + 1] = {};
+  ASSERT_FALSE(sequencer.add_device(adc0, too_long, ScanSequencer::MAX_SCAN_LENGTH + 1));
+  for (size_t n = sequencer.get_num_devices(); n < SpiBus::MAX_DEVICES; ++n)
+  {
+    ASSERT_TRUE(sequencer.add_device(adc0, lists[0], 4));
+  }
+  ASSERT_FALSE(sequencer.add_device(adc0, lists[0], 4));
+}
+
+// Two independent buses, each scanning two devices on its own thread. They share no state, so
+// they don't need any locking to get every reading right.
+TEST(SpiBusTests, test_independent_buses_threaded)
+{
+  struct BusRig
+  {
+    SpiEmulator      spi;
+    SpiBus           bus;
+    DeviceDriver     adc0;
+    DeviceDriver     adc1;
+    BusScanSequencer sequencer;
+
+    BusRig()
+        : spi(2, false), bus(spi, spi.get_clock()), adc0(bus.device(0), spi.get_clock()),
+          adc1(bus.device(1), spi.get_clock()), sequencer(bus)
+    {
+    }
+  };
+
+  BusRig        rigs[2];
+  const MuxPair list[] = {{3, 0x0c}, {8, 0x0c}, {1, 0x0c}};
+  for (auto &rig : rigs)
+  {
+    rig.adc0.initialize();
+    rig.adc1.initialize();
+    rig.adc0.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+    rig.adc1.write_register(ADS114S08_REGISTERS::DATARATE, FAST_DATARATE);
+    ASSERT_TRUE(rig.sequencer.add_device(rig.adc0, list, 3));
+    ASSERT_TRUE(rig.sequencer.add_device(rig.adc1, list, 3));
+  }
+
+  const size_t NUM_SCANS = 2000;
+  bool         good[2]   = {true, true};
+
+  auto worker = [&](size_t r) {
+    BusRig  &rig = rigs[r];
+    uint16_t results[6];
+    for (size_t s = 0; s < NUM_SCANS; ++s)
+    {
+      rig.sequencer.scan(results);
+      for (uint8_t cs = 0; cs < 2; ++cs)
+      {
+        for (size_t n = 0; n < 3; ++n)
+        {
+          if (results[cs * 3 + n] != rig.spi.get_raw_adc_test_val(list[n].ch_plus, cs))
+          {
+            good[r] = false;
+          }
+        }
+      }
+    }
+  };
+
+  std::thread bus0(worker, 0);
+  std::thread bus1(worker, 1);
+  bus0.join();
+  bus1.join();
+
+  ASSERT_TRUE(good[0]);
+  ASSERT_TRUE(good[1]);
+}
@@ -0,0 +1,222 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "adc_constants.h"
+#include "device_driver.h"
+#include "replay_spi.h"
+#include "spi_bus.h"
+#include "spi_emulator.h"
+#include "spi_recorder.h"
+#include "spi_recording.h"
+#include "virtual_clock.h"
+
+static std::string capture_path(const char *name)
+{
+  return ::testing::TempDir() + name;
+}
+
+struct SessionResult
+{
+  uint8_t  device_id;
+  uint8_t  registers[DeviceDriver::NUM_REGISTERS];
+  uint16_t readings[12];
+};
+
+// The same sequence of driver calls, whatever is on the other end of the bus
+static SessionResult run_session(DeviceDriver &driver)
+{
+  SessionResult result;
+  driver.initialize();
+  result.device_id = driver.get_device_id();
+
+  const uint8_t pga_ref[] = {0x0a, 0x12};
+  driver.write_registers(ADS114S08_REGISTERS::PGA, pga_ref, sizeof(pga_ref));
+  driver.read_registers(0, DeviceDriver::NUM_REGISTERS, result.registers);
+
+  for (uint8_t ch = 0; ch < 12; ++ch)
+  {
+    driver.set_channel(ch);
+    result.readings[ch] = driver.read_adc_by_rdata_cmd();
+  }
+  return result;
+}
+
+// Record a session against the emulator, then play it back on a fresh driver with nothing but
+// the capture behind it: the driver sees exactly the same responses, and nothing diverges.
+TEST(SpiReplayTests, test_record_and_replay)
+{
+  const std::string path = capture_path("record_and_replay.aspr");
+
+  SessionResult recorded;
+  uint64_t      frames;
+  {
+    SpiEmulator spi(false);
+    FILE       *out = fopen(path.c_str(), "wb");
+    ASSERT_NE(nullptr, out);
+    // Standby reads convert on the spot, so the capture holds a real reading per input
+    spi.set_timing_accurate(false);
+    {
+      SpiRecorder  recorder(spi, spi.get_clock(), out);
+      DeviceDriver driver(recorder, spi.get_clock());
+      recorded = run_session(driver);
+      frames   = recorder.get_frames_recorded();
+      ASSERT_EQ(0u, recorder.get_dropped_records());
+    }
+    fclose(out);
+  }
+  ASSERT_EQ(0x04, recorded.device_id);
+  ASSERT_GT(frames, 0u);
+
+  ReplaySpi    replay(path.c_str());
+  VirtualClock clock;
+  DeviceDriver driver(replay, clock);
+  ASSERT_TRUE(replay.is_open());
+
+  const SessionResult replayed = run_session(driver);
+  ASSERT_EQ(0u, replay.get_divergences());
+  ASSERT_TRUE(replay.at_end());
+  ASSERT_EQ(frames, replay.get_frames_replayed());
+  ASSERT_EQ(recorded.device_id, replayed.device_id);
+  ASSERT_EQ(0, memcmp(recorded.registers, replayed.registers, sizeof(recorded.registers)));
+  ASSERT_EQ(0, memcmp(recorded.readings, replayed.readings, sizeof(recorded.readings)));
+  ASSERT_GT(replay.get_recorded_nanos(), 0u);
+}
+
+// A driver that doesn't do what was recorded is caught at the first frame that differs, chip
+// selects included, and running past the end of the capture reads back as an idle bus.
+TEST(SpiReplayTests, test_divergence_detection)
+{
+  const std::string path = capture_path("divergence.aspr");
+  {
+    SpiEmulator spi(2, false);
+    FILE       *out = fopen(path.c_str(), "wb");
+    ASSERT_NE(nullptr, out);
+    {
+      SpiRecorder  recorder(spi, spi.get_clock(), out);
+      SpiBus       bus(recorder, spi.get_clock());
+      DeviceDriver driver(bus.device(1), spi.get_clock());
+      driver.initialize();
+      driver.write_register(ADS114S08_REGISTERS::PGA, 0x0a);
+      (void)driver.read_register(ADS114S08_REGISTERS::PGA);
+    }
+    fclose(out);
+  }
+
+  // Same calls, but the wrong device and a different register value
+  ReplaySpi    replay(path.c_str());
+  VirtualClock clock;
+  SpiBus       bus(replay, clock);
+  DeviceDriver driver(bus.device(0), clock);
+  ASSERT_TRUE(replay.is_open());
+
+  driver.initialize();
+  ASSERT_EQ(1u, replay.get_divergences());
+  const uint64_t first = replay.get_first_divergence_offset();
+  ASSERT_GE(first, SPI_RECORDING::HEADER_SIZE);
+
+  // The recorded responses still come back, so the device ID reads correctly
+  ASSERT_EQ(0x04, driver.get_device_id());
+
+  driver.write_register(ADS114S08_REGISTERS::PGA, 0x0b);
+  ASSERT_EQ(2u, replay.get_divergences());
+  ASSERT_EQ(first, replay.get_first_divergence_offset());
+
+  (void)driver.read_register(ADS114S08_REGISTERS::PGA);
+  ASSERT_TRUE(replay.at_end());
+  const uint64_t divergences = replay.get_divergences();
+
+  uint8_t tx[3] = {ADS114S08_CMD::NOP, 0x00, 0x00};
+  uint8_t rx[3] = {};
+  bus.device(0).transfer(tx, rx, sizeof(tx));
+  ASSERT_EQ(divergences + 1, replay.get_divergences());
+  for (uint8_t b : rx)
+  {
+    ASSERT_EQ(0xff, b);
+  }
+}
+
+TEST(SpiReplayTests, test_rejects_bad_files)
+{
+  ReplaySpi missing(capture_path("does_not_exist.aspr").c_str());
+  ASSERT_FALSE(missing.is_open());
+  ASSERT_EQ(0xff, missing.transfer(ADS114S08_CMD::NOP));
+  ASSERT_EQ(1u, missing.get_divergences());
+
+  const std::string path = capture_path("bad_magic.aspr");
+  FILE             *out  = fopen(path.c_str(), "wb");
+  ASSERT_NE(nullptr, out);
+  const uint8_t header[SPI_RECORDING::HEADER_SIZE] = {'W', 'A', 'V', 'E', 1, 0, 16, 0};
+  fwrite(header, 1, sizeof(header), out);
+  fclose(out);
+
+  ReplaySpi bad_magic(path.c_str());
+  ASSERT_FALSE(bad_magic.is_open());
+  ASSERT_TRUE(bad_magic.at_end());
+}
+
+// A transfer longer than MAX_FRAME_BYTES is recorded in chunks, the later ones stamped with the
+// transfer's start time, and replays as one. Two recorded transactions sent as one frame, or an
+// empty frame record, are divergences rather than something to read past.
+TEST(SpiReplayTests, test_frame_boundaries)
+{
+  const std::string path = capture_path("frame_boundaries.aspr");
+  std::vector<uint8_t> tx(SPI_RECORDING::MAX_FRAME_BYTES + 10, ADS114S08_CMD::NOP);
+  std::vector<uint8_t> rx(tx.size());
+  uint64_t             long_start;
+  {
+    SpiEmulator spi(false);
+    FILE       *out = fopen(path.c_str(), "wb");
+    ASSERT_NE(nullptr, out);
+    {
+      SpiRecorder recorder(spi, spi.get_clock(), out);
+      spi.advance_time(1000u);
+      long_start = spi.get_clock().now_nanos();
+      recorder.transfer(tx.data(), rx.data(), tx.size());
+      recorder.transfer(tx.data(), rx.data(), 3);
+      recorder.transfer(tx.data(), rx.data(), 3);
+      ASSERT_EQ(4u, recorder.get_frames_recorded());
+    }
+    fclose(out);
+  }
+
+  // The second chunk's delta is 0, not the first chunk's bus time
+  FILE *in = fopen(path.c_str(), "rb");
+  ASSERT_NE(nullptr, in);
+  const size_t         first_record = SPI_RECORDING::RECORD_HEADER_SIZE + 2 * SPI_RECORDING::MAX_FRAME_BYTES;
+  std::vector<uint8_t> file(SPI_RECORDING::HEADER_SIZE + first_record + SPI_RECORDING::RECORD_HEADER_SIZE);
+  ASSERT_EQ(file.size(), fread(file.data(), 1, file.size(), in));
+  fclose(in);
+  const uint8_t *second = file.data() + SPI_RECORDING::HEADER_SIZE + first_record;
+  ASSERT_EQ(SPI_RECORDING::RECORD_FRAME, second[0]);
+  ASSERT_EQ(10, second[2]);
+  ASSERT_EQ(0, second[4] | second[5] | second[6] | second[7]);
+
+  ReplaySpi replay(path.c_str());
+  ASSERT_TRUE(replay.is_open());
+  replay.transfer(tx.data(), rx.data(), tx.size());
+  ASSERT_EQ(0u, replay.get_divergences());
+  ASSERT_EQ(2u, replay.get_frames_replayed());
+  ASSERT_EQ(long_start, replay.get_recorded_nanos());
+
+  // Both three-byte transactions in one frame
+  replay.transfer(tx.data(), rx.data(), 6);
+  ASSERT_EQ(1u, replay.get_divergences());
+
+  const std::string empty_path = capture_path("empty_frame.aspr");
+  FILE             *out        = fopen(empty_path.c_str(), "wb");
+  ASSERT_NE(nullptr, out);
+  const uint8_t header[SPI_RECORDING::HEADER_SIZE]       = {'A', 'S', 'P', 'R', 1, 0, 16, 0};
+  const uint8_t empty[SPI_RECORDING::RECORD_HEADER_SIZE] = {SPI_RECORDING::RECORD_FRAME};
+  fwrite(header, 1, sizeof(header), out);
+  fwrite(empty, 1, sizeof(empty), out);
+  fclose(out);
+
+  ReplaySpi empty_frame(empty_path.c_str());
+  ASSERT_TRUE(empty_frame.is_open());
+  ASSERT_EQ(0xff, empty_frame.transfer(ADS114S08_CMD::NOP));
+  ASSERT_EQ(1u, empty_frame.get_divergences());
+  ASSERT_EQ(SPI_RECORDING::HEADER_SIZE, empty_frame.get_first_divergence_offset());
+}